@@ -0,0 +1,298 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../include/core/activation.h"
+#include "../include/core/gemm_tuner.h"
+#include "../include/core/parallel.h"
+#include "../include/core/task_scheduler.h"
+#include "../include/core/topology.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/model/pipeline.h"
+#include "../include/model/prediction_cache.h"
+#include "../include/data/image_stream.h"
+
+using namespace std;
+
+// Maximum logit difference accepted between the compiled and original model.
+const float kCompileTolerance = 1e-3f;
+
+struct Chunk
+{
+    vector<Tensor> images;
+    vector<int> labels;
+    vector<Tensor> logits;
+    // Pipeline mode: cache misses handed to the pipeline, and their indices.
+    vector<Tensor> pending;
+    vector<int> misses;
+    bool submitted = false;
+};
+
+void print_confusion_matrix(const vector<vector<long>> &confusion)
+{
+    const int n = confusion.size();
+    cout << "\nMatriz de confusión (filas: etiqueta real, columnas: predicción)" << endl;
+    cout << setw(6) << "";
+    for (int c = 0; c < n; c++)
+    {
+        cout << setw(8) << c;
+    }
+    cout << endl;
+    for (int r = 0; r < n; r++)
+    {
+        cout << setw(6) << r;
+        for (int c = 0; c < n; c++)
+        {
+            cout << setw(8) << confusion[r][c];
+        }
+        cout << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4 || argc > 6)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin> <entrada.csv|directorio> <salida.csv> [top-k] [tamaño_lote]" << endl;
+        cerr << "  <entrada.csv|directorio>: CSV con filas \"etiqueta,p0,...,p783\" o solo píxeles;" << endl;
+        cerr << "                            un directorio procesa todos sus archivos .csv." << endl;
+        cerr << "  [top-k]: clases con mayor probabilidad a escribir por imagen (por defecto: 0)." << endl;
+        cerr << "  [tamaño_lote]: imágenes leídas y clasificadas por lote (por defecto: 1024)." << endl;
+        return 1;
+    }
+
+    string model_path = argv[1];
+    string output_path = argv[3];
+    int top_k = argc > 4 ? stoi(argv[4]) : 0;
+    int batch_size = argc > 5 ? stoi(argv[5]) : 1024;
+    if (top_k < 0 || batch_size < 1)
+    {
+        cerr << "Error: top-k debe ser >= 0 y el tamaño de lote >= 1." << endl;
+        return 1;
+    }
+
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    try
+    {
+        vit.load_model(model_path);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error al cargar el modelo desde " << model_path << ": " << e.what() << endl;
+        return 1;
+    }
+    vit.set_training(false);
+    if (!CompiledVisionTransformer::check_supported(vit))
+        return 1;
+
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit, vit.checkpoint_dtype);
+    float diff = compiled.max_abs_diff(vit);
+    if (diff > kCompileTolerance)
+    {
+        cerr << "Error: el modelo compilado difiere del original (" << diff << ")." << endl;
+        return 1;
+    }
+
+    // The first run on a CPU tunes the compiled model's GEMM shapes and
+    // caches the winners; VIT_GEMM_TUNE=0 skips this, =1 retunes them all.
+    const char *tune_env = getenv("VIT_GEMM_TUNE");
+    if (GemmTuner::enabled() && !(tune_env != nullptr && string(tune_env) == "0"))
+    {
+        vector<GemmTuneResult> tuned = GemmTuner::tune(compiled.gemm_shapes(), tune_env != nullptr && string(tune_env) == "1");
+        int measured = count_if(tuned.begin(), tuned.end(), [](const GemmTuneResult &r)
+                                { return !r.cached; });
+        if (measured > 0)
+        {
+            cout << "Ajuste de GEMM: " << measured << " formas medidas en " << GemmTuner::cpu_key() << endl;
+            if (!GemmTuner::save(GemmTuner::cache_path()))
+                cerr << "Advertencia: no se pudo guardar el ajuste en " << GemmTuner::cache_path() << endl;
+        }
+        compiled.resolve_gemm_configs();
+    }
+    ReplicatedModel replicas(compiled);
+    const int num_classes = compiled.num_classes;
+    top_k = min(top_k, num_classes);
+    unique_ptr<PredictionCache> cache = PredictionCache::from_env(PredictionCache::checksum_for(model_path, compiled.weight_dtype));
+
+    // VIT_PIPELINE_STAGES=<n> streams every chunk through n stage threads,
+    // each owning a contiguous range of layers, instead of splitting the
+    // chunk's images across threads.
+    const char *stages_env = getenv("VIT_PIPELINE_STAGES");
+    PipelineOptions pipeline_options;
+    pipeline_options.num_stages = stages_env != nullptr ? atoi(stages_env) : 0;
+    unique_ptr<PipelineEngine> pipeline;
+
+    ofstream output(output_path);
+    if (!output.is_open())
+    {
+        cerr << "Error: No se pudo crear el archivo " << output_path << endl;
+        return 1;
+    }
+    output << "index,prediction,label";
+    for (int k = 1; k <= top_k; k++)
+    {
+        output << ",top" << k << ",prob" << k;
+    }
+    output << "\n";
+    output << fixed << setprecision(6);
+
+    ImageStream stream(argv[2]);
+    cout << "Clasificando " << stream.files().size() << " archivo(s) en lotes de " << batch_size
+         << " con " << Parallel::num_threads() << " hilo(s)" << endl;
+    cout << "Topología: " << Topology::describe() << ", réplicas del modelo: " << replicas.num_replicas() << endl;
+
+    vector<vector<long>> confusion(num_classes, vector<long>(num_classes, 0));
+    long total = 0, labelled = 0, correct = 0;
+    double inference_seconds = 0.0;
+    auto start = chrono::steady_clock::now();
+
+    // Answers what the cache can and streams the rest into the pipeline.
+    auto submit_chunk = [&](Chunk &chunk)
+    {
+        chunk.logits.assign(chunk.images.size(), Tensor());
+        for (size_t i = 0; i < chunk.images.size(); i++)
+        {
+            if (cache && cache->lookup(chunk.images[i], chunk.logits[i]))
+                continue;
+            chunk.misses.push_back(i);
+            chunk.pending.push_back(chunk.images[i]);
+        }
+        pipeline->submit(chunk.pending);
+        chunk.submitted = true;
+    };
+
+    // Double buffering: the next chunk is parsed on a worker while the
+    // current one is classified. With a pipeline the next chunk is also
+    // submitted before the current one is collected, so the stages never
+    // drain between chunks.
+    Chunk current, next;
+    stream.next_batch(current.images, current.labels, batch_size);
+    while (!current.images.empty())
+    {
+        next = Chunk();
+        TaskHandle prefetch = TaskScheduler::spawn([&]()
+                                                   { stream.next_batch(next.images, next.labels, batch_size); });
+
+        const int n = current.images.size();
+        vector<Tensor> &logits = current.logits;
+        auto inference_start = chrono::steady_clock::now();
+        if (pipeline_options.num_stages > 1 && !pipeline)
+            pipeline = make_unique<PipelineEngine>(compiled, pipeline_options, current.images[0]);
+        if (pipeline)
+        {
+            if (!current.submitted)
+                submit_chunk(current);
+            // Waiting for the parser is not inference time.
+            auto wait_start = chrono::steady_clock::now();
+            TaskScheduler::wait(prefetch);
+            inference_start += chrono::steady_clock::now() - wait_start;
+            if (!next.images.empty())
+                submit_chunk(next);
+            vector<Tensor> results = pipeline->collect(current.pending.size());
+            for (size_t k = 0; k < current.misses.size(); k++)
+            {
+                logits[current.misses[k]] = results[k];
+                if (cache)
+                    cache->insert(current.images[current.misses[k]], results[k]);
+            }
+        }
+        else
+        {
+            logits.assign(n, Tensor());
+            Parallel::parallel_for(0, n, 1, [&](int begin, int end)
+                                   {
+            const CompiledVisionTransformer &model = replicas.local();
+            for (int i = begin; i < end; i++)
+            {
+                if (cache && cache->lookup(current.images[i], logits[i]))
+                    continue;
+                logits[i] = model.forward(current.images[i]);
+                if (cache)
+                    cache->insert(current.images[i], logits[i]);
+            } });
+        }
+        inference_seconds += chrono::duration<double>(chrono::steady_clock::now() - inference_start).count();
+
+        vector<int> order(num_classes);
+        for (int i = 0; i < n; i++)
+        {
+            int predicted = Activation::argmax(logits[i]);
+            int label = current.labels[i];
+            output << total + i << "," << predicted << "," << label;
+            if (top_k > 0)
+            {
+                Tensor probabilities = Activation::softmax(logits[i]);
+                iota(order.begin(), order.end(), 0);
+                partial_sort(order.begin(), order.begin() + top_k, order.end(), [&](int a, int b)
+                             { return probabilities(0, a) > probabilities(0, b); });
+                for (int k = 0; k < top_k; k++)
+                {
+                    output << "," << order[k] << "," << probabilities(0, order[k]);
+                }
+            }
+            output << "\n";
+
+            if (label >= 0 && label < num_classes)
+            {
+                labelled++;
+                correct += predicted == label;
+                confusion[label][predicted]++;
+            }
+        }
+        total += n;
+
+        TaskScheduler::wait(prefetch);
+        swap(current, next);
+    }
+    output.close();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "\nImágenes clasificadas: " << total << endl;
+    if (stream.skipped_rows > 0)
+        cout << "Filas ignoradas por formato inválido: " << stream.skipped_rows << endl;
+    cout << fixed << setprecision(1);
+    if (total > 0)
+    {
+        cout << "Rendimiento total: " << total / seconds << " imágenes/s (" << seconds << " s)" << endl;
+        cout << "Rendimiento de inferencia: " << total / inference_seconds << " imágenes/s" << endl;
+    }
+    PipelineStats pipeline_stats;
+    if (pipeline)
+        pipeline_stats = pipeline->totals();
+    if (pipeline_stats.seconds > 0.0)
+    {
+        cout << "Pipeline de " << pipeline->num_stages() << " etapas:" << endl;
+        const vector<int> &bounds = pipeline->stage_boundaries();
+        for (int s = 0; s < pipeline->num_stages(); s++)
+        {
+            cout << "  Etapa " << s << ": " << CompiledVisionTransformer::op_name(compiled.ops[bounds[s]].kind)
+                 << " .. " << CompiledVisionTransformer::op_name(compiled.ops[bounds[s + 1] - 1].kind)
+                 << " (ops " << bounds[s] << "-" << bounds[s + 1] - 1 << "), utilización "
+                 << 100.0 * pipeline_stats.stages[s].utilization << "%" << endl;
+        }
+    }
+    if (labelled > 0)
+    {
+        cout << setprecision(2) << "Precisión: " << 100.0 * correct / labelled << "% (" << correct << "/" << labelled << ")" << endl;
+        print_confusion_matrix(confusion);
+    }
+    if (cache)
+    {
+        PredictionCache::Stats stats = cache->stats();
+        cout << "Caché de predicciones: " << stats.hits << " aciertos, " << stats.misses << " fallos, "
+             << stats.evictions << " desalojos, " << stats.entries << " entradas" << endl;
+        if (!cache->save_to_env())
+            cerr << "Advertencia: no se pudo guardar la caché en " << getenv("VIT_CACHE_FILE") << endl;
+    }
+    cout << "Predicciones guardadas en: " << output_path << endl;
+    return 0;
+}
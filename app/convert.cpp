@@ -0,0 +1,152 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../include/core/activation.h"
+#include "../include/core/half.h"
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+struct ConvertReport
+{
+    WeightDType dtype;
+    size_t weight_bytes;
+    double us_per_image;
+    float accuracy;
+    float agreement;      // predictions equal to the fp32 model
+    float max_logit_diff; // against the fp32 compiled model
+};
+
+ConvertReport evaluate(const VisionTransformer &vit, WeightDType dtype, const vector<Tensor> &images,
+                       const vector<int> &labels, const vector<Tensor> &reference)
+{
+    ConvertReport report;
+    report.dtype = dtype;
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit, dtype);
+    report.weight_bytes = compiled.weight_bytes();
+
+    vector<Tensor> logits;
+    logits.reserve(images.size());
+    auto start = chrono::steady_clock::now();
+    for (const Tensor &image : images)
+    {
+        logits.push_back(compiled.forward(image));
+    }
+    auto end = chrono::steady_clock::now();
+    report.us_per_image = chrono::duration<double, micro>(end - start).count() / images.size();
+
+    int correct = 0, agree = 0;
+    report.max_logit_diff = 0.0f;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        int predicted = Activation::argmax(logits[i]);
+        correct += predicted == labels[i];
+        if (!reference.empty())
+        {
+            agree += predicted == Activation::argmax(reference[i]);
+            for (int j = 0; j < logits[i].cols; j++)
+            {
+                report.max_logit_diff = max(report.max_logit_diff, fabs(logits[i](0, j) - reference[i](0, j)));
+            }
+        }
+    }
+    report.accuracy = static_cast<float>(correct) / images.size();
+    report.agreement = reference.empty() ? 1.0f : static_cast<float>(agree) / images.size();
+    return report;
+}
+
+long file_size(const string &path)
+{
+    ifstream file(path, ios::binary | ios::ate);
+    return file.is_open() ? static_cast<long>(file.tellg()) : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    WeightDType target;
+    if (argc != 4 || !parse_dtype(argv[3], target) || target == WeightDType::F32)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin> <test.csv> <f16|bf16>" << endl;
+        cerr << "  Guarda los pesos de las capas lineales en media precisión y compara" << endl;
+        cerr << "  tamaño, latencia y precisión con el modelo fp32." << endl;
+        return 1;
+    }
+
+    string model_path = argv[1];
+    Random::seed(42);
+    auto [test_images, test_labels] = DataLoader::load_data(argv[2]);
+
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    vit.load_model(model_path);
+    vit.set_training(false);
+    if (!CompiledVisionTransformer::check_supported(vit))
+        return 1;
+    if (vit.checkpoint_dtype != WeightDType::F32)
+        cout << "Advertencia: el modelo ya está en " << dtype_name(vit.checkpoint_dtype)
+             << "; la referencia fp32 hereda ese redondeo." << endl;
+
+    CompiledVisionTransformer reference_model = CompiledVisionTransformer::compile(vit);
+    vector<Tensor> reference;
+    for (const Tensor &image : test_images)
+    {
+        reference.push_back(reference_model.forward(image));
+    }
+
+    vector<ConvertReport> reports;
+    for (WeightDType dtype : {WeightDType::F32, WeightDType::F16, WeightDType::BF16})
+    {
+        reports.push_back(evaluate(vit, dtype, test_images, test_labels, reference));
+    }
+
+    string stem = model_path.size() > 4 && model_path.substr(model_path.size() - 4) == ".bin" ? model_path.substr(0, model_path.size() - 4) : model_path;
+    string output_path = stem + "_" + dtype_name(target) + ".bin";
+    vit.save_model(output_path, target);
+
+    // The converted file must reload to the same predictions as the in-memory
+    // narrowing that was just measured.
+    VisionTransformer reloaded(28, 4, 64, 2, 10);
+    reloaded.load_model(output_path);
+    reloaded.set_training(false);
+    CompiledVisionTransformer reloaded_model = CompiledVisionTransformer::compile(reloaded, target);
+    CompiledVisionTransformer narrowed_model = CompiledVisionTransformer::compile(vit, target);
+    float reload_diff = 0.0f;
+    for (const Tensor &image : test_images)
+    {
+        Tensor a = reloaded_model.forward(image), b = narrowed_model.forward(image);
+        for (int j = 0; j < a.cols; j++)
+        {
+            reload_diff = max(reload_diff, fabs(a(0, j) - b(0, j)));
+        }
+    }
+
+    const double f32_bytes = static_cast<double>(reports[0].weight_bytes);
+    cout << "\nPrecisión de almacenamiento de pesos (" << test_images.size() << " imágenes)" << endl;
+    cout << left << setw(8) << "tipo" << right << setw(14) << "pesos KB" << setw(10) << "ahorro"
+         << setw(14) << "MB/s pesos" << setw(12) << "us/imagen" << setw(12) << "precisión"
+         << setw(12) << "acuerdo" << setw(14) << "error máx" << endl;
+    for (const ConvertReport &report : reports)
+    {
+        // Every forward pass streams the full packed weights once.
+        double bandwidth = report.weight_bytes / report.us_per_image;
+        cout << left << setw(8) << dtype_name(report.dtype) << right << fixed << setprecision(1)
+             << setw(14) << report.weight_bytes / 1024.0 << setw(9) << (1.0 - report.weight_bytes / f32_bytes) * 100.0 << "%"
+             << setw(14) << bandwidth << setprecision(2) << setw(12) << report.us_per_image
+             << setw(11) << report.accuracy * 100 << "%" << setw(11) << report.agreement * 100 << "%"
+             << scientific << setprecision(2) << setw(14) << report.max_logit_diff << defaultfloat << endl;
+    }
+
+    cout << "\nModelo " << dtype_name(target) << " guardado en: " << output_path << endl;
+    cout << "Tamaño en disco: " << file_size(model_path) / 1024 << " KB -> " << file_size(output_path) / 1024 << " KB" << endl;
+    cout << "Diferencia tras recargar: " << reload_diff << endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/model/low_rank_linear.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+struct FactorizeReport
+{
+    string setting, ranks;
+    size_t parameters;
+    double us_per_image;
+    float accuracy;
+    float max_error;
+};
+
+// Factorizes attention_proj, fc1 and fc2 of every block. A target below 1 is
+// an energy threshold, anything else a fixed rank; layers where the chosen
+// rank is not cheaper than the dense product stay dense. Returns the ranks
+// as "attn/fc1/fc2" per block ("-" for dense layers).
+string factorize_model(VisionTransformer &vit, float target)
+{
+    string ranks;
+    for (size_t l = 0; l < vit.transformer_blocks.size(); l++)
+    {
+        auto &block = vit.transformer_blocks[l];
+        ranks += l ? " " : "";
+        int index = 0;
+        for (Linear *linear : {&block->attention_proj, &block->mlp.fc1, &block->mlp.fc2})
+        {
+            const int in_features = linear->weight.cols, out_features = linear->weight.rows;
+            int rank = target < 1.0f ? LowRankLinear::rank_for_energy(linear->weight, target) : static_cast<int>(target);
+            rank = min(rank, min(in_features, out_features));
+            ranks += index++ ? "/" : "";
+            if (LowRankLinear::is_cheaper(rank, in_features, out_features))
+            {
+                linear->factorize(rank);
+                ranks += to_string(rank);
+            }
+            else
+            {
+                ranks += "-";
+            }
+        }
+    }
+    return ranks;
+}
+
+string setting_label(float setting)
+{
+    if (setting == 0.0f)
+        return "denso";
+    ostringstream label;
+    if (setting < 1.0f)
+        label << "e=" << setting;
+    else
+        label << "r=" << static_cast<int>(setting);
+    return label.str();
+}
+
+// dense is the unfactorized model; max_error measures the low-rank
+// approximation against it.
+FactorizeReport evaluate(VisionTransformer &vit, VisionTransformer &dense, const vector<Tensor> &images, const vector<int> &labels)
+{
+    FactorizeReport report;
+    report.parameters = vit.num_parameters();
+
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+    report.max_error = compiled.max_abs_diff(dense);
+    int correct = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (compiled.predict(images[i]) == labels[i])
+            correct++;
+    }
+    auto end = chrono::steady_clock::now();
+    report.us_per_image = chrono::duration<double, micro>(end - start).count() / images.size();
+    report.accuracy = static_cast<float>(correct) / images.size();
+    return report;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin> <test.csv> <energía|rango>" << endl;
+        cerr << "  <energía|rango>: menor que 1 = fracción de energía espectral a conservar (ej. 0.9);" << endl;
+        cerr << "                   1 o más = rango fijo para cada capa." << endl;
+        return 1;
+    }
+
+    string model_path = argv[1];
+    float target = stof(argv[3]);
+    if (target <= 0.0f)
+    {
+        cerr << "Error: el objetivo debe ser positivo." << endl;
+        return 1;
+    }
+
+    Random::seed(42);
+    auto [test_images, test_labels] = DataLoader::load_data(argv[2]);
+
+    // 0 stands for the dense model.
+    vector<float> targets = {0.0f, 0.99f, 0.9f, 0.8f, 16.0f, 8.0f};
+    if (find(targets.begin(), targets.end(), target) == targets.end())
+        targets.push_back(target);
+
+    VisionTransformer dense(28, 4, 64, 2, 10);
+    dense.load_model(model_path);
+    dense.set_training(false);
+
+    vector<FactorizeReport> reports;
+    string output_path;
+    for (float setting : targets)
+    {
+        VisionTransformer vit(28, 4, 64, 2, 10);
+        vit.load_model(model_path);
+        vit.set_training(false);
+        if (!CompiledVisionTransformer::check_supported(vit))
+            return 1;
+
+        string ranks = setting > 0.0f ? factorize_model(vit, setting) : "denso";
+        FactorizeReport report = evaluate(vit, dense, test_images, test_labels);
+        report.ranks = ranks;
+        report.setting = setting_label(setting);
+        reports.push_back(report);
+
+        if (setting == target)
+        {
+            string stem = model_path.size() > 4 && model_path.substr(model_path.size() - 4) == ".bin" ? model_path.substr(0, model_path.size() - 4) : model_path;
+            output_path = stem + "_lowrank.bin";
+            vit.save_model(output_path);
+        }
+    }
+
+    cout << "\nFactorización de bajo rango (rangos attn/fc1/fc2 por bloque)" << endl;
+    cout << left << setw(10) << "objetivo" << setw(22) << "rangos" << right << setw(12) << "parámetros"
+         << setw(12) << "us/imagen" << setw(12) << "precisión" << setw(14) << "error máx" << endl;
+    for (const FactorizeReport &report : reports)
+    {
+        cout << left << setw(10) << report.setting << setw(22) << report.ranks << right << setw(12) << report.parameters
+             << fixed << setprecision(2) << setw(12) << report.us_per_image << setw(11) << report.accuracy * 100 << "%"
+             << scientific << setprecision(2) << setw(14) << report.max_error << defaultfloat << endl;
+    }
+    cout << "Modelo factorizado guardado en: " << output_path << endl;
+    return 0;
+}
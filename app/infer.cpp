@@ -12,6 +12,7 @@
 #include <sstream>
 #include <map>
 #include <chrono>
+#include <cstdlib>
 
 #include "../include/core/random.h"
 #include "../include/core/tensor.h"
@@ -21,9 +22,69 @@
 #include "../include/model/mlp.h"
 #include "../include/model/encoder.h"
 #include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/model/static_vit.h"
+#include "../include/model/prediction_cache.h"
 
 using namespace std;
 
+// Maximum logit difference accepted between the compiled and original model.
+const float kCompileTolerance = 1e-3f;
+// Looser bound when weights are narrowed to half precision at compile time.
+const float kHalfCompileTolerance = 5e-2f;
+
+// Packed weight precision from VIT_WEIGHT_DTYPE (f32|f16|bf16); defaults to
+// the precision the checkpoint was stored in.
+WeightDType weight_dtype_from_env(WeightDType checkpoint_dtype)
+{
+    const char *name = getenv("VIT_WEIGHT_DTYPE");
+    if (name == nullptr)
+        return checkpoint_dtype;
+    WeightDType dtype;
+    if (!parse_dtype(name, dtype))
+    {
+        cerr << "Advertencia: VIT_WEIGHT_DTYPE desconocido '" << name << "'. Se usa " << dtype_name(checkpoint_dtype) << "." << endl;
+        return checkpoint_dtype;
+    }
+    return dtype;
+}
+
+// Token reduction requested through VIT_TOKEN_MODE (prune|merge) and
+// VIT_TOKEN_KEEP (comma-separated keep ratio per block, e.g. "0.5,0.5").
+TokenReduction token_reduction_from_env()
+{
+    TokenReduction reduction;
+    const char *mode = getenv("VIT_TOKEN_MODE");
+    const char *keep = getenv("VIT_TOKEN_KEEP");
+    if (mode == nullptr || keep == nullptr)
+        return reduction;
+
+    string mode_name = mode;
+    if (mode_name == "prune")
+        reduction.mode = TokenReduction::Mode::Prune;
+    else if (mode_name == "merge")
+        reduction.mode = TokenReduction::Mode::Merge;
+    else
+    {
+        cerr << "Advertencia: VIT_TOKEN_MODE desconocido '" << mode_name << "'. Se usan todos los tokens." << endl;
+        return reduction;
+    }
+
+    stringstream ss(keep);
+    string cell;
+    while (getline(ss, cell, ','))
+    {
+        float ratio = stof(cell);
+        if (ratio <= 0.0f || ratio > 1.0f)
+        {
+            cerr << "Advertencia: ratio de VIT_TOKEN_KEEP fuera de (0, 1]: " << cell << ". Se usan todos los tokens." << endl;
+            return TokenReduction();
+        }
+        reduction.keep_ratios.push_back(ratio);
+    }
+    return reduction;
+}
+
 class DataGenerator
 {
 public:
@@ -79,7 +140,7 @@ public:
 
         vector<int> indices(all_images.size());
         iota(indices.begin(), indices.end(), 0);
-        shuffle(indices.begin(), indices.end(), Random::gen);
+        Random::shuffle(indices);
 
         int total = all_images.size();
         int val_size = static_cast<int>(total * val_split);
@@ -106,22 +167,48 @@ public:
         }
     }
 
-    tuple<vector<Tensor>, vector<int>> get_train_data()
+    tuple<const vector<Tensor> &, const vector<int> &> get_train_data() const
     {
-        return make_tuple(train_images, train_labels);
+        return {train_images, train_labels};
     }
 
-    tuple<vector<Tensor>, vector<int>> get_val_data()
+    tuple<const vector<Tensor> &, const vector<int> &> get_val_data() const
     {
-        return make_tuple(val_images, val_labels);
+        return {val_images, val_labels};
     }
 
-    tuple<vector<Tensor>, vector<int>> get_test_data()
+    tuple<const vector<Tensor> &, const vector<int> &> get_test_data() const
     {
-        return make_tuple(test_images, test_labels);
+        return {test_images, test_labels};
     }
 };
 
+void print_cache_stats(const PredictionCache &cache)
+{
+    PredictionCache::Stats stats = cache.stats();
+    std::cout << "Caché de predicciones: " << stats.hits << " aciertos, " << stats.misses << " fallos, "
+              << stats.evictions << " desalojos, " << stats.entries << " entradas" << std::endl;
+    if (!cache.save_to_env())
+        std::cerr << "Advertencia: no se pudo guardar la caché en " << getenv("VIT_CACHE_FILE") << std::endl;
+}
+
+// Per-exit softmax confidence thresholds from VIT_EXIT_THRESHOLD (e.g. "0.9").
+ExitPolicy exit_policy_from_env()
+{
+    ExitPolicy exits;
+    const char *thresholds = getenv("VIT_EXIT_THRESHOLD");
+    if (thresholds == nullptr)
+        return exits;
+
+    stringstream ss(thresholds);
+    string cell;
+    while (getline(ss, cell, ','))
+    {
+        exits.thresholds.push_back(stof(cell));
+    }
+    return exits;
+}
+
 int infer(const std::string &model_path, const Tensor &image)
 {
 
@@ -155,9 +242,89 @@ int infer(const std::string &model_path, const Tensor &image)
         return -1;
     }
 
-    int predicted_class = vit.predict(image);
+    vit.set_training(false);
+    if (!CompiledVisionTransformer::supports(vit))
+    {
+        std::cout << "Modelo con mezcla de tokens: usando el modelo sin compilar." << std::endl;
+        return vit.predict(image);
+    }
+    WeightDType weight_dtype = weight_dtype_from_env(vit.checkpoint_dtype);
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit, weight_dtype);
+    float diff = compiled.max_abs_diff(vit);
+    float tolerance = weight_dtype == vit.checkpoint_dtype ? kCompileTolerance : kHalfCompileTolerance;
+    if (diff > tolerance)
+    {
+        std::cerr << "Advertencia: el modelo compilado difiere del original (" << diff
+                  << "). Usando el modelo sin optimizar." << std::endl;
+        return vit.predict(image);
+    }
+    std::cout << "Modelo compilado: " << compiled.ops.size() << " operaciones fusionadas"
+              << " (diferencia máxima " << diff << ")" << std::endl;
+    if (weight_dtype != WeightDType::F32)
+        std::cout << "Pesos empaquetados en " << dtype_name(weight_dtype) << ": " << compiled.weight_bytes() / 1024.0 << " KB" << std::endl;
+
+    TokenReduction reduction = token_reduction_from_env();
+    if (reduction.enabled())
+        std::cout << "Reducción de tokens activa (" << getenv("VIT_TOKEN_MODE") << ", keep " << getenv("VIT_TOKEN_KEEP") << ")" << std::endl;
+
+    ExitPolicy exits = exit_policy_from_env();
+
+    // Token reduction and early exits change the logits, so only the full
+    // model's outputs are cached. Exit thresholds without exit heads are
+    // ignored below and leave the logits unchanged.
+    const bool exits_active = exits.enabled() && vit.has_exit_heads();
+    std::unique_ptr<PredictionCache> cache;
+    if (!reduction.enabled() && !exits_active)
+        cache = PredictionCache::from_env(PredictionCache::checksum_for(model_path, compiled.weight_dtype));
+    if (cache)
+    {
+        Tensor cached;
+        if (cache->lookup(image, cached))
+        {
+            std::cout << "Predicción recuperada de la caché" << std::endl;
+            print_cache_stats(*cache);
+            return Activation::argmax(cached);
+        }
+    }
+
+    if (exits_active)
+    {
+        int blocks_run = 0;
+        Tensor logits = compiled.forward(image, reduction, exits, &blocks_run);
+        std::cout << "Salida temprana: " << blocks_run << " de " << vit.num_layers << " bloques evaluados" << std::endl;
+        return Activation::argmax(logits);
+    }
+    if (exits.enabled())
+        std::cerr << "Advertencia: el modelo no tiene cabezas de salida temprana; se ignora VIT_EXIT_THRESHOLD." << std::endl;
+    if (reduction.enabled())
+        return Activation::argmax(compiled.forward(image, reduction));
+
+    // The static kernels keep fp32 weights, so they only serve fp32 requests.
+    std::unique_ptr<StaticModelBase> specialized;
+    if (weight_dtype == WeightDType::F32)
+        specialized = make_static_model(compiled);
+    Tensor logits = compiled.forward(image);
+    if (specialized)
+    {
+        Tensor actual = specialized->forward(image);
+        float specialized_diff = 0.0f;
+        for (int j = 0; j < logits.cols; j++)
+        {
+            specialized_diff = std::max(specialized_diff, std::fabs(logits(0, j) - actual(0, j)));
+        }
+        if (specialized_diff <= kCompileTolerance)
+        {
+            std::cout << "Usando kernels especializados para la configuración " << specialized->config() << std::endl;
+            logits = actual;
+        }
+    }
 
-    return predicted_class;
+    if (cache)
+    {
+        cache->insert(image, logits);
+        print_cache_stats(*cache);
+    }
+    return Activation::argmax(logits);
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Starts N train.out processes for data-parallel training on this host.
+// Each one gets VIT_RANK / VIT_WORLD_SIZE / VIT_DIST_BACKEND / VIT_DIST_ADDR
+// and, unless VIT_NUM_THREADS is set, an equal share of the cores. Only
+// rank 0 writes to stdout; if any process fails the others are stopped.
+int main(int argc, char *argv[])
+{
+    if (argc != 5 || atoi(argv[1]) < 1 || (string(argv[2]) != "shm" && string(argv[2]) != "tcp"))
+    {
+        cerr << "Uso: " << argv[0] << " <procesos> <shm|tcp> <train.csv> <test.csv>" << endl;
+        cerr << "  shm: all-reduce en anillo por memoria compartida POSIX." << endl;
+        cerr << "  tcp: all-reduce en anillo por TCP (VIT_DIST_ADDR=host:puerto, por defecto 127.0.0.1:29500)." << endl;
+        return 1;
+    }
+    const int world_size = atoi(argv[1]);
+    const string backend = argv[2];
+
+    string self = argv[0];
+    size_t slash = self.rfind('/');
+    string train_path = (slash == string::npos ? string(".") : self.substr(0, slash)) + "/train.out";
+
+    const char *address_env = getenv("VIT_DIST_ADDR");
+    string address = address_env != nullptr ? address_env
+                     : backend == "shm"     ? "/vit_dist_" + to_string(getpid())
+                                            : "127.0.0.1:29500";
+    int hw = max(1u, thread::hardware_concurrency());
+    string threads = getenv("VIT_NUM_THREADS") != nullptr ? getenv("VIT_NUM_THREADS") : to_string(max(1, hw / world_size));
+
+    cout << "Lanzando " << world_size << " procesos (" << backend << ", " << address << ", "
+         << threads << " hilo(s) cada uno)" << endl;
+
+    vector<pid_t> children;
+    for (int rank = 0; rank < world_size; rank++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            cerr << "Error: no se pudo crear el proceso " << rank << endl;
+            for (pid_t child : children)
+                kill(child, SIGTERM);
+            return 1;
+        }
+        if (pid == 0)
+        {
+            setenv("VIT_RANK", to_string(rank).c_str(), 1);
+            setenv("VIT_WORLD_SIZE", to_string(world_size).c_str(), 1);
+            setenv("VIT_DIST_BACKEND", backend.c_str(), 1);
+            setenv("VIT_DIST_ADDR", address.c_str(), 1);
+            setenv("VIT_NUM_THREADS", threads.c_str(), 1);
+            if (rank != 0)
+            {
+                int null_fd = open("/dev/null", O_WRONLY);
+                dup2(null_fd, STDOUT_FILENO);
+                close(null_fd);
+            }
+            execl(train_path.c_str(), train_path.c_str(), argv[3], argv[4], static_cast<char *>(nullptr));
+            cerr << "Error: no se pudo ejecutar " << train_path << ": " << strerror(errno) << endl;
+            _exit(127);
+        }
+        children.push_back(pid);
+    }
+
+    int failures = 0;
+    for (size_t remaining = children.size(); remaining > 0; remaining--)
+    {
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!ok && failures++ == 0)
+        {
+            int rank = find(children.begin(), children.end(), pid) - children.begin();
+            cerr << "Error: el proceso " << rank << " terminó con "
+                 << (WIFEXITED(status) ? "código " + to_string(WEXITSTATUS(status)) : "la señal " + to_string(WTERMSIG(status)))
+                 << "; deteniendo los demás." << endl;
+            for (pid_t child : children)
+            {
+                if (child != pid)
+                    kill(child, SIGTERM);
+            }
+        }
+    }
+    // Normally rank 0 unlinks the segment once everybody attached.
+    if (backend == "shm")
+        shm_unlink(address.c_str());
+    return failures == 0 ? 0 : 1;
+}
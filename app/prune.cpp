@@ -0,0 +1,151 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/core/activation.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/model/pruning.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+// Samples used to accumulate gradients for the Taylor criterion.
+const int kCalibrationSamples = 256;
+
+struct PruneReport
+{
+    float sparsity;
+    string widths;
+    size_t parameters;
+    double us_per_image;
+    float accuracy;
+};
+
+void finetune(VisionTransformer &vit, const vector<Tensor> &images, const vector<int> &labels, int epochs)
+{
+    const float learning_rate = 3e-4f;
+    const size_t batch_size = 128;
+    vit.set_training(true);
+    for (int epoch = 0; epoch < epochs; epoch++)
+    {
+        vector<int> indices(images.size());
+        iota(indices.begin(), indices.end(), 0);
+        Random::shuffle(indices);
+        for (size_t batch_start = 0; batch_start < indices.size(); batch_start += batch_size)
+        {
+            vit.zero_grad();
+            size_t batch_end = min(batch_start + batch_size, indices.size());
+            for (size_t i = batch_start; i < batch_end; ++i)
+            {
+                vit.train_step(images[indices[i]], labels[indices[i]]);
+            }
+            vit.update_weights(learning_rate);
+        }
+    }
+    vit.set_training(false);
+    vit.prepack_weights();
+}
+
+PruneReport evaluate(VisionTransformer &vit, float sparsity, const vector<Tensor> &images, const vector<int> &labels)
+{
+    PruneReport report;
+    report.sparsity = sparsity;
+    for (size_t l = 0; l < vit.transformer_blocks.size(); l++)
+    {
+        report.widths += (l ? "," : "") + to_string(vit.transformer_blocks[l]->mlp.fc1.weight.rows);
+    }
+    report.parameters = vit.num_parameters();
+
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+    int correct = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (compiled.predict(images[i]) == labels[i])
+            correct++;
+    }
+    auto end = chrono::steady_clock::now();
+    report.us_per_image = chrono::duration<double, micro>(end - start).count() / images.size();
+    report.accuracy = static_cast<float>(correct) / images.size();
+    return report;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5 || argc > 7)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin> <train.csv> <test.csv> <sparsity> [magnitude|gradient] [épocas_ajuste]" << endl;
+        cerr << "  <sparsity>: fracción de unidades ocultas del MLP a eliminar en cada bloque (0 a 1)." << endl;
+        cerr << "  [épocas_ajuste]: épocas de ajuste fino tras podar (por defecto 0)." << endl;
+        return 1;
+    }
+
+    string model_path = argv[1];
+    float target_sparsity = stof(argv[4]);
+    string criterion_name = argc > 5 ? argv[5] : "magnitude";
+    int finetune_epochs = argc > 6 ? stoi(argv[6]) : 0;
+    if (target_sparsity < 0.0f || target_sparsity >= 1.0f || (criterion_name != "magnitude" && criterion_name != "gradient"))
+    {
+        cerr << "Error: sparsity debe estar en [0, 1) y el criterio ser magnitude o gradient." << endl;
+        return 1;
+    }
+    StructuredPruning::Criterion criterion = criterion_name == "gradient" ? StructuredPruning::Criterion::Gradient
+                                                                          : StructuredPruning::Criterion::Magnitude;
+
+    Random::seed(42);
+    auto [train_images, train_labels] = DataLoader::load_data(argv[2]);
+    auto [test_images, test_labels] = DataLoader::load_data(argv[3]);
+    vector<Tensor> calibration_images(train_images.begin(), train_images.begin() + min<size_t>(kCalibrationSamples, train_images.size()));
+    vector<int> calibration_labels(train_labels.begin(), train_labels.begin() + calibration_images.size());
+
+    vector<float> levels = {0.0f, 0.25f, 0.5f, 0.75f};
+    if (find(levels.begin(), levels.end(), target_sparsity) == levels.end())
+        levels.push_back(target_sparsity);
+    sort(levels.begin(), levels.end());
+
+    vector<PruneReport> reports;
+    string output_path;
+    for (float sparsity : levels)
+    {
+        VisionTransformer vit(28, 4, 64, 2, 10);
+        vit.load_model(model_path);
+        vit.set_training(false);
+        if (!CompiledVisionTransformer::check_supported(vit))
+            return 1;
+
+        if (sparsity > 0.0f)
+        {
+            auto importance = StructuredPruning::mlp_importance(vit, criterion, calibration_images, calibration_labels);
+            StructuredPruning::prune_mlp(vit, importance, sparsity);
+            if (finetune_epochs > 0)
+                finetune(vit, train_images, train_labels, finetune_epochs);
+        }
+        reports.push_back(evaluate(vit, sparsity, test_images, test_labels));
+
+        if (sparsity == target_sparsity)
+        {
+            string stem = model_path.size() > 4 && model_path.substr(model_path.size() - 4) == ".bin" ? model_path.substr(0, model_path.size() - 4) : model_path;
+            output_path = stem + "_pruned" + to_string(static_cast<int>(lround(sparsity * 100))) + ".bin";
+            vit.save_model(output_path);
+        }
+    }
+
+    cout << "\nPoda estructurada del MLP (criterio " << criterion_name << ", " << finetune_epochs << " épocas de ajuste)" << endl;
+    cout << left << setw(10) << "sparsity" << right << setw(14) << "ancho MLP" << setw(12) << "parámetros"
+         << setw(10) << "KB" << setw(12) << "us/imagen" << setw(12) << "precisión" << endl;
+    for (const PruneReport &report : reports)
+    {
+        cout << left << setw(10) << fixed << setprecision(2) << report.sparsity << right << setw(14) << report.widths
+             << setw(12) << report.parameters << setw(10) << setprecision(1) << report.parameters * sizeof(float) / 1024.0
+             << setw(12) << setprecision(2) << report.us_per_image << setw(11) << report.accuracy * 100 << "%"
+             << (report.sparsity == target_sparsity ? "  <- " + output_path : "") << endl;
+    }
+    return 0;
+}
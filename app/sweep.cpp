@@ -0,0 +1,382 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/core/parallel.h"
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/evaluator.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+// Hyperparameter sweep over one in-memory copy of the data set. Trials
+// train concurrently, each limited to threads_per_trial cores, and weak
+// trials are dropped by successive halving: every rung trains the
+// survivors up to min_epochs * eta^r epochs and keeps the best 1/eta by
+// validation loss, until the last rung reaches epochs.
+//
+// Spec file, one "key value..." per line ('#' starts a comment):
+//   mode grid|random          grid: every combination; random: `samples` draws
+//   samples 8
+//   seed 42
+//   learning_rate 1e-4 3e-4 1e-3
+//   batch_size 64 128
+//   d_model 32 64
+//   num_layers 1 2
+//   patch_size 4 7            must divide 28
+//   epochs 8                  epochs for trials that survive every rung
+//   min_epochs 1              epochs of the first rung
+//   eta 2                     halving factor
+//   threads_per_trial 1
+//   concurrent 4              trials trained at once (default: cores / threads_per_trial)
+//   val_split 0.1
+
+struct TrialConfig
+{
+    float learning_rate;
+    int batch_size, d_model, num_layers, patch_size;
+};
+
+struct Trial
+{
+    int id;
+    TrialConfig config;
+    unique_ptr<VisionTransformer> model;
+    RandomStream rng;
+    int epochs_done = 0;
+    float train_loss = 0.0f, val_loss = 0.0f, val_acc = 0.0f;
+    double seconds = 0.0;
+    int stopped_at_rung = -1; // -1: survived every rung
+};
+
+struct SweepSpec
+{
+    string mode = "grid";
+    int samples = 8;
+    uint64_t seed = 42;
+    vector<float> learning_rates = {3e-4f};
+    vector<int> batch_sizes = {128}, d_models = {64}, num_layers = {2}, patch_sizes = {4};
+    int epochs = 10, min_epochs = 1, eta = 2;
+    int threads_per_trial = 1, concurrent = 0;
+    float val_split = 0.1f;
+};
+
+const int kImageSize = 28;
+const int kNumClasses = 10;
+
+template <typename T>
+vector<T> parse_values(istringstream &ss)
+{
+    vector<T> values;
+    T value;
+    while (ss >> value)
+    {
+        values.push_back(value);
+    }
+    return values;
+}
+
+bool load_spec(const string &path, SweepSpec &spec)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "Error: No se pudo abrir el archivo " << path << endl;
+        return false;
+    }
+    string line;
+    int line_number = 0;
+    while (getline(file, line))
+    {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        istringstream ss(line);
+        string key;
+        if (!(ss >> key))
+            continue;
+
+        if (key == "mode")
+            ss >> spec.mode;
+        else if (key == "samples")
+            ss >> spec.samples;
+        else if (key == "seed")
+            ss >> spec.seed;
+        else if (key == "learning_rate")
+            spec.learning_rates = parse_values<float>(ss);
+        else if (key == "batch_size")
+            spec.batch_sizes = parse_values<int>(ss);
+        else if (key == "d_model")
+            spec.d_models = parse_values<int>(ss);
+        else if (key == "num_layers")
+            spec.num_layers = parse_values<int>(ss);
+        else if (key == "patch_size")
+            spec.patch_sizes = parse_values<int>(ss);
+        else if (key == "epochs")
+            ss >> spec.epochs;
+        else if (key == "min_epochs")
+            ss >> spec.min_epochs;
+        else if (key == "eta")
+            ss >> spec.eta;
+        else if (key == "threads_per_trial")
+            ss >> spec.threads_per_trial;
+        else if (key == "concurrent")
+            ss >> spec.concurrent;
+        else if (key == "val_split")
+            ss >> spec.val_split;
+        else
+        {
+            cerr << "Error: clave desconocida '" << key << "' en la línea " << line_number << endl;
+            return false;
+        }
+    }
+
+    for (int patch : spec.patch_sizes)
+    {
+        if (patch <= 0 || kImageSize % patch != 0)
+        {
+            cerr << "Error: patch_size " << patch << " no divide " << kImageSize << endl;
+            return false;
+        }
+    }
+    if (spec.learning_rates.empty() || spec.batch_sizes.empty() || spec.d_models.empty() ||
+        spec.num_layers.empty() || spec.patch_sizes.empty())
+    {
+        cerr << "Error: cada hiperparámetro necesita al menos un valor." << endl;
+        return false;
+    }
+    if ((spec.mode != "grid" && spec.mode != "random") || spec.epochs < 1 || spec.min_epochs < 1 ||
+        spec.eta < 2 || spec.threads_per_trial < 1 || spec.samples < 1)
+    {
+        cerr << "Error: especificación inválida (mode grid|random, epochs/min_epochs/samples >= 1, eta >= 2)." << endl;
+        return false;
+    }
+    return true;
+}
+
+vector<TrialConfig> expand(const SweepSpec &spec)
+{
+    vector<TrialConfig> configs;
+    if (spec.mode == "grid")
+    {
+        for (float lr : spec.learning_rates)
+            for (int batch : spec.batch_sizes)
+                for (int d : spec.d_models)
+                    for (int layers : spec.num_layers)
+                        for (int patch : spec.patch_sizes)
+                            configs.push_back({lr, batch, d, layers, patch});
+        return configs;
+    }
+    for (int s = 0; s < spec.samples; s++)
+    {
+        configs.push_back({spec.learning_rates[Random::randint(0, spec.learning_rates.size() - 1)],
+                           spec.batch_sizes[Random::randint(0, spec.batch_sizes.size() - 1)],
+                           spec.d_models[Random::randint(0, spec.d_models.size() - 1)],
+                           spec.num_layers[Random::randint(0, spec.num_layers.size() - 1)],
+                           spec.patch_sizes[Random::randint(0, spec.patch_sizes.size() - 1)]});
+    }
+    return configs;
+}
+
+// Trains trial up to target_epochs on the calling thread and scores it on
+// the validation set. The trial carries its own random stream, so results
+// do not depend on which thread runs it or what else runs alongside.
+void train_trial(Trial &trial, int target_epochs, const vector<Tensor> &train_images, const vector<int> &train_labels,
+                 const vector<Tensor> &val_images, const vector<int> &val_labels)
+{
+    auto start = chrono::steady_clock::now();
+    Random::stream() = trial.rng;
+    VisionTransformer &vit = *trial.model;
+    const TrialConfig &config = trial.config;
+
+    for (; trial.epochs_done < target_epochs; trial.epochs_done++)
+    {
+        vector<int> indices(train_images.size());
+        iota(indices.begin(), indices.end(), 0);
+        Random::shuffle(indices);
+        float train_loss = 0.0f;
+        for (size_t batch_start = 0; batch_start < indices.size(); batch_start += config.batch_size)
+        {
+            vit.zero_grad();
+            size_t batch_end = min(batch_start + config.batch_size, indices.size());
+            for (size_t i = batch_start; i < batch_end; ++i)
+            {
+                train_loss += vit.train_step(train_images[indices[i]], train_labels[indices[i]]).loss;
+            }
+            vit.update_weights(config.learning_rate);
+        }
+        trial.train_loss = train_images.empty() ? 0.0f : train_loss / train_images.size();
+    }
+
+    EvalResult result = BackgroundEvaluator::evaluate(vit, val_images, val_labels, {}, {});
+    trial.val_loss = result.val_loss;
+    trial.val_acc = result.val_acc;
+    trial.rng = Random::stream();
+    trial.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+string describe(const TrialConfig &config)
+{
+    ostringstream os;
+    os << "lr=" << config.learning_rate << " batch=" << config.batch_size << " d=" << config.d_model
+       << " capas=" << config.num_layers << " patch=" << config.patch_size;
+    return os.str();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        cerr << "Uso: " << argv[0] << " <spec.txt> <train.csv> <resultados.csv>" << endl;
+        cerr << "  <spec.txt>: líneas \"clave valores...\" (mode, samples, seed, learning_rate, batch_size," << endl;
+        cerr << "              d_model, num_layers, patch_size, epochs, min_epochs, eta," << endl;
+        cerr << "              threads_per_trial, concurrent, val_split)." << endl;
+        return 1;
+    }
+
+    SweepSpec spec;
+    if (!load_spec(argv[1], spec))
+        return 1;
+    string results_path = argv[3];
+    if (spec.concurrent <= 0)
+        spec.concurrent = max(1, static_cast<int>(thread::hardware_concurrency()) / spec.threads_per_trial);
+
+    Random::seed(spec.seed);
+
+    // --- Data: loaded once, shared read-only by every trial ---
+    auto [all_images, all_labels] = DataLoader::load_data(argv[2]);
+    vector<int> indices(all_images.size());
+    iota(indices.begin(), indices.end(), 0);
+    Random::shuffle(indices);
+    size_t val_size = static_cast<size_t>(all_images.size() * spec.val_split);
+    vector<Tensor> train_images, val_images;
+    vector<int> train_labels, val_labels;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        auto &images = i < val_size ? val_images : train_images;
+        auto &labels = i < val_size ? val_labels : train_labels;
+        images.push_back(all_images[indices[i]]);
+        labels.push_back(all_labels[indices[i]]);
+    }
+    all_images.clear();
+    all_labels.clear();
+
+    // --- Trials: built here, in order, so initial weights are reproducible ---
+    vector<TrialConfig> configs = expand(spec);
+    vector<Trial> trials;
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        Trial trial;
+        trial.id = static_cast<int>(i);
+        trial.config = configs[i];
+        trial.model = make_unique<VisionTransformer>(kImageSize, configs[i].patch_size, configs[i].d_model,
+                                                     configs[i].num_layers, kNumClasses);
+        trial.rng = RandomStream(spec.seed, Random::next_stream());
+        trials.push_back(move(trial));
+    }
+
+    cout << "Barrido: " << trials.size() << " configuraciones (" << spec.mode << "), "
+         << spec.concurrent << " en paralelo con " << spec.threads_per_trial << " hilo(s) cada una" << endl;
+    cout << "Entrenamiento: " << train_images.size() << " muestras, validación: " << val_images.size() << endl;
+
+    auto sweep_start = chrono::steady_clock::now();
+    mutex print_mutex;
+    vector<int> active(trials.size());
+    iota(active.begin(), active.end(), 0);
+    int rung_epochs = min(spec.min_epochs, spec.epochs);
+    for (int rung = 0; !active.empty(); rung++)
+    {
+        cout << "\nRonda " << rung + 1 << ": " << active.size() << " configuraciones hasta " << rung_epochs << " épocas" << endl;
+
+        atomic<size_t> next(0);
+        auto worker = [&]()
+        {
+            Parallel::set_thread_budget(spec.threads_per_trial);
+            size_t k;
+            while ((k = next++) < active.size())
+            {
+                Trial &trial = trials[active[k]];
+                train_trial(trial, rung_epochs, train_images, train_labels, val_images, val_labels);
+                lock_guard<mutex> lock(print_mutex);
+                cout << "  [" << setw(3) << trial.id << "] " << left << setw(48) << describe(trial.config) << right
+                     << " val pérdida " << fixed << setprecision(4) << trial.val_loss
+                     << " | precisión " << setprecision(2) << trial.val_acc * 100 << "%" << endl;
+            }
+        };
+        vector<thread> workers;
+        for (int w = 0; w < min<int>(spec.concurrent, active.size()); w++)
+        {
+            workers.emplace_back(worker);
+        }
+        for (thread &w : workers)
+        {
+            w.join();
+        }
+
+        if (rung_epochs >= spec.epochs)
+            break;
+
+        // Successive halving: keep the best 1/eta by validation loss (ties
+        // by id, so the cut is deterministic).
+        sort(active.begin(), active.end(), [&](int a, int b)
+             { return trials[a].val_loss != trials[b].val_loss ? trials[a].val_loss < trials[b].val_loss : a < b; });
+        size_t keep = max<size_t>(1, (active.size() + spec.eta - 1) / spec.eta);
+        for (size_t k = keep; k < active.size(); k++)
+        {
+            trials[active[k]].stopped_at_rung = rung;
+            trials[active[k]].model.reset();
+        }
+        active.resize(keep);
+        sort(active.begin(), active.end());
+        rung_epochs = min(spec.epochs, rung_epochs * spec.eta);
+    }
+    double sweep_seconds = chrono::duration<double>(chrono::steady_clock::now() - sweep_start).count();
+
+    // --- Results ---
+    vector<int> order(trials.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int a, int b)
+         {
+        if (trials[a].epochs_done != trials[b].epochs_done)
+            return trials[a].epochs_done > trials[b].epochs_done;
+        return trials[a].val_loss != trials[b].val_loss ? trials[a].val_loss < trials[b].val_loss : a < b; });
+
+    ofstream results(results_path);
+    if (!results.is_open())
+    {
+        cerr << "Error: No se pudo crear el archivo " << results_path << endl;
+        return 1;
+    }
+    results << "trial,learning_rate,batch_size,d_model,num_layers,patch_size,epochs,train_loss,val_loss,val_acc,seconds,stopped_at_rung\n";
+    cout << "\nResultados (mejor primero)" << endl;
+    // setw counts bytes: the accented headers get one extra column.
+    cout << setw(6) << "trial" << "  " << left << setw(49) << "configuración" << right << setw(9) << "épocas"
+         << setw(13) << "val pérdida" << setw(13) << "precisión" << setw(10) << "s" << endl;
+    for (int index : order)
+    {
+        const Trial &trial = trials[index];
+        const TrialConfig &c = trial.config;
+        results << trial.id << "," << c.learning_rate << "," << c.batch_size << "," << c.d_model << "," << c.num_layers << ","
+                << c.patch_size << "," << trial.epochs_done << "," << trial.train_loss << "," << trial.val_loss << ","
+                << trial.val_acc << "," << trial.seconds << "," << trial.stopped_at_rung << "\n";
+        cout << setw(6) << trial.id << "  " << left << setw(48) << describe(c) << right << setw(8) << trial.epochs_done
+             << fixed << setprecision(4) << setw(12) << trial.val_loss << setprecision(2) << setw(11) << trial.val_acc * 100 << "%"
+             << setprecision(1) << setw(10) << trial.seconds << endl;
+    }
+    cout << "\nTiempo total del barrido: " << fixed << setprecision(1) << sweep_seconds << " s" << endl;
+    cout << "Resultados guardados en: " << results_path << endl;
+    return 0;
+}
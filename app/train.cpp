@@ -12,67 +12,23 @@
 #include <sstream>
 #include <map>
 #include <chrono>
+#include <cstdlib>
 // Assuming these are your project's header files
 #include "../include/core/random.h"
 #include "../include/core/tensor.h"
 #include "../include/core/activation.h"
+#include "../include/core/collective.h"
 #include "../include/model/linear.h"
 #include "../include/model/layernorm.h"
 #include "../include/model/mlp.h"
 #include "../include/model/encoder.h"
 #include "../include/model/vit.h"
+#include "../include/model/checkpoint.h"
+#include "../include/model/evaluator.h"
+#include "../include/data/data_loader.h"
 
 using namespace std;
 
-// DataLoader now handles loading from a single file.
-class DataLoader
-{
-public:
-    static pair<vector<Tensor>, vector<int>> load_data(const string &filename, int max_samples_to_load = -1, int num_classes_to_load = 10)
-    {
-        vector<Tensor> images;
-        vector<int> labels;
-
-        ifstream file(filename);
-        if (!file.is_open())
-        {
-            cerr << "Error: No se pudo abrir el archivo " << filename << endl;
-            exit(1);
-        }
-
-        string line;
-        int samples_loaded = 0;
-
-        // Skip header
-        getline(file, line);
-        while (getline(file, line) && (max_samples_to_load == -1 || samples_loaded < max_samples_to_load))
-        {
-            stringstream ss(line);
-            string cell;
-
-            if (!getline(ss, cell, ','))
-                continue;
-            int label = stoi(cell);
-            if (label >= num_classes_to_load)
-                continue;
-
-            Tensor image(28, 28);
-            for (int i = 0; i < 784; i++)
-            {
-                if (!getline(ss, cell, ','))
-                    break;
-                image(i / 28, i % 28) = stof(cell) / 255.0f;
-            }
-            images.push_back(image);
-            labels.push_back(label);
-            samples_loaded++;
-        }
-        file.close();
-        cout << "Datos cargados: " << samples_loaded << " muestras de " << filename << endl;
-        return {images, labels};
-    }
-};
-
 void printProgressBar(int current, int total, int barWidth = 50)
 {
     float progress = (float)current / total;
@@ -91,6 +47,16 @@ void printProgressBar(int current, int total, int barWidth = 50)
     cout.flush();
 }
 
+void print_eval_result(const EvalResult &result)
+{
+    cout << "  Validación    - Pérdida: " << fixed << setprecision(4) << result.val_loss
+         << " | Precisión: " << setprecision(2) << result.val_acc * 100 << "%"
+         << "  [época " << result.epoch + 1 << (result.end_of_epoch ? " completa" : "") << ", paso " << result.step << "]" << endl;
+    cout << "  Prueba        - Pérdida: " << fixed << setprecision(4) << result.test_loss
+         << " | Precisión: " << setprecision(2) << result.test_acc * 100 << "%"
+         << "  (" << setprecision(1) << result.seconds << " s)" << endl;
+}
+
 int main(int argc, char *argv[])
 {
     if (argc != 3)
@@ -103,6 +69,23 @@ int main(int argc, char *argv[])
     string train_filepath = argv[1];
     string test_filepath = argv[2];
 
+    // --- Data Parallelism ---
+    // Under launch.out every process trains a replica on its share of each
+    // batch, and gradients are summed across processes before the update.
+    // Only rank 0 evaluates, checkpoints and saves the model.
+    unique_ptr<Collective> collective;
+    try
+    {
+        collective = Collective::from_env();
+    }
+    catch (const exception &e)
+    {
+        cerr << "❌ Error: " << e.what() << endl;
+        return 1;
+    }
+    const int rank = collective ? collective->rank() : 0;
+    const int world_size = collective ? collective->world_size() : 1;
+
     cout << "Vision Transformer con Entrenamiento por Batch" << endl;
     cout << "==============================================" << endl;
     Random::seed(42);
@@ -121,12 +104,12 @@ int main(int argc, char *argv[])
     // --- Data Loading ---
     cout << "Cargando datos..." << endl;
     auto [all_train_images, all_train_labels] = DataLoader::load_data(train_filepath);
-    auto [test_images, test_labels] = DataLoader::load_data(test_filepath);
+    auto [test_images, test_labels] = rank == 0 ? DataLoader::load_data(test_filepath) : pair<vector<Tensor>, vector<int>>();
 
     // --- Train/Validation Split ---
     vector<int> indices(all_train_images.size());
     iota(indices.begin(), indices.end(), 0);
-    shuffle(indices.begin(), indices.end(), Random::gen);
+    Random::shuffle(indices);
 
     int val_size = static_cast<int>(all_train_images.size() * val_split_ratio);
     vector<Tensor> train_images, val_images;
@@ -148,6 +131,23 @@ int main(int argc, char *argv[])
 
     // --- Model Initialization ---
     VisionTransformer vit(image_size, patch_size, d_model, num_layers, num_classes);
+    // VIT_EXIT_HEADS=1 trains an early-exit classifier after every block but the last.
+    const char *exit_heads_env = getenv("VIT_EXIT_HEADS");
+    if (exit_heads_env != nullptr && string(exit_heads_env) == "1")
+        vit.enable_exit_heads();
+    // VIT_TOKEN_MIXER=linear mixes tokens with linear attention in every block
+    // (VIT_MIXER_HEADS heads, 4 by default).
+    const char *token_mixer_env = getenv("VIT_TOKEN_MIXER");
+    if (token_mixer_env != nullptr && string(token_mixer_env) == "linear")
+    {
+        int mixer_heads = getenv("VIT_MIXER_HEADS") ? stoi(getenv("VIT_MIXER_HEADS")) : 4;
+        if (mixer_heads < 1 || d_model % mixer_heads != 0)
+        {
+            cerr << "Error: VIT_MIXER_HEADS debe dividir d_model (" << d_model << ")." << endl;
+            return 1;
+        }
+        vit.enable_token_mixing(mixer_heads);
+    }
 
     cout << "\nConfiguración:" << endl;
     cout << "- Imagen: " << image_size << "x" << image_size << endl;
@@ -156,86 +156,250 @@ int main(int argc, char *argv[])
     cout << "- Dimensión de embedding (d_model): " << d_model << endl;
     cout << "- Capas Transformer: " << num_layers << endl;
     cout << "- Clases: " << num_classes << endl;
+    cout << "- Cabezas de salida temprana: " << vit.exit_heads.size() << endl;
+    if (vit.token_mixing_heads() > 0)
+        cout << "- Mezcla de tokens: atención lineal (" << vit.token_mixing_heads() << " cabezas)" << endl;
     cout << "- Learning rate: " << learning_rate << endl;
     cout << "- Épocas: " << epochs << endl;
     cout << "- Batch size: " << batch_size << endl;
     cout << "- Muestras de entrenamiento: " << train_images.size() << endl;
     cout << "- Muestras de validación: " << val_images.size() << endl;
-    cout << "- Muestras de prueba: " << test_images.size() << endl
-         << endl;
+    cout << "- Muestras de prueba: " << test_images.size() << endl;
+    if (collective)
+        cout << "- Procesos: " << world_size << " (" << (getenv("VIT_DIST_BACKEND") ? getenv("VIT_DIST_BACKEND") : "shm") << ")" << endl;
+    cout << endl;
+
+    // --- Checkpoints ---
+    // VIT_CHECKPOINT=<path> snapshots the training state every
+    // VIT_CHECKPOINT_EVERY batches and after every epoch; VIT_RESUME=1
+    // continues from that file when it exists.
+    const char *checkpoint_env = getenv("VIT_CHECKPOINT");
+    const char *checkpoint_every_env = getenv("VIT_CHECKPOINT_EVERY");
+    const char *resume_env = getenv("VIT_RESUME");
+    int checkpoint_every = checkpoint_every_env != nullptr ? max(1, atoi(checkpoint_every_env)) : 10;
+    unique_ptr<AsyncCheckpointWriter> checkpointer;
+    TrainingState resume_state;
+    bool resumed = false;
+    if (checkpoint_env != nullptr)
+    {
+        if (resume_env != nullptr && string(resume_env) == "1" && resume_state.load(checkpoint_env))
+        {
+            // A mid-epoch permutation must index exactly this training set;
+            // epoch-boundary checkpoints carry none.
+            if (!resume_state.restore(vit) ||
+                (!resume_state.permutation.empty() && resume_state.permutation.size() != train_images.size()))
+            {
+                cerr << "❌ Error: el checkpoint " << checkpoint_env << " no corresponde a este modelo o conjunto de datos." << endl;
+                return 1;
+            }
+            resumed = true;
+            // The checkpoint holds totals over all processes; count them once.
+            if (rank != 0)
+            {
+                resume_state.progress.train_loss = 0.0f;
+                resume_state.progress.train_correct = 0;
+            }
+            cout << "Reanudando desde " << checkpoint_env << ": época " << resume_state.progress.epoch + 1
+                 << ", lote " << resume_state.progress.batch_count + 1 << endl
+                 << endl;
+        }
+        if (rank == 0)
+            checkpointer = make_unique<AsyncCheckpointWriter>(checkpoint_env);
+    }
+    int start_epoch = resumed ? resume_state.progress.epoch : 0;
+
+    // Every replica starts from rank 0's weights. Gradient buckets are
+    // reduced while the last sample of each batch is still backpropagating.
+    unique_ptr<OverlappedAllReduce> reducer;
+    vector<vector<Tensor *>> gradient_buckets = vit.gradient_buckets();
+    if (collective)
+    {
+        for (auto &[name, tensor] : vit.named_parameters())
+            collective->broadcast(tensor->data.data(), tensor->data.size());
+        reducer = make_unique<OverlappedAllReduce>(*collective);
+    }
+    // Loss and hit count summed over every process.
+    auto global_stats = [&](float loss, int correct)
+    {
+        float stats[2] = {loss, static_cast<float>(correct)};
+        if (collective)
+            collective->all_reduce_sum(stats, 2);
+        return pair<float, int>(stats[0], static_cast<int>(lround(stats[1])));
+    };
+
+    // --- Evaluation ---
+    // Validation and test metrics run on a background thread against a
+    // snapshot of the weights while training continues (VIT_EVAL_ASYNC=0
+    // evaluates inline instead). VIT_EVAL_EVERY=<steps> adds evaluations
+    // every that many optimizer steps on top of the one after each epoch.
+    const char *eval_every_env = getenv("VIT_EVAL_EVERY");
+    const char *eval_async_env = getenv("VIT_EVAL_ASYNC");
+    long eval_every = eval_every_env != nullptr ? max(0, atoi(eval_every_env)) : 0;
+    unique_ptr<BackgroundEvaluator> evaluator;
+    if (rank == 0 && (eval_async_env == nullptr || string(eval_async_env) != "0"))
+        evaluator = make_unique<BackgroundEvaluator>(vit, val_images, val_labels, test_images, test_labels);
+    vector<EvalResult> eval_results;
+    auto evaluate = [&](int epoch, long step, bool end_of_epoch)
+    {
+        if (rank != 0)
+            return;
+        if (evaluator)
+        {
+            evaluator->submit(vit, epoch, step, end_of_epoch);
+            return;
+        }
+        EvalResult result = BackgroundEvaluator::evaluate(vit, val_images, val_labels, test_images, test_labels);
+        result.epoch = epoch;
+        result.step = step;
+        result.end_of_epoch = end_of_epoch;
+        eval_results.push_back(result);
+    };
+    auto report_evaluations = [&]()
+    {
+        if (evaluator)
+        {
+            for (const EvalResult &result : evaluator->poll())
+                eval_results.push_back(result);
+        }
+        for (const EvalResult &result : eval_results)
+            print_eval_result(result);
+        eval_results.clear();
+    };
 
     // --- Training Loop ---
     cout << "Entrenando..." << endl;
-    for (int epoch = 0; epoch < epochs; epoch++)
+    for (int epoch = start_epoch; epoch < epochs; epoch++)
     {
         float train_loss = 0.0f;
         int train_correct = 0;
+        int batch_count = 0;
+        size_t first_batch = 0;
         vector<int> train_indices(train_images.size());
-        iota(train_indices.begin(), train_indices.end(), 0);
-        shuffle(train_indices.begin(), train_indices.end(), Random::gen);
+        if (resumed && epoch == start_epoch && !resume_state.permutation.empty())
+        {
+            // Mid-epoch checkpoint: its RNG state is already past this
+            // epoch's shuffle.
+            train_indices = resume_state.permutation;
+            train_loss = resume_state.progress.train_loss;
+            train_correct = resume_state.progress.train_correct;
+            batch_count = resume_state.progress.batch_count;
+            first_batch = resume_state.progress.batch_start;
+        }
+        else
+        {
+            iota(train_indices.begin(), train_indices.end(), 0);
+            Random::shuffle(train_indices);
+        }
 
-        int batch_count = 0;
         int total_batches = ceil((float)train_indices.size() / batch_size);
+        long step = static_cast<long>(epoch) * total_batches + batch_count;
 
         cout << "Epoch " << epoch + 1 << "/" << epochs << endl;
-        for (size_t batch_start = 0; batch_start < train_indices.size(); batch_start += batch_size)
+        for (size_t batch_start = first_batch; batch_start < train_indices.size(); batch_start += batch_size)
         {
             vit.zero_grad();
             size_t batch_end = min(batch_start + batch_size, train_indices.size());
 
-            for (size_t i = batch_start; i < batch_end; ++i)
+            // Each process takes every world_size-th sample of the batch.
+            for (size_t i = batch_start + rank; i < batch_end; i += world_size)
             {
+                if (reducer && i + world_size >= batch_end)
+                    vit.on_gradients_ready = [&](int bucket)
+                    { reducer->submit(gradient_buckets[bucket]); };
                 int idx = train_indices[i];
-                Tensor logits = vit.forward(train_images[idx]);
-                vit.backward(train_labels[idx]);
-                train_loss += vit.compute_loss(logits, train_labels[idx]);
-                if (vit.predict(train_images[idx]) == train_labels[idx])
+                StepResult step = vit.train_step(train_images[idx], train_labels[idx]);
+                train_loss += step.loss;
+                if (step.prediction == train_labels[idx])
                     train_correct++;
             }
+            if (reducer)
+            {
+                // A process with no sample in this batch still contributes
+                // its zero gradients.
+                if (!vit.on_gradients_ready)
+                {
+                    for (const vector<Tensor *> &bucket : gradient_buckets)
+                        reducer->submit(bucket);
+                }
+                vit.on_gradients_ready = nullptr;
+                try
+                {
+                    reducer->wait();
+                }
+                catch (const exception &e)
+                {
+                    cerr << "\n❌ Error de comunicación entre procesos: " << e.what() << endl;
+                    return 1;
+                }
+            }
 
             vit.update_weights(learning_rate);
             batch_count++;
+            step++;
             printProgressBar(batch_count, total_batches);
-        }
-        cout << endl;
 
-        // --- Validation Step ---
-        float val_loss = 0.0f;
-        int val_correct = 0;
-        if (!val_images.empty())
-        {
-            for (size_t i = 0; i < val_images.size(); i++)
+            if (eval_every > 0 && step % eval_every == 0 && batch_end < train_indices.size())
+                evaluate(epoch, step, false);
+
+            if (checkpoint_env != nullptr && batch_count % checkpoint_every == 0 && batch_end < train_indices.size())
             {
-                Tensor logits = vit.forward(val_images[i]);
-                val_loss += vit.compute_loss(logits, val_labels[i]);
-                if (vit.predict(val_images[i]) == val_labels[i])
-                    val_correct++;
+                auto [loss_so_far, correct_so_far] = global_stats(train_loss, train_correct);
+                TrainingProgress progress{epoch, batch_count, batch_end, loss_so_far, correct_so_far};
+                if (checkpointer)
+                    checkpointer->submit(vit, progress, train_indices);
             }
         }
+        cout << endl;
 
-        float avg_train_loss = train_images.empty() ? 0 : train_loss / train_images.size();
-        float train_acc = train_images.empty() ? 0 : (float)train_correct / train_images.size();
-        float avg_val_loss = val_images.empty() ? 0 : val_loss / val_images.size();
-        float val_acc = val_images.empty() ? 0 : (float)val_correct / val_images.size();
+        // --- Validation Step ---
+        evaluate(epoch, step, true);
+
+        auto [epoch_loss, epoch_correct] = global_stats(train_loss, train_correct);
+        float avg_train_loss = train_images.empty() ? 0 : epoch_loss / train_images.size();
+        float train_acc = train_images.empty() ? 0 : (float)epoch_correct / train_images.size();
 
         cout << "  Entrenamiento - Pérdida: " << fixed << setprecision(4) << avg_train_loss
              << " | Precisión: " << setprecision(2) << train_acc * 100 << "%" << endl;
-        cout << "  Validación    - Pérdida: " << fixed << setprecision(4) << avg_val_loss
-             << " | Precisión: " << setprecision(2) << val_acc * 100 << "%" << endl
-             << endl;
+        report_evaluations();
+        cout << endl;
+
+        if (checkpointer)
+            checkpointer->submit(vit, TrainingProgress{epoch + 1}, {});
     }
+    if (evaluator)
+    {
+        evaluator->flush();
+        report_evaluations();
+    }
+    if (checkpointer)
+    {
+        checkpointer->flush();
+        cout << "Checkpoints escritos en " << checkpoint_env << ": " << checkpointer->written();
+        if (checkpointer->failed() > 0)
+            cout << " (" << checkpointer->failed() << " fallidos)";
+        cout << endl;
+    }
+
+    if (rank != 0)
+        return 0;
 
     // --- Final Evaluation ---
     cout << "\nEvaluación final en conjunto de prueba:" << endl;
     int test_correct = 0;
     float test_loss = 0.0f;
+    vector<int> exit_correct(vit.exit_heads.size(), 0);
     for (size_t i = 0; i < test_images.size(); i++)
     {
-        Tensor logits = vit.forward(test_images[i]);
-        test_loss += vit.compute_loss(logits, test_labels[i]);
-        int predicted = vit.predict(test_images[i]);
+        StepResult step = vit.eval_step(test_images[i], test_labels[i]);
+        test_loss += step.loss;
+        int predicted = step.prediction;
         if (predicted == test_labels[i])
             test_correct++;
+        for (size_t e = 0; e < exit_correct.size(); e++)
+        {
+            if (Activation::argmax(vit.last_exit_logits[e]) == test_labels[i])
+                exit_correct[e]++;
+        }
 
         if (i < 15) // Show a few more examples
         {
@@ -248,6 +412,11 @@ int main(int argc, char *argv[])
     cout << "\nResultados finales:" << endl;
     cout << "- Pérdida: " << fixed << setprecision(4) << test_loss / test_images.size()
          << " | Precisión: " << setprecision(2) << (float)test_correct / test_images.size() * 100 << "%" << endl;
+    for (size_t e = 0; e < exit_correct.size(); e++)
+    {
+        cout << "- Salida temprana tras bloque " << e + 1 << " | Precisión: " << setprecision(2)
+             << (float)exit_correct[e] / test_images.size() * 100 << "%" << endl;
+    }
 
     // --- Save Model ---
     auto now = std::chrono::system_clock::now();
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "../include/core/gemm_tuner.h"
+#include "../include/core/half.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+
+using namespace std;
+
+// Times every GEMM variant for each matrix shape of a model (a checkpoint,
+// or a d_model / layer count on the 28x28 / patch 4 layout) and stores the
+// winners in the per-CPU tuning cache, retuning shapes already there.
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin | d_model capas> [f32|f16|bf16]" << endl;
+        cerr << "  Mide las variantes de GEMM para cada forma de matriz del modelo y guarda" << endl;
+        cerr << "  las más rápidas en " << GemmTuner::cache_path() << " (VIT_GEMM_TUNING)." << endl;
+        return 1;
+    }
+    if (!GemmTuner::enabled())
+    {
+        cerr << "Error: el ajuste de GEMM está desactivado (VIT_GEMM_TUNING=off)." << endl;
+        return 1;
+    }
+
+    string first = argv[1];
+    bool from_config = first.find_first_not_of("0123456789") == string::npos && argc >= 3;
+    WeightDType dtype = WeightDType::F32;
+    const char *dtype_arg = from_config ? (argc > 3 ? argv[3] : nullptr) : (argc > 2 ? argv[2] : nullptr);
+    if (dtype_arg != nullptr && !parse_dtype(dtype_arg, dtype))
+    {
+        cerr << "Error: tipo de pesos desconocido: " << dtype_arg << endl;
+        return 1;
+    }
+
+    int d_model = from_config ? stoi(argv[1]) : 64;
+    int num_layers = from_config ? stoi(argv[2]) : 2;
+    VisionTransformer vit(28, 4, d_model, num_layers, 10);
+    if (!from_config)
+    {
+        try
+        {
+            vit.load_model(first);
+        }
+        catch (const exception &e)
+        {
+            cerr << "Error al cargar el modelo desde " << first << ": " << e.what() << endl;
+            return 1;
+        }
+        if (dtype_arg == nullptr)
+            dtype = vit.checkpoint_dtype;
+    }
+    vit.set_training(false);
+    vit.prepack_weights(dtype);
+
+    vector<GemmShape> shapes = vit.gemm_shapes();
+    if (CompiledVisionTransformer::supports(vit))
+    {
+        vector<GemmShape> compiled = CompiledVisionTransformer::compile(vit, dtype).gemm_shapes();
+        shapes.insert(shapes.end(), compiled.begin(), compiled.end());
+    }
+
+    cout << "CPU: " << GemmTuner::cpu_key() << endl;
+    cout << setw(6) << "m" << setw(6) << "k" << setw(6) << "n" << setw(6) << "tipo" << setw(10) << "sitio" << setw(14) << "por defecto"
+         << setw(12) << "ajustado" << setw(10) << "speedup" << "  mr bloque hilos" << endl;
+    for (const GemmTuneResult &r : GemmTuner::tune(shapes, true))
+    {
+        cout << setw(6) << r.shape.m << setw(6) << r.shape.k << setw(6) << r.shape.n << setw(6) << dtype_name(r.shape.dtype)
+             << setw(10) << site_name(r.shape.site)
+             << fixed << setprecision(2) << setw(13) << r.default_gflops << setw(12) << r.tuned_gflops << setw(9)
+             << r.tuned_gflops / r.default_gflops << "x" << setw(4) << r.config.mr << setw(7) << r.config.row_block
+             << setw(6) << r.config.threads << endl;
+    }
+    cout << "(GFLOP/s)" << endl;
+
+    if (!GemmTuner::save(GemmTuner::cache_path()))
+    {
+        cerr << "Error: no se pudo guardar " << GemmTuner::cache_path() << endl;
+        return 1;
+    }
+    cout << GemmTuner::size() << " formas para esta CPU guardadas en " << GemmTuner::cache_path() << endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+
+using namespace std;
+
+// Per-sample containers against rank-3 batched tensors for the three
+// batch-shaped steps of a forward pass: adding the position embeddings,
+// the token projection with its bias, and patch extraction. Both sides
+// must give the same values bit for bit.
+// Uso: bench_batched.out [lote] [tokens] [d_model] [repeticiones]
+
+template <typename F>
+double time_ms(F body, int repeats)
+{
+    body();
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        body();
+    }
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+}
+
+float max_diff(const vector<Tensor> &samples, const Tensor &batch)
+{
+    float diff = 0.0f;
+    for (size_t b = 0; b < samples.size(); b++)
+    {
+        Tensor row = batch.select(0, b).contiguous();
+        for (size_t i = 0; i < row.numel(); i++)
+            diff = max(diff, fabs(samples[b].values()[i] - row.values()[i]));
+    }
+    return diff;
+}
+
+void report(const string &name, double per_sample, double batched, float diff)
+{
+    cout << setw(26) << name << fixed << setprecision(3) << setw(12) << per_sample << setw(12) << batched
+         << setw(9) << setprecision(2) << per_sample / batched << "x" << setw(11) << scientific << setprecision(1)
+         << diff << fixed << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int batch = argc > 1 ? stoi(argv[1]) : 64;
+    int tokens = argc > 2 ? stoi(argv[2]) : 50;
+    int d_model = argc > 3 ? stoi(argv[3]) : 64;
+    int repeats = argc > 4 ? stoi(argv[4]) : 20;
+
+    Random::seed(42);
+    vector<Tensor> samples(batch, Tensor(tokens, d_model));
+    for (Tensor &x : samples)
+    {
+        Random::fill_uniform(x.data.data(), x.data.size());
+    }
+    Tensor x = Tensor::stack(samples);
+    Tensor positions(tokens, d_model), weight(d_model, d_model), bias(vector<int>{d_model});
+    positions.xavier_init();
+    weight.xavier_init();
+    bias.xavier_init();
+
+    cout << "Lote [" << batch << ", " << tokens << ", " << d_model << "] frente a " << batch << " tensores [" << tokens
+         << ", " << d_model << "] (ms)" << endl;
+    cout << setw(25) << "paso" << setw(12) << "por muestra" << setw(12) << "en lote" << setw(10) << "speedup"
+         << setw(12) << "dif. máx" << endl;
+
+    vector<Tensor> embedded;
+    double loop = time_ms([&]
+                          { embedded = samples;
+                            for (Tensor &s : embedded) s += positions; }, repeats);
+    Tensor embedded_batch;
+    double batched = time_ms([&]
+                             { embedded_batch = x;
+                               embedded_batch.broadcast_add(positions); }, repeats);
+    report("+ embeddings de posición", loop, batched, max_diff(embedded, embedded_batch));
+
+    vector<Tensor> projected(batch);
+    loop = time_ms([&]
+                   {
+        for (int b = 0; b < batch; b++)
+        {
+            projected[b] = samples[b] * weight;
+            for (int t = 0; t < tokens; t++)
+                for (int j = 0; j < d_model; j++)
+                    projected[b](t, j) += bias.values()[j];
+        } }, repeats);
+    Tensor projected_batch;
+    batched = time_ms([&]
+                      { projected_batch = Tensor::matmul(x, weight);
+                        projected_batch.broadcast_add(bias); }, repeats);
+    report("matmul + término de sesgo", loop, batched, max_diff(projected, projected_batch));
+
+    // Patch extraction: the index loop image_to_patches used before against
+    // reshape / permute over a whole [batch, 28, 28] stack.
+    const int patch = 4, grid = 7;
+    vector<Tensor> images(batch, Tensor(28, 28));
+    for (Tensor &image : images)
+    {
+        Random::fill_uniform(image.data.data(), image.data.size());
+    }
+    Tensor image_batch = Tensor::stack(images);
+    vector<Tensor> patches(batch);
+    loop = time_ms([&]
+                   {
+        for (int b = 0; b < batch; b++)
+        {
+            patches[b] = Tensor(grid * grid, patch * patch);
+            for (int p = 0; p < grid * grid; p++)
+                for (int pi = 0; pi < patch; pi++)
+                    for (int pj = 0; pj < patch; pj++)
+                        patches[b](p, pi * patch + pj) = images[b]((p / grid) * patch + pi, (p % grid) * patch + pj);
+        } }, repeats);
+    Tensor patch_batch;
+    batched = time_ms([&]
+                      { patch_batch = image_batch.reshape({batch, grid, patch, grid, patch})
+                                          .permute({0, 1, 3, 2, 4})
+                                          .contiguous()
+                                          .reshape({batch, grid * grid, patch * patch}); }, repeats);
+    report("extracción de parches", loop, batched, max_diff(patches, patch_batch));
+
+    VisionTransformer vit(28, patch, d_model, 1, 10);
+    cout << "image_to_patches coincide con el bucle: "
+         << (max_diff({vit.image_to_patches(images[0])}, patch_batch.select(0, 0).reshape({1, grid * grid, patch * patch})) == 0.0f ? "sí" : "NO")
+         << endl;
+    return 0;
+}
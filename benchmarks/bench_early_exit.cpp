@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/core/activation.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+// Early-exit inference on a labelled test set: accuracy, average latency and
+// the distribution of exit depths for a sweep of confidence thresholds,
+// against full-depth inference. The model must have been trained with
+// VIT_EXIT_HEADS=1.
+// Uso: bench_early_exit.out <modelo.bin> <test.csv> [muestras]
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin> <test.csv> [muestras]" << endl;
+        return 1;
+    }
+    int max_samples = argc > 3 ? stoi(argv[3]) : -1;
+
+    Random::seed(42);
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    vit.load_model(argv[1]);
+    if (!vit.has_exit_heads())
+    {
+        cerr << "Error: el modelo no tiene cabezas de salida temprana (entrenar con VIT_EXIT_HEADS=1)." << endl;
+        return 1;
+    }
+    vit.set_training(false);
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+
+    auto [images, labels] = DataLoader::load_data(argv[2], max_samples);
+    if (images.empty())
+        return 1;
+
+    // A threshold above 1 never fires: full-depth inference.
+    const vector<float> thresholds = {2.0f, 0.99f, 0.9f, 0.8f, 0.6f, 0.4f, 0.2f, 0.0f};
+
+    cout << left << setw(10) << "umbral" << right << setw(12) << "precisión" << setw(12) << "us/imagen"
+         << setw(10) << "speedup" << "   salidas por bloque" << endl;
+
+    double full_us = 0.0;
+    for (float threshold : thresholds)
+    {
+        ExitPolicy exits;
+        exits.thresholds.assign(vit.exit_heads.size(), threshold);
+
+        for (int i = 0; i < 10; i++)
+        {
+            compiled.forward(images[i % images.size()], TokenReduction(), exits);
+        }
+        vector<int> exit_counts(vit.num_layers + 1, 0);
+        int correct = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            int blocks_run = 0;
+            Tensor logits = compiled.forward(images[i], TokenReduction(), exits, &blocks_run);
+            exit_counts[blocks_run]++;
+            if (Activation::argmax(logits) == labels[i])
+                correct++;
+        }
+        auto end = chrono::steady_clock::now();
+        double us = chrono::duration<double, micro>(end - start).count() / images.size();
+        if (full_us == 0.0)
+            full_us = us;
+
+        string distribution;
+        for (int l = 1; l <= vit.num_layers; l++)
+        {
+            ostringstream share;
+            share << fixed << setprecision(1) << 100.0 * exit_counts[l] / images.size();
+            distribution += (l > 1 ? "  " : "") + to_string(l) + ":" + share.str() + "%";
+        }
+
+        cout << left << setw(10) << (threshold > 1.0f ? "completo" : to_string(threshold).substr(0, 4)) << right
+             << fixed << setprecision(2) << setw(11) << 100.0 * correct / images.size() << "%"
+             << setw(12) << us << setw(9) << full_us / us << "x" << "   " << distribution << endl;
+    }
+    return 0;
+}
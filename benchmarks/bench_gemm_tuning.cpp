@@ -0,0 +1,82 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../include/core/gemm_tuner.h"
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+
+using namespace std;
+
+// Forward latency of the compiled model and of the prepacked Linear path
+// with the default GEMM config against configs retuned in this run (the
+// on-disk cache is not written). Tuned and default logits must match bit
+// for bit.
+// Uso: bench_gemm_tuning.out [d_model] [num_layers] [imágenes]
+int main(int argc, char *argv[])
+{
+    int d_model = argc > 1 ? stoi(argv[1]) : 128;
+    int num_layers = argc > 2 ? stoi(argv[2]) : 4;
+    int num_images = argc > 3 ? stoi(argv[3]) : 200;
+
+    Random::seed(42);
+    VisionTransformer vit(28, 4, d_model, num_layers, 10);
+    vit.set_training(false);
+    vit.prepack_weights();
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+    vector<Tensor> images(num_images, Tensor(28, 28));
+    for (Tensor &image : images)
+    {
+        Random::fill_uniform(image.data.data(), image.data.size());
+    }
+
+    auto time_path = [&](bool use_compiled, vector<Tensor> &logits)
+    {
+        logits.clear();
+        auto start = chrono::steady_clock::now();
+        for (const Tensor &image : images)
+        {
+            logits.push_back(use_compiled ? compiled.forward(image) : vit.forward(image));
+        }
+        return 1000.0 * chrono::duration<double>(chrono::steady_clock::now() - start).count() / num_images;
+    };
+
+    vector<GemmShape> shapes = vit.gemm_shapes(), compiled_shapes = compiled.gemm_shapes();
+    shapes.insert(shapes.end(), compiled_shapes.begin(), compiled_shapes.end());
+    auto start = chrono::steady_clock::now();
+    vector<GemmTuneResult> results = GemmTuner::tune(shapes, true);
+    double tuning_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Ajuste de GEMM en " << GemmTuner::cpu_key() << ": " << results.size() << " formas en " << fixed
+         << setprecision(2) << tuning_seconds << " s (d_model " << d_model << ", capas " << num_layers << ")" << endl;
+    cout << setw(22) << "ruta" << setw(16) << "por defecto ms" << setw(14) << "ajustado ms" << setw(10) << "speedup"
+         << setw(12) << "idénticos" << endl;
+    for (bool use_compiled : {true, false})
+    {
+        vector<Tensor> reference, tuned;
+        GemmTuner::set_enabled(false);
+        compiled.resolve_gemm_configs();
+        time_path(use_compiled, reference);
+        double base = time_path(use_compiled, reference);
+        GemmTuner::set_enabled(true);
+        compiled.resolve_gemm_configs();
+        time_path(use_compiled, tuned);
+        double fast = time_path(use_compiled, tuned);
+        bool identical = true;
+        for (int i = 0; i < num_images; i++)
+        {
+            identical = identical && equal(reference[i].values(), reference[i].values() + reference[i].numel(), tuned[i].values());
+        }
+        // setw counts bytes; "idénticos" above has one two-byte character.
+        cout << setw(22) << (use_compiled ? "modelo compilado" : "Linear preempaquetado") << setprecision(3) << setw(16)
+             << base << setw(14) << fast << setw(9) << setprecision(2) << base / fast << "x" << setw(11)
+             << (identical ? "sí" : "NO") << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../include/core/gemm.h"
+#include "../include/core/memory.h"
+#include "../include/core/parallel.h"
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/core/topology.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+
+using namespace std;
+
+// Memory placement: 4 KB vs 2 MB pages for a weight-streaming GEMV and a
+// TLB-bound random gather, then batch inference with one shared compiled
+// model vs one replica per NUMA node.
+//
+// On a single-socket host, simulate the layout with VIT_NUMA_NODES=2, or
+// measure remote access with numactl, e.g.
+//   numactl --cpunodebind=0 --membind=1 build/bench_numa.out
+//   VIT_PIN_THREADS=scatter numactl --interleave=all build/bench_numa.out
+// Uso: bench_numa.out [MB_buffer] [iteraciones] [d_model num_layers]
+
+double time_gemv(const PackedMatrix &w, const vector<float> &x, vector<float> &y, int iterations)
+{
+    gemm_packed(x.data(), 1, w.cols, w, nullptr, y.data(), w.rows, GemmConfig());
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        gemm_packed(x.data(), 1, w.cols, w, nullptr, y.data(), w.rows, GemmConfig());
+    }
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / iterations;
+}
+
+volatile uint64_t gather_sink;
+
+// Dependent loads at pseudo-random offsets over the whole buffer: with 4 KB
+// pages nearly every one misses the TLB.
+double time_gather(const vector<uint32_t, HugePageAllocator<uint32_t>> &buffer, int iterations)
+{
+    const size_t n = buffer.size();
+    uint32_t index = 0;
+    uint64_t sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        index = (buffer[index] + static_cast<uint32_t>(i) * 1031u) % n;
+        sum += index;
+    }
+    gather_sink = sum;
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    int buffer_mb = argc > 1 ? stoi(argv[1]) : 256;
+    int iterations = argc > 2 ? stoi(argv[2]) : 50;
+    int d_model = argc > 3 ? stoi(argv[3]) : 256;
+    int num_layers = argc > 4 ? stoi(argv[4]) : 4;
+
+    cout << "Topología: " << Topology::describe() << endl;
+    cout << "Hilos: " << Parallel::num_threads() << endl;
+
+    // Square weight of at most a quarter of the gather buffer.
+    int side = 512;
+    while (static_cast<size_t>(side * 2) * side * 2 * sizeof(float) <= static_cast<size_t>(buffer_mb) * 1024 * 1024 / 4)
+    {
+        side *= 2;
+    }
+    Random::seed(42);
+    Tensor weight(side, side);
+    Random::fill_uniform(weight.data.data(), weight.data.size());
+    vector<float> x(side, 1.0f), y(side);
+
+    vector<Memory::HugePages> modes = {Memory::HugePages::Off, Memory::HugePages::Transparent};
+    if (Memory::huge_pages() == Memory::HugePages::HugeTLB)
+        modes.push_back(Memory::HugePages::HugeTLB);
+
+    cout << "\nPáginas de memoria (GEMV " << side << "x" << side << ", recorrido aleatorio de " << buffer_mb << " MB)" << endl;
+    cout << left << setw(10) << "modo" << right << setw(14) << "huge MB" << setw(14) << "GEMV ms" << setw(12) << "GB/s"
+         << setw(16) << "ns/acceso" << endl;
+    for (Memory::HugePages mode : modes)
+    {
+        Memory::set_huge_pages(mode);
+        long before = Memory::huge_page_bytes();
+        PackedMatrix packed;
+        packed.pack(weight);
+        vector<uint32_t, HugePageAllocator<uint32_t>> buffer(static_cast<size_t>(buffer_mb) * 1024 * 1024 / sizeof(uint32_t));
+        for (size_t i = 0; i < buffer.size(); i++)
+        {
+            buffer[i] = static_cast<uint32_t>((i * 2654435761u) % buffer.size());
+        }
+        long huge = Memory::huge_page_bytes() - before;
+
+        double ms = time_gemv(packed, x, y, iterations);
+        double ns = time_gather(buffer, 2000000);
+        cout << left << setw(10) << Memory::huge_pages_name(mode) << right << fixed << setprecision(1)
+             << setw(14) << huge / (1024.0 * 1024.0) << setprecision(3) << setw(14) << ms
+             << setprecision(2) << setw(12) << packed.bytes() / ms / 1e6 << setw(16) << ns << endl;
+    }
+
+    // Batch inference over a model larger than L2.
+    Memory::set_huge_pages(Memory::HugePages::Transparent);
+    VisionTransformer vit(28, 4, d_model, num_layers, 10);
+    vit.set_training(false);
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+    ReplicatedModel replicas(compiled);
+    vector<Tensor> images(512, Tensor(28, 28));
+    for (Tensor &image : images)
+    {
+        Random::fill_uniform(image.data.data(), image.data.size());
+    }
+
+    cout << "\nInferencia por lotes (d_model " << d_model << ", capas " << num_layers << ", pesos "
+         << compiled.weight_bytes() / 1024 << " KB, " << images.size() << " imágenes)" << endl;
+    cout << left << setw(22) << "modelo" << right << setw(17) << "imágenes/s" << endl;
+    for (bool replicated : {false, true})
+    {
+        vector<Tensor> logits(images.size());
+        auto run = [&]()
+        {
+            Parallel::parallel_for(0, images.size(), 1, [&](int begin, int end)
+                                   {
+                const CompiledVisionTransformer &model = replicated ? replicas.local() : compiled;
+                for (int i = begin; i < end; i++)
+                {
+                    logits[i] = model.forward(images[i]);
+                } });
+        };
+        run();
+        auto start = chrono::steady_clock::now();
+        int rounds = 3;
+        for (int r = 0; r < rounds; r++)
+        {
+            run();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        string name = replicated ? "réplica por nodo (" + to_string(replicas.num_replicas()) + ")" : "compartido";
+        // setw counts bytes; pad the accented labels by hand.
+        cout << left << setw(replicated ? 23 : 22) << name << right << setw(16) << fixed << setprecision(1)
+             << rounds * images.size() / seconds << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/core/parallel.h"
+#include "../include/model/vit.h"
+
+using namespace std;
+
+// Single-image forward latency as the intra-op thread count grows.
+// Uso: bench_parallel.out [max_threads] [iteraciones] [image_size patch_size d_model num_layers]
+int main(int argc, char *argv[])
+{
+    int max_threads = argc > 1 ? stoi(argv[1]) : max(1u, thread::hardware_concurrency());
+    int iterations = argc > 2 ? stoi(argv[2]) : 200;
+    int image_size = argc > 3 ? stoi(argv[3]) : 28;
+    int patch_size = argc > 4 ? stoi(argv[4]) : 4;
+    int d_model = argc > 5 ? stoi(argv[5]) : 64;
+    int num_layers = argc > 6 ? stoi(argv[6]) : 2;
+    int num_classes = 10;
+
+    Random::seed(42);
+    VisionTransformer vit(image_size, patch_size, d_model, num_layers, num_classes);
+    Tensor image(image_size, image_size);
+    for (float &v : image.data)
+    {
+        v = Random::uniform(0.0f, 1.0f);
+    }
+
+    cout << "Latencia de inferencia por imagen (" << image_size << "x" << image_size
+         << ", patch " << patch_size << ", d_model " << d_model << ", capas " << num_layers << ")" << endl;
+    cout << setw(8) << "hilos" << setw(14) << "ms/imagen" << setw(12) << "speedup" << endl;
+
+    double baseline_ms = 0.0;
+    for (int threads = 1; threads <= max_threads; threads++)
+    {
+        Parallel::set_num_threads(threads);
+        for (int i = 0; i < 10; i++)
+        {
+            vit.forward(image);
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            vit.forward(image);
+        }
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count() / iterations;
+        if (threads == 1)
+            baseline_ms = ms;
+
+        cout << setw(8) << threads << setw(14) << fixed << setprecision(4) << ms
+             << setw(11) << setprecision(2) << baseline_ms / ms << "x" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/core/parallel.h"
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/model/pipeline.h"
+
+using namespace std;
+
+// Streaming throughput of the pipeline engine for 1..max_stages stages
+// against the single-threaded compiled forward, with the auto-balanced op
+// ranges and the utilization of every stage.
+// Uso: bench_pipeline.out [max_stages] [imágenes] [d_model num_layers] [micro_batch]
+int main(int argc, char *argv[])
+{
+    int max_stages = argc > 1 ? stoi(argv[1]) : max(2u, thread::hardware_concurrency());
+    int num_images = argc > 2 ? stoi(argv[2]) : 512;
+    int d_model = argc > 3 ? stoi(argv[3]) : 128;
+    int num_layers = argc > 4 ? stoi(argv[4]) : 4;
+    int micro_batch = argc > 5 ? stoi(argv[5]) : 4;
+
+    Random::seed(42);
+    VisionTransformer vit(28, 4, d_model, num_layers, 10);
+    vit.set_training(false);
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+    vector<Tensor> images(num_images, Tensor(28, 28));
+    for (Tensor &image : images)
+    {
+        Random::fill_uniform(image.data.data(), image.data.size());
+    }
+
+    Parallel::set_thread_budget(1);
+    vector<Tensor> reference;
+    auto start = chrono::steady_clock::now();
+    for (const Tensor &image : images)
+    {
+        reference.push_back(compiled.forward(image));
+    }
+    double serial = num_images / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    Parallel::set_thread_budget(0);
+
+    cout << "Inferencia en pipeline (d_model " << d_model << ", capas " << num_layers << ", " << compiled.ops.size()
+         << " ops, " << num_images << " imágenes, micro-lote " << micro_batch << ")" << endl;
+    cout << "Un hilo: " << fixed << setprecision(1) << serial << " imágenes/s" << endl;
+    cout << setw(8) << "etapas" << setw(15) << "imágenes/s" << setw(10) << "speedup" << setw(12) << "dif. máx"
+         << "  etapas: ops [inicio, fin) y utilización" << endl;
+
+    for (int stages = 1; stages <= max_stages; stages++)
+    {
+        PipelineOptions options;
+        options.num_stages = stages;
+        options.micro_batch = micro_batch;
+        PipelineEngine engine(compiled, options, images[0]);
+        engine.run(vector<Tensor>(images.begin(), images.begin() + min(num_images, 4 * micro_batch)));
+
+        PipelineStats stats;
+        vector<Tensor> logits = engine.run(images, &stats);
+        float diff = 0.0f;
+        for (int i = 0; i < num_images; i++)
+        {
+            for (int j = 0; j < logits[i].cols; j++)
+                diff = max(diff, fabs(logits[i](0, j) - reference[i](0, j)));
+        }
+
+        // setw counts bytes; "imágenes/s" above has one two-byte character.
+        cout << setw(8) << engine.num_stages() << setw(14) << setprecision(1) << stats.images_per_second()
+             << setw(9) << setprecision(2) << stats.images_per_second() / serial << "x"
+             << setw(12) << scientific << setprecision(1) << diff << fixed << " ";
+        for (const StageStats &stage : stats.stages)
+        {
+            cout << " [" << stage.first_op << "," << stage.last_op << ") " << setprecision(0) << stage.utilization * 100 << "%";
+        }
+        cout << endl;
+    }
+    return 0;
+}
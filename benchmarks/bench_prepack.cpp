@@ -0,0 +1,83 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/linear.h"
+#include "../include/model/vit.h"
+
+using namespace std;
+
+// Steady-state latency of every Linear in the model, with the row-major
+// weight versus the prepacked panel layout.
+// Uso: bench_prepack.out [modelo.bin] [iteraciones]
+
+double time_forward_us(Linear &layer, const Tensor &input, int iterations)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        layer.forward(input);
+    }
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        layer.forward(input);
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 2 ? stoi(argv[2]) : 2000;
+
+    Random::seed(42);
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    if (argc > 1)
+        vit.load_model(argv[1]);
+    vit.set_training(false);
+
+    int tokens = vit.num_patches + 1;
+    vector<pair<string, Linear *>> layers;
+    layers.push_back({"patch_embedding", &vit.patch_embedding});
+    for (int i = 0; i < vit.num_layers; i++)
+    {
+        string prefix = "block_" + to_string(i) + ".";
+        layers.push_back({prefix + "attention_proj", &vit.transformer_blocks[i]->attention_proj});
+        layers.push_back({prefix + "mlp.fc1", &vit.transformer_blocks[i]->mlp.fc1});
+        layers.push_back({prefix + "mlp.fc2", &vit.transformer_blocks[i]->mlp.fc2});
+    }
+    layers.push_back({"classification_head", &vit.classification_head});
+
+    cout << left << setw(24) << "capa" << right << setw(12) << "forma" << setw(16) << "fila-major us"
+         << setw(16) << "empaquetado us" << setw(10) << "ahorro" << endl;
+
+    double total_plain = 0.0, total_packed = 0.0;
+    for (auto &[name, layer] : layers)
+    {
+        int rows = layer == &vit.classification_head ? 1 : (layer == &vit.patch_embedding ? vit.num_patches : tokens);
+        Tensor input(rows, layer->weight.cols);
+        for (float &v : input.data)
+        {
+            v = Random::randn(0.0f, 1.0f);
+        }
+
+        layer->packed_weight.clear();
+        double plain = time_forward_us(*layer, input, iterations);
+        layer->prepack();
+        double packed = time_forward_us(*layer, input, iterations);
+        total_plain += plain;
+        total_packed += packed;
+
+        string shape = to_string(rows) + "x" + to_string(layer->weight.cols) + "->" + to_string(layer->weight.rows);
+        cout << left << setw(24) << name << right << setw(12) << shape << fixed << setprecision(2)
+             << setw(16) << plain << setw(16) << packed
+             << setw(9) << (1.0 - packed / plain) * 100.0 << "%" << endl;
+    }
+    cout << left << setw(36) << "total" << right << fixed << setprecision(2) << setw(16) << total_plain
+         << setw(16) << total_packed << setw(9) << (1.0 - total_packed / total_plain) * 100.0 << "%" << endl;
+    return 0;
+}
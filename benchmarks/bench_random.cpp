@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/core/parallel.h"
+#include "../include/core/random.h"
+
+using namespace std;
+
+// Normal fill throughput: one std::normal_distribution per element over a
+// global mt19937 (the previous Random::randn) against the Philox bulk fill
+// as the thread count grows. Also checks that the bulk fill gives the same
+// values for every thread count.
+// Uso: bench_random.out [elementos] [max_threads]
+
+template <typename F>
+double time_ms(F fill, int repeats = 5)
+{
+    fill();
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        fill();
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / repeats;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = argc > 1 ? stoul(argv[1]) : 4000000;
+    int max_threads = argc > 2 ? stoi(argv[2]) : max(1u, thread::hardware_concurrency());
+    vector<float> data(n), reference(n);
+
+    mt19937 gen(42);
+    double legacy = time_ms([&]
+                            {
+        for (float &v : data)
+        {
+            normal_distribution<float> d(0.0f, 1.0f);
+            v = d(gen);
+        } });
+
+    cout << "Relleno normal de " << n << " elementos" << endl;
+    cout << left << setw(24) << "método" << right << setw(12) << "ms" << setw(14) << "Melem/s" << setw(12) << "idéntico" << endl;
+    cout << left << setw(24) << "mt19937 por elemento" << right << fixed << setprecision(2) << setw(12) << legacy
+         << setw(14) << n / legacy / 1000.0 << setw(12) << "-" << endl;
+
+    Parallel::set_num_threads(1);
+    Random::fill_normal(reference.data(), n, 0.0f, 1.0f, 42, 1);
+    for (int threads = 1; threads <= max_threads; threads++)
+    {
+        Parallel::set_num_threads(threads);
+        double ms = time_ms([&]
+                            { Random::fill_normal(data.data(), n, 0.0f, 1.0f, 42, 1); });
+        bool same = data == reference;
+        cout << left << setw(24) << ("philox, " + to_string(threads) + " hilo(s)") << right << setw(12) << ms
+             << setw(14) << n / ms / 1000.0 << setw(12) << (same ? "sí" : "NO") << endl;
+    }
+    return 0;
+}
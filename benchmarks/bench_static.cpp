@@ -0,0 +1,76 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/model/static_vit.h"
+
+using namespace std;
+
+// Per-image latency of the dynamic model, the compiled model and the
+// shape-specialized kernels for the same weights.
+// Uso: bench_static.out [modelo.bin] [iteraciones]
+
+double time_us(const function<void()> &run, int iterations)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        run();
+    }
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        run();
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 2 ? stoi(argv[2]) : 500;
+
+    Random::seed(42);
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    if (argc > 1)
+        vit.load_model(argv[1]);
+    else
+        vit.prepack_weights();
+    vit.set_training(false);
+
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+    unique_ptr<StaticModelBase> specialized = make_static_model(compiled);
+
+    Tensor image(vit.image_size, vit.image_size);
+    for (float &v : image.data)
+    {
+        v = Random::uniform(0.0f, 1.0f);
+    }
+
+    double dynamic_us = time_us([&]
+                                { vit.forward(image); }, iterations);
+    double compiled_us = time_us([&]
+                                 { compiled.forward(image); }, iterations);
+
+    cout << setw(28) << left << "ruta" << right << setw(14) << "us/imagen" << setw(12) << "speedup" << endl;
+    cout << fixed << setprecision(2);
+    cout << setw(28) << left << "dinámica (empaquetada)" << right << setw(14) << dynamic_us << setw(11) << 1.0 << "x" << endl;
+    cout << setw(28) << left << "compilada" << right << setw(14) << compiled_us << setw(11) << dynamic_us / compiled_us << "x" << endl;
+    if (specialized)
+    {
+        double static_us = time_us([&]
+                                   { specialized->forward(image); }, iterations);
+        cout << setw(28) << left << ("especializada " + specialized->config()) << right << setw(14) << static_us
+             << setw(11) << dynamic_us / static_us << "x" << endl;
+    }
+    else
+    {
+        cout << "Sin especialización para esta configuración." << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/vit.h"
+
+using namespace std;
+
+// Bytes of tensor data copied per training step (a batch of train_step
+// calls plus update_weights) with every Tensor copy deep, as before
+// copy-on-write storage, against shared copy-on-write buffers. Both runs
+// start from the same weights and must reach the same loss.
+// Uso: bench_tensor_copies.out [batch] [pasos] [d_model num_layers]
+
+struct Result
+{
+    double copied_per_step, shared_per_step, ms_per_step, loss;
+};
+
+Result run(bool copy_on_write, int batch, int steps, int d_model, int num_layers, const vector<Tensor> &images)
+{
+    Random::seed(42);
+    VisionTransformer vit(28, 4, d_model, num_layers, 10);
+    TensorStorage::set_copy_on_write(copy_on_write);
+
+    double loss = 0.0;
+    long long copied = 0, shared = 0;
+    double seconds = 0.0;
+    for (int step = -1; step < steps; step++)
+    {
+        TensorStorage::reset_counters();
+        auto start = chrono::steady_clock::now();
+        vit.zero_grad();
+        for (int i = 0; i < batch; i++)
+        {
+            int idx = ((step + 1) * batch + i) % images.size();
+            loss = vit.train_step(images[idx], idx % 10).loss;
+        }
+        vit.update_weights(0.01f);
+        // Step -1 warms up the allocator and is not counted.
+        if (step >= 0)
+        {
+            seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            copied += TensorStorage::bytes_copied();
+            shared += TensorStorage::bytes_shared();
+        }
+    }
+    TensorStorage::set_copy_on_write(true);
+    return {static_cast<double>(copied) / steps, static_cast<double>(shared) / steps, 1000.0 * seconds / steps, loss};
+}
+
+int main(int argc, char *argv[])
+{
+    int batch = argc > 1 ? stoi(argv[1]) : 32;
+    int steps = argc > 2 ? stoi(argv[2]) : 10;
+    int d_model = argc > 3 ? stoi(argv[3]) : 64;
+    int num_layers = argc > 4 ? stoi(argv[4]) : 4;
+
+    Random::seed(7);
+    vector<Tensor> images(batch * 4, Tensor(28, 28));
+    for (Tensor &image : images)
+    {
+        Random::fill_uniform(image.data.data(), image.data.size());
+    }
+
+    cout << "Copias de tensores por paso (lote " << batch << ", d_model " << d_model << ", capas " << num_layers << ")" << endl;
+    cout << setw(20) << "modo" << setw(16) << "KB copiados" << setw(16) << "KB compartidos" << setw(12) << "ms/paso"
+         << setw(13) << "pérdida" << endl;
+    Result deep = run(false, batch, steps, d_model, num_layers, images);
+    Result cow = run(true, batch, steps, d_model, num_layers, images);
+    for (auto [name, r] : {make_pair("copia profunda", deep), make_pair("copy-on-write", cow)})
+    {
+        cout << setw(20) << name << fixed << setprecision(1) << setw(16) << r.copied_per_step / 1024 << setw(16)
+             << r.shared_per_step / 1024 << setw(12) << setprecision(2) << r.ms_per_step << setw(12) << setprecision(4)
+             << r.loss << endl;
+    }
+    cout << "Bytes copiados por paso: " << setprecision(1) << deep.copied_per_step / 1024 << " KB -> "
+         << cow.copied_per_step / 1024 << " KB" << (deep.loss == cow.loss ? " (misma pérdida)" : " (¡PÉRDIDA DISTINTA!)") << endl;
+    return 0;
+}
@@ -0,0 +1,251 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/model/linear.h"
+#include "../include/model/linear_attention.h"
+#include "../include/model/vit.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+// Linear attention as a token mixer: a finite-difference check of its
+// backward pass, forward+backward time and activation memory against
+// softmax attention as the sequence grows, and, given MNIST CSVs, the test
+// accuracy of a short training run with and without mixing.
+// Uso: bench_token_mixing.out [max_tokens] [d_model] [cabezas] [train.csv test.csv [muestras] [épocas]]
+
+// Reference softmax attention with the same projections; keeps the
+// [heads, N, N] probabilities for backward.
+struct SoftmaxAttention
+{
+    Linear q_proj, k_proj, v_proj;
+    int num_heads;
+    vector<Tensor> q_heads, k_heads, v_heads, probabilities;
+
+    SoftmaxAttention(int d_model, int heads) : q_proj(d_model, d_model), k_proj(d_model, d_model), v_proj(d_model, d_model), num_heads(heads) {}
+
+    static Tensor head(const Tensor &x, int h, int hd)
+    {
+        Tensor out(x.rows, hd);
+        for (int t = 0; t < x.rows; t++)
+            copy(x.values() + static_cast<size_t>(t) * x.cols + h * hd, x.values() + static_cast<size_t>(t) * x.cols + (h + 1) * hd, out.values() + static_cast<size_t>(t) * hd);
+        return out;
+    }
+
+    static void scatter(Tensor &x, const Tensor &part, int h)
+    {
+        for (int t = 0; t < x.rows; t++)
+            copy(part.values() + static_cast<size_t>(t) * part.cols, part.values() + static_cast<size_t>(t + 1) * part.cols, x.values() + static_cast<size_t>(t) * x.cols + h * part.cols);
+    }
+
+    Tensor forward(const Tensor &input)
+    {
+        Tensor q = q_proj.forward(input), k = k_proj.forward(input), v = v_proj.forward(input);
+        const int hd = q.cols / num_heads;
+        const float scale = 1.0f / sqrt(static_cast<float>(hd));
+        Tensor out(input.rows, q.cols);
+        q_heads.assign(num_heads, Tensor());
+        k_heads = v_heads = probabilities = q_heads;
+        for (int h = 0; h < num_heads; h++)
+        {
+            q_heads[h] = head(q, h, hd);
+            k_heads[h] = head(k, h, hd);
+            v_heads[h] = head(v, h, hd);
+            Tensor scores = q_heads[h] * k_heads[h].transpose();
+            float *p = scores.values();
+            for (int i = 0; i < scores.rows; i++)
+            {
+                float *row = p + static_cast<size_t>(i) * scores.cols;
+                float peak = *max_element(row, row + scores.cols) * scale, sum = 0.0f;
+                for (int j = 0; j < scores.cols; j++)
+                    sum += row[j] = exp(row[j] * scale - peak);
+                for (int j = 0; j < scores.cols; j++)
+                    row[j] /= sum;
+            }
+            scatter(out, scores * v_heads[h], h);
+            probabilities[h] = move(scores);
+        }
+        return out;
+    }
+
+    Tensor backward(const Tensor &grad_output)
+    {
+        const int hd = grad_output.cols / num_heads;
+        const float scale = 1.0f / sqrt(static_cast<float>(hd));
+        Tensor grad_q(grad_output.rows, grad_output.cols), grad_k = grad_q, grad_v = grad_q;
+        for (int h = 0; h < num_heads; h++)
+        {
+            Tensor g = head(grad_output, h, hd);
+            const Tensor &p = probabilities[h];
+            scatter(grad_v, p.transpose() * g, h);
+            Tensor grad_scores = g * v_heads[h].transpose();
+            float *ds = grad_scores.values();
+            const float *pv = p.values();
+            for (int i = 0; i < p.rows; i++)
+            {
+                float dot = 0.0f;
+                for (int j = 0; j < p.cols; j++)
+                    dot += ds[static_cast<size_t>(i) * p.cols + j] * pv[static_cast<size_t>(i) * p.cols + j];
+                for (int j = 0; j < p.cols; j++)
+                    ds[static_cast<size_t>(i) * p.cols + j] = pv[static_cast<size_t>(i) * p.cols + j] * (ds[static_cast<size_t>(i) * p.cols + j] - dot) * scale;
+            }
+            scatter(grad_q, grad_scores * k_heads[h], h);
+            scatter(grad_k, grad_scores.transpose() * q_heads[h], h);
+        }
+        Tensor grad_input = q_proj.backward(grad_q);
+        grad_input += k_proj.backward(grad_k);
+        grad_input += v_proj.backward(grad_v);
+        return grad_input;
+    }
+};
+
+template <typename F>
+double time_ms(F body, int repeats)
+{
+    body();
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        body();
+    }
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeats;
+}
+
+// Relative error between backward() and central differences of
+// loss = sum(forward(x) * weights) for a few input entries and q weights.
+float gradient_check(int tokens, int d_model, int heads)
+{
+    LinearAttention mixer(d_model, heads);
+    Tensor x(tokens, d_model), weights(tokens, d_model);
+    x.xavier_init();
+    weights.xavier_init();
+    auto loss = [&]
+    {
+        Tensor out = mixer.forward(x);
+        double sum = 0.0;
+        for (size_t i = 0; i < out.numel(); i++)
+            sum += static_cast<double>(out.values()[i]) * weights.values()[i];
+        return sum;
+    };
+    mixer.zero_grad();
+    loss();
+    Tensor grad_input = mixer.backward(weights);
+    Tensor grad_q_weight = mixer.q_proj.weight_grad;
+
+    const float h = 1e-2f;
+    float worst = 0.0f;
+    auto compare = [&](float &value, float analytic)
+    {
+        float saved = value;
+        value = saved + h;
+        double up = loss();
+        value = saved - h;
+        double down = loss();
+        value = saved;
+        float numeric = static_cast<float>((up - down) / (2.0 * h));
+        worst = max(worst, fabs(numeric - analytic) / max(1e-2f, fabs(numeric) + fabs(analytic)));
+    };
+    for (int i = 0; i < 24; i++)
+    {
+        size_t at = (static_cast<size_t>(i) * 7919) % x.numel();
+        compare(x.values()[at], grad_input.values()[at]);
+        size_t w = (static_cast<size_t>(i) * 104729) % grad_q_weight.numel();
+        compare(mixer.q_proj.weight.values()[w], grad_q_weight.values()[w]);
+    }
+    return worst;
+}
+
+pair<float, double> train_and_test(bool mixing, int heads, const vector<Tensor> &train_images, const vector<int> &train_labels,
+                                   const vector<Tensor> &test_images, const vector<int> &test_labels, int epochs)
+{
+    Random::seed(42);
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    if (mixing)
+        vit.enable_token_mixing(heads);
+    const int batch = 32;
+    auto start = chrono::steady_clock::now();
+    for (int epoch = 0; epoch < epochs; epoch++)
+    {
+        for (size_t first = 0; first < train_images.size(); first += batch)
+        {
+            vit.zero_grad();
+            for (size_t i = first; i < min(train_images.size(), first + batch); i++)
+                vit.train_step(train_images[i], train_labels[i]);
+            vit.update_weights(3e-4f);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    vit.set_training(false);
+    int correct = 0;
+    for (size_t i = 0; i < test_images.size(); i++)
+        correct += vit.predict(test_images[i]) == test_labels[i];
+    return {100.0f * correct / test_images.size(), seconds};
+}
+
+int main(int argc, char *argv[])
+{
+    int max_tokens = argc > 1 ? stoi(argv[1]) : 4096;
+    int d_model = argc > 2 ? stoi(argv[2]) : 64;
+    int heads = argc > 3 ? stoi(argv[3]) : 4;
+    if (heads < 1 || d_model % heads != 0)
+    {
+        cerr << "Error: las cabezas deben dividir d_model." << endl;
+        return 1;
+    }
+
+    Random::seed(42);
+    float error = gradient_check(16, 16, 4);
+    cout << "Comprobación de gradientes (diferencias centrales): error relativo máximo " << scientific << setprecision(2)
+         << error << (error < 5e-2f ? " (correcto)" : " (¡GRADIENTE INCORRECTO!)") << fixed << endl;
+
+    cout << "\nMezcla de tokens, forward + backward (d_model " << d_model << ", " << heads << " cabezas)" << endl;
+    cout << setw(8) << "tokens" << setw(14) << "lineal ms" << setw(14) << "softmax ms" << setw(10) << "speedup"
+         << setw(14) << "lineal MB" << setw(14) << "softmax MB" << endl;
+    for (int tokens = 64; tokens <= max_tokens; tokens *= 2)
+    {
+        Tensor x(tokens, d_model), grad(tokens, d_model);
+        x.xavier_init();
+        grad.xavier_init();
+        int repeats = max(1, 4096 / tokens);
+
+        LinearAttention linear(d_model, heads);
+        double linear_ms = time_ms([&]
+                                   { linear.forward(x);
+                                     linear.backward(grad); }, repeats);
+        double linear_mb = linear.activation_bytes() / 1048576.0;
+
+        SoftmaxAttention softmax(d_model, heads);
+        double softmax_ms = time_ms([&]
+                                    { softmax.forward(x);
+                                      softmax.backward(grad); }, max(1, repeats / 4));
+        // q, k, v, the output and the [heads, N, N] probabilities.
+        double softmax_mb = (4.0 * tokens * d_model + static_cast<double>(heads) * tokens * tokens) * sizeof(float) / 1048576.0;
+
+        cout << setw(8) << tokens << setprecision(2) << setw(14) << linear_ms << setw(14) << softmax_ms << setw(9)
+             << softmax_ms / linear_ms << "x" << setw(14) << linear_mb << setw(14) << softmax_mb << endl;
+    }
+
+    if (argc > 5)
+    {
+        int samples = argc > 6 ? stoi(argv[6]) : 2000;
+        int epochs = argc > 7 ? stoi(argv[7]) : 2;
+        auto [train_images, train_labels] = DataLoader::load_data(argv[4], samples);
+        auto [test_images, test_labels] = DataLoader::load_data(argv[5], max(500, samples / 4));
+        cout << "\nMNIST: " << train_images.size() << " muestras, " << epochs << " épocas, prueba con "
+             << test_images.size() << endl;
+        for (bool mixing : {false, true})
+        {
+            auto [accuracy, seconds] = train_and_test(mixing, heads, train_images, train_labels, test_images, test_labels, epochs);
+            cout << setw(26) << (mixing ? "con atención lineal" : "sin mezcla de tokens") << "  precisión " << setprecision(2)
+                 << accuracy << "%  (" << setprecision(1) << seconds << " s)" << endl;
+        }
+    }
+    return 0;
+}
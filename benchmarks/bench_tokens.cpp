@@ -0,0 +1,90 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../include/core/random.h"
+#include "../include/core/tensor.h"
+#include "../include/core/activation.h"
+#include "../include/model/vit.h"
+#include "../include/model/compiled_vit.h"
+#include "../include/data/data_loader.h"
+
+using namespace std;
+
+// Accuracy/latency curve of token pruning and merging on a labelled test set.
+// Every keep ratio is applied in front of each block, so it compounds with
+// depth.
+// Uso: bench_tokens.out <modelo.bin> <test.csv> [muestras]
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "Uso: " << argv[0] << " <modelo.bin> <test.csv> [muestras]" << endl;
+        return 1;
+    }
+    int max_samples = argc > 3 ? stoi(argv[3]) : -1;
+
+    Random::seed(42);
+    VisionTransformer vit(28, 4, 64, 2, 10);
+    vit.load_model(argv[1]);
+    vit.set_training(false);
+    CompiledVisionTransformer compiled = CompiledVisionTransformer::compile(vit);
+
+    auto [images, labels] = DataLoader::load_data(argv[2], max_samples);
+    if (images.empty())
+        return 1;
+
+    const vector<float> ratios = {1.0f, 0.75f, 0.5f, 0.25f, 0.1f};
+    const vector<pair<string, TokenReduction::Mode>> modes = {{"poda", TokenReduction::Mode::Prune},
+                                                              {"fusión", TokenReduction::Mode::Merge}};
+
+    cout << left << setw(10) << "modo" << right << setw(8) << "keep" << setw(16) << "tokens/bloque"
+         << setw(12) << "precisión" << setw(12) << "us/imagen" << setw(10) << "speedup" << endl;
+
+    double full_us = 0.0;
+    for (auto &[name, mode] : modes)
+    {
+        for (float ratio : ratios)
+        {
+            TokenReduction reduction;
+            reduction.mode = mode;
+            reduction.keep_ratios.assign(vit.num_layers, ratio);
+
+            for (int i = 0; i < 10; i++)
+            {
+                compiled.forward(images[i % images.size()], reduction);
+            }
+            int correct = 0;
+            auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < images.size(); i++)
+            {
+                if (Activation::argmax(compiled.forward(images[i], reduction)) == labels[i])
+                    correct++;
+            }
+            auto end = chrono::steady_clock::now();
+            double us = chrono::duration<double, micro>(end - start).count() / images.size();
+            if (full_us == 0.0)
+                full_us = us;
+
+            // Tokens entering each block, CLS included.
+            string schedule;
+            int patches = vit.num_patches;
+            for (int l = 0; l < vit.num_layers; l++)
+            {
+                int keep = min(patches, max(1, static_cast<int>(lround(ratio * patches))));
+                if (mode == TokenReduction::Mode::Merge)
+                    keep = max(keep, patches / 2);
+                patches = keep;
+                schedule += (l ? "," : "") + to_string(patches + 1);
+            }
+
+            cout << left << setw(10) << name << right << fixed << setprecision(2) << setw(8) << ratio
+                 << setw(16) << schedule << setw(11) << 100.0 * correct / images.size() << "%"
+                 << setw(12) << us << setw(9) << full_us / us << "x" << endl;
+        }
+    }
+    return 0;
+}
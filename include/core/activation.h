@@ -18,6 +18,11 @@ public:
     static float gelu_derivative(float x);
     static Tensor apply(const Tensor &input, float (*func)(float));
     static Tensor softmax(const Tensor &input);
+    // Cross-entropy of row 0 of logits against label via log-sum-exp. When
+    // grad is given it receives softmax(logits) - onehot(label), computed from
+    // the same exponentials.
+    static float softmax_cross_entropy(const Tensor &logits, int label, Tensor *grad = nullptr);
+    static int argmax(const Tensor &logits);
 };
 
 #endif // ACTIVATION_H
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef COLLECTIVE_H
+#define COLLECTIVE_H
+
+#include "tensor.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Collective operations between the processes of a data-parallel job. Every
+// rank must issue the same calls in the same order; all of them block until
+// the whole group has taken part. Failures (a peer died, a socket broke)
+// throw std::runtime_error.
+//
+// Backends (VIT_DIST_BACKEND):
+//   shm  ring all-reduce through one POSIX shared-memory segment per job;
+//        ranks on the same host only. VIT_DIST_ADDR is the segment name.
+//   tcp  ring all-reduce over TCP. VIT_DIST_ADDR is "host:port", where
+//        rank r listens on port + r, or one "host:port" per rank separated
+//        by commas for ranks on different hosts.
+class Collective
+{
+public:
+    virtual ~Collective() = default;
+
+    int rank() const { return rank_; }
+    int world_size() const { return world_size_; }
+
+    // data[i] becomes the sum of data[i] over all ranks.
+    virtual void all_reduce_sum(float *data, std::size_t count) = 0;
+    virtual void barrier();
+    // Every rank ends up with root's data.
+    void broadcast(float *data, std::size_t count, int root = 0);
+
+    static std::unique_ptr<Collective> create(const std::string &backend, int rank, int world_size, const std::string &address);
+    // Built from VIT_RANK, VIT_WORLD_SIZE, VIT_DIST_BACKEND and
+    // VIT_DIST_ADDR, as set by the launcher; null for a single process.
+    static std::unique_ptr<Collective> from_env();
+
+protected:
+    Collective(int rank, int world_size) : rank_(rank), world_size_(world_size) {}
+
+    int rank_, world_size_;
+};
+
+class ShmCollective : public Collective
+{
+public:
+    ShmCollective(int rank, int world_size, const std::string &name);
+    ~ShmCollective() override;
+
+    void all_reduce_sum(float *data, std::size_t count) override;
+    void barrier() override;
+
+private:
+    struct Segment;
+    Segment *segment = nullptr;
+    std::size_t mapped_bytes = 0;
+    unsigned long long sent = 0; // messages this rank has posted
+
+    float *slot(int rank) const;
+    void send(const float *data, std::size_t count);
+    void receive(float *data, std::size_t count, bool accumulate);
+};
+
+class TcpCollective : public Collective
+{
+public:
+    TcpCollective(int rank, int world_size, const std::string &address);
+    ~TcpCollective() override;
+
+    void all_reduce_sum(float *data, std::size_t count) override;
+
+private:
+    int next_fd = -1, prev_fd = -1; // sockets to rank + 1 and from rank - 1
+    std::vector<float> incoming;
+
+    // Sends to the next rank while receiving from the previous one, so
+    // neither side blocks on a full socket buffer.
+    void exchange(const float *out, std::size_t out_count, float *in, std::size_t in_count);
+};
+
+// Sums groups of gradient tensors across ranks on a background thread, so
+// communication for one group overlaps with computing the next. Groups are
+// reduced in submission order, which must be the same on every rank.
+class OverlappedAllReduce
+{
+public:
+    explicit OverlappedAllReduce(Collective &collective);
+    ~OverlappedAllReduce();
+    OverlappedAllReduce(const OverlappedAllReduce &) = delete;
+    OverlappedAllReduce &operator=(const OverlappedAllReduce &) = delete;
+
+    void submit(const std::vector<Tensor *> &tensors);
+    // Blocks until every submitted group is reduced; rethrows a
+    // communication failure.
+    void wait();
+
+private:
+    Collective &collective;
+    std::deque<std::vector<Tensor *>> pending;
+    std::vector<float> buffer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool reducing = false, stopping = false;
+    std::string error;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // COLLECTIVE_H
@@ -0,0 +1,66 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "tensor.h"
+#include "half.h"
+#include "memory.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A Linear-style weight (out x in) repacked once for the GEMM microkernel:
+// output columns are grouped into panels of NR, and each panel stores its
+// in x NR block contiguously (k-major, zero-padded past the last column),
+// 64-byte aligned, and on huge pages from 2 MB up (see Memory). The kernel
+// then streams one panel per register tile.
+// With a half-precision dtype the panels live in `half` instead of `data`
+// and gemm_packed widens each one to fp32 just before using it.
+class PackedMatrix
+{
+public:
+    static const int NR = 8;
+
+    int rows = 0, cols = 0; // logical weight shape: out x in
+    WeightDType dtype = WeightDType::F32;
+    std::vector<float, HugePageAllocator<float>> data;
+    std::vector<uint16_t, HugePageAllocator<uint16_t>> half;
+
+    void pack(const Tensor &weight, WeightDType storage = WeightDType::F32);
+    void clear();
+    bool empty() const { return rows == 0; }
+    int num_panels() const { return (rows + NR - 1) / NR; }
+    std::size_t panel_size() const { return static_cast<std::size_t>(cols) * NR; }
+    std::size_t bytes() const { return num_panels() * panel_size() * dtype_bytes(dtype); }
+    const float *panel(int p) const { return data.data() + p * panel_size(); }
+    const uint16_t *half_panel(int p) const { return half.data() + p * panel_size(); }
+    // Element (o, k) of the original out x in weight.
+    float at(int o, int k) const
+    {
+        const std::size_t index = (o / NR) * panel_size() + static_cast<std::size_t>(k) * NR + o % NR;
+        return dtype == WeightDType::F32 ? data[index] : widen(half[index], dtype);
+    }
+};
+
+// How one gemm_packed call walks its operands. Every variant accumulates
+// each output in the same order, so they differ in speed only.
+struct GemmConfig
+{
+    int mr = 4;        // rows per register tile: 1, 2, 4 or 6
+    int row_block = 0; // rows swept per pass over the panels; 0 = all m
+    int threads = 0;   // workers for a Linear's row split; 0 = default grain
+
+    bool operator==(const GemmConfig &other) const
+    {
+        return mr == other.mr && row_block == other.row_block && threads == other.threads;
+    }
+};
+
+// C[m x rows] = A[m x cols] * W^T (+ bias), A and C row-major with leading
+// dimensions lda / ldc. Each output accumulates over k in ascending order
+// before the bias is added, matching Linear::forward bit for bit. Runs on
+// the calling thread; callers split the rows of A across workers and pick
+// the config, usually GemmTuner's for the shape, once per call site.
+void gemm_packed(const float *a, int m, int lda, const PackedMatrix &w, const float *bias, float *c, int ldc,
+                 const GemmConfig &config);
+
+#endif // GEMM_H
@@ -0,0 +1,94 @@
+#ifndef GEMM_TUNER_H
+#define GEMM_TUNER_H
+
+#include "gemm.h"
+#include "half.h"
+#include <string>
+#include <vector>
+
+// Where a GEMM runs, which decides how it is timed: Linear and
+// LowRankLinear split the rows across a tuned number of threads, while the
+// compiled engine runs each row block as a single call on one thread.
+enum class GemmSite
+{
+    Linear,
+    Compiled
+};
+
+std::string site_name(GemmSite site);
+// Parses "linear" or "compiled"; returns false for anything else.
+bool parse_site(const std::string &name, GemmSite &site);
+
+// One gemm_packed problem: A is m x k, the packed weight n x k.
+struct GemmShape
+{
+    int m, k, n;
+    WeightDType dtype;
+    GemmSite site = GemmSite::Linear;
+
+    bool operator<(const GemmShape &other) const
+    {
+        if (m != other.m)
+            return m < other.m;
+        if (k != other.k)
+            return k < other.k;
+        if (n != other.n)
+            return n < other.n;
+        if (dtype != other.dtype)
+            return dtype < other.dtype;
+        return site < other.site;
+    }
+    bool operator==(const GemmShape &other) const
+    {
+        return m == other.m && k == other.k && n == other.n && dtype == other.dtype && site == other.site;
+    }
+};
+
+struct GemmTuneResult
+{
+    GemmShape shape;
+    GemmConfig config;
+    double default_gflops = 0.0, tuned_gflops = 0.0;
+    bool cached = false; // taken from the cache, not timed in this run
+};
+
+// Picks a GemmConfig for every GEMM shape on this machine by timing the
+// candidates (microkernel height, row blocking, threads) and keeps the
+// winners in a text cache shared by every CPU model of a fleet: entries are
+// grouped under "cpu <model> x<logical cpus>" and only the current CPU's
+// group is used. The cache is read on first use, so a tuned machine
+// dispatches straight to its configs; shapes never tuned run the defaults.
+// Entries are keyed by call site as well as shape, and a lookup for an
+// untuned m takes the tuned entry of the nearest m with the same k, n,
+// dtype and site.
+//
+// VIT_GEMM_TUNING=<path> selects the cache file (default
+// models/gemm_tuning.txt); "off" disables tuned dispatch entirely.
+//
+// tune() updates the table in place: do not run it while other threads are
+// inside gemm_packed.
+class GemmTuner
+{
+public:
+    static GemmConfig config(int m, int k, int n, WeightDType dtype, GemmSite site);
+    // Rows per parallel_for chunk when m rows run under config: m split
+    // evenly across config.threads, or default_grain when that is 0.
+    static int grain(const GemmConfig &config, int m, int default_grain);
+
+    // Times every candidate for each distinct shape and records the fastest.
+    // Shapes already in the table are reported from it unless retune is set.
+    static std::vector<GemmTuneResult> tune(std::vector<GemmShape> shapes, bool retune = false);
+
+    static std::string cache_path();
+    // load() replaces the table with the current CPU's entries in path;
+    // save() rewrites path, keeping the other CPUs' groups it holds.
+    static bool load(const std::string &path);
+    static bool save(const std::string &path);
+    static bool enabled();
+    static void set_enabled(bool enabled);
+    static int size();
+    // "<model name> x<logical cpus>", from /proc/cpuinfo.
+    static const std::string &cpu_key();
+};
+
+#endif // GEMM_TUNER_H
@@ -0,0 +1,35 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Storage precision of packed weights. Half formats keep 16 bits per value
+// and are widened back to fp32 right before the arithmetic.
+enum class WeightDType
+{
+    F32,
+    F16, // IEEE binary16
+    BF16 // bfloat16: the upper half of an fp32
+};
+
+// Round-to-nearest-even conversions.
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+uint16_t float_to_bf16(float value);
+float bf16_to_float(uint16_t value);
+
+uint16_t narrow(float value, WeightDType dtype);
+float widen(uint16_t value, WeightDType dtype);
+// dst[i] = widen(src[i]); fp16 uses the F16C / AVX-512 conversion
+// instructions when the CPU has them and a portable bit-level fallback
+// otherwise.
+void widen(const uint16_t *src, float *dst, std::size_t n, WeightDType dtype);
+
+std::size_t dtype_bytes(WeightDType dtype);
+std::string dtype_name(WeightDType dtype);
+// Parses "f32", "f16" or "bf16"; returns false for anything else.
+bool parse_dtype(const std::string &name, WeightDType &dtype);
+
+#endif // HALF_H
@@ -0,0 +1,16 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Fast non-cryptographic 64-bit hash: 8 bytes per step with a
+// multiply-xorshift mix and a splitmix64 finalizer. Different seeds give
+// independent hashes of the same bytes.
+uint64_t hash_bytes(const void *data, std::size_t size, uint64_t seed = 0);
+
+// Hash of a whole file's contents; 0 when it cannot be read.
+uint64_t hash_file(const std::string &path);
+
+#endif // HASH_H
@@ -0,0 +1,68 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <string>
+
+// Large buffers (packed weights, replicated models) are placed on 2 MB huge
+// pages so that streaming them costs one TLB entry per 2 MB instead of one
+// per 4 KB. Buffers of at least kHugePageSize are mapped directly, aligned to
+// the huge page size, and either backed by hugetlbfs pages or advised for
+// transparent huge pages; smaller buffers come from the regular heap.
+//
+// The mode defaults to the VIT_HUGE_PAGES environment variable:
+//   off      plain heap allocations
+//   thp      madvise(MADV_HUGEPAGE) on aligned anonymous mappings (default)
+//   hugetlb  MAP_HUGETLB from the reserved pool, falling back to thp
+//
+// Small objects (per-image Tensors, activations) stay in the malloc heap;
+// run.sh asks glibc to back that heap with huge pages as well
+// (GLIBC_TUNABLES=glibc.malloc.hugetlb=1) when the mode is not off.
+class Memory
+{
+public:
+    enum class HugePages
+    {
+        Off,
+        Transparent,
+        HugeTLB
+    };
+
+    static const std::size_t kHugePageSize = 2 * 1024 * 1024;
+    static const std::size_t kAlignment = 64;
+
+    static void set_huge_pages(HugePages mode);
+    static HugePages huge_pages();
+    static bool parse_huge_pages(const std::string &name, HugePages &mode);
+    static std::string huge_pages_name(HugePages mode);
+
+    // kAlignment-aligned storage for bytes bytes; never returns null.
+    static void *allocate(std::size_t bytes);
+    // bytes must match the allocate() call.
+    static void deallocate(void *p, std::size_t bytes);
+
+    // Bytes of this process currently backed by transparent huge pages
+    // (AnonHugePages in /proc/self/smaps_rollup), or -1 if unavailable.
+    static long huge_page_bytes();
+};
+
+// std::allocator drop-in that routes through Memory::allocate.
+template <typename T>
+struct HugePageAllocator
+{
+    using value_type = T;
+
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(std::size_t n) { return static_cast<T *>(Memory::allocate(n * sizeof(T))); }
+    void deallocate(T *p, std::size_t n) { Memory::deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U> &) const { return false; }
+};
+
+#endif // MEMORY_H
@@ -0,0 +1,63 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Intra-op parallelism on top of the persistent TaskScheduler workers, so a
+// parallel_for never spawns threads and can be nested inside tasks.
+//
+// The thread count defaults to the VIT_NUM_THREADS environment variable, or
+// std::thread::hardware_concurrency() when it is not set.
+class Parallel
+{
+public:
+    static void set_num_threads(int n);
+    static int num_threads();
+
+    // Caps how many threads a parallel_for started from the calling thread
+    // may use (0 removes the cap). Lets several jobs share the pool, each
+    // within its own core budget.
+    static void set_thread_budget(int n);
+    static int thread_budget();
+
+    // Number of loop iterations a chunk should cover so that each chunk does
+    // at least a minimum amount of work; cost_per_item is a rough flop count.
+    static int grain_size(long cost_per_item);
+
+    // Calls body(chunk_begin, chunk_end) over disjoint sub-ranges of
+    // [begin, end). Chunks never get smaller than grain iterations; ranges
+    // smaller than that run inline on the caller.
+    static void parallel_for(int begin, int end, int grain, const std::function<void(int, int)> &body);
+
+    // Maps every grain-sized chunk to a partial result and combines the
+    // partials in chunk order, so the result does not depend on the number
+    // of threads.
+    template <typename T, typename Map, typename Combine>
+    static T parallel_reduce(int begin, int end, int grain, T identity, Map map, Combine combine)
+    {
+        if (end <= begin)
+            return identity;
+        if (grain < 1)
+            grain = 1;
+        int num_chunks = (end - begin + grain - 1) / grain;
+        std::vector<T> partials(num_chunks, identity);
+        parallel_for(0, num_chunks, 1, [&](int chunk_begin, int chunk_end)
+                     {
+            for (int c = chunk_begin; c < chunk_end; c++)
+            {
+                int lo = begin + c * grain;
+                int hi = std::min(end, lo + grain);
+                partials[c] = map(lo, hi);
+            } });
+        T result = identity;
+        for (const T &partial : partials)
+        {
+            result = combine(result, partial);
+        }
+        return result;
+    }
+};
+
+#endif // PARALLEL_H
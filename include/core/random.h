@@ -1,17 +1,88 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
-#include <random>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
 
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3"): a keyed bijection from a 128-bit counter to four 32-bit words. Word
+// i of stream s under seed k is a pure function of (k, s, i), so any slice
+// of a stream can be generated independently of the rest.
+class Philox
+{
+public:
+    typedef std::array<uint32_t, 4> Block;
+    static Block block(uint64_t seed, uint64_t stream, uint64_t index);
+};
+
+// Sequential reader over one Philox stream. Cheap to copy; the state is
+// just (seed, stream, position). Satisfies UniformRandomBitGenerator.
+class RandomStream
+{
+public:
+    typedef uint32_t result_type;
+
+    uint64_t seed, stream, position; // position counts 32-bit words
+
+    RandomStream(uint64_t seed = 0, uint64_t stream = 0);
+    uint32_t next_u32();
+    float uniform(float min = 0.0f, float max = 1.0f);
+    float randn(float mean = 0.0f, float stddev = 1.0f);
+    int randint(int min, int max); // inclusive
+
+    // Fisher-Yates with randint, so the permutation does not depend on the
+    // standard library's distribution implementations.
+    template <typename T>
+    void shuffle(std::vector<T> &values)
+    {
+        for (int i = static_cast<int>(values.size()) - 1; i > 0; i--)
+        {
+            std::swap(values[i], values[randint(0, i)]);
+        }
+    }
+
+    static constexpr uint32_t min() { return 0; }
+    static constexpr uint32_t max() { return UINT32_MAX; }
+    uint32_t operator()() { return next_u32(); }
+
+private:
+    Philox::Block cache;
+    uint64_t cache_index = UINT64_MAX;
+};
+
+// Process-wide facade. Every thread draws from its own RandomStream: the
+// thread that calls seed() reads stream 0 and any other thread gets a
+// private stream the first time it asks, so nothing is shared or racy.
+//
+// Bulk fills take a fresh stream id per call, handed out in call order, and
+// generate element i from word i of that stream. Splitting a fill across
+// workers therefore gives the same values for any thread count.
 class Random
 {
 public:
-    static std::mt19937 gen;
-    static std::random_device rd;
-    static void seed(unsigned int s = 0);
+    static void seed(uint64_t s = 0); // 0 picks a seed from std::random_device
+    static RandomStream &stream();
+
     static float randn(float mean = 0.0f, float stddev = 1.0f);
     static float uniform(float min = 0.0f, float max = 1.0f);
     static int randint(int min, int max);
+    template <typename T>
+    static void shuffle(std::vector<T> &values) { stream().shuffle(values); }
+
+    static uint64_t next_stream();
+    static void fill_normal(float *data, std::size_t n, float mean = 0.0f, float stddev = 1.0f);
+    static void fill_uniform(float *data, std::size_t n, float min = 0.0f, float max = 1.0f);
+    static void fill_normal(float *data, std::size_t n, float mean, float stddev, uint64_t seed, uint64_t stream);
+    static void fill_uniform(float *data, std::size_t n, float min, float max, uint64_t seed, uint64_t stream);
+
+    // Seed, next bulk stream id and the calling thread's stream position, so
+    // a checkpoint can resume the exact sequence.
+    static std::string state();
+    static bool set_state(const std::string &state);
 };
 
-#endif // RANDOM_H
\ No newline at end of file
+#endif // RANDOM_H
@@ -0,0 +1,65 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Bounded single-producer / single-consumer queue. The producer only
+// writes tail and the consumer only writes head, so each side needs one
+// atomic load of the other's index per operation and no lock. push() and
+// pop() block (spin, then yield, then sleep) while the ring is full or
+// empty, so a side left idle for long stops burning its core.
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(std::size_t capacity) : slots(capacity + 1) {}
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    void push(T value)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        const std::size_t next = (tail + 1) % slots.size();
+        for (int spins = 0; next == head_.load(std::memory_order_acquire); spins++)
+        {
+            wait(spins);
+        }
+        slots[tail] = std::move(value);
+        tail_.store(next, std::memory_order_release);
+    }
+
+    T pop()
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        for (int spins = 0; head == tail_.load(std::memory_order_acquire); spins++)
+        {
+            wait(spins);
+        }
+        T value = std::move(slots[head]);
+        head_.store((head + 1) % slots.size(), std::memory_order_release);
+        return value;
+    }
+
+private:
+    static const int kSpins = 128;
+    static const int kYields = 1024;
+
+    static void wait(int spins)
+    {
+        if (spins >= kSpins + kYields)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        else if (spins >= kSpins)
+            std::this_thread::yield();
+    }
+
+    std::vector<T> slots; // one slot stays empty to tell full from empty
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+#endif // SPSC_RING_H
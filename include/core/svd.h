@@ -0,0 +1,13 @@
+#ifndef SVD_H
+#define SVD_H
+
+#include "tensor.h"
+#include <vector>
+
+// Thin singular value decomposition a = u * diag(s) * v^T of an m x n matrix
+// by one-sided Jacobi rotations (accumulated in double precision). u is
+// m x k, v is n x k and s holds the k = min(m, n) singular values in
+// descending order.
+void svd(const Tensor &a, Tensor &u, std::vector<float> &s, Tensor &v);
+
+#endif // SVD_H
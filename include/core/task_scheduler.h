@@ -0,0 +1,48 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+struct Task;
+using TaskHandle = std::shared_ptr<Task>;
+
+// Work-stealing task runtime shared by the whole process. Every worker owns
+// a deque: it pushes and pops its own tasks LIFO and steals from the other
+// end of the others' deques when it runs dry. Threads outside the pool
+// submit through a shared injection queue.
+//
+// A thread that waits on a task keeps executing queued tasks until the task
+// completes, so waiting from inside a task never deadlocks the pool.
+class TaskScheduler
+{
+public:
+    // Resizing must happen while no tasks are running.
+    static void set_num_threads(int n);
+    static int num_threads();
+
+    // Schedules fn once every task in dependencies has completed.
+    static TaskHandle spawn(std::function<void()> fn, const std::vector<TaskHandle> &dependencies = {});
+    static void wait(const TaskHandle &task);
+    static bool is_done(const TaskHandle &task);
+};
+
+// Fork/join helper: tasks started with run() are joined by wait() or by the
+// destructor.
+class TaskGroup
+{
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+    ~TaskGroup();
+
+    TaskHandle run(std::function<void()> fn, const std::vector<TaskHandle> &dependencies = {});
+    void wait();
+
+private:
+    std::vector<TaskHandle> tasks;
+};
+
+#endif // TASK_SCHEDULER_H
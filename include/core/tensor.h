@@ -7,23 +7,217 @@
 #include <algorithm>
 #include <cassert>
 
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include "parallel.h"
+
 // Forward declaration of Random for xavier_init and he_init
 class Random;
 
-class Tensor
+// Elementwise arithmetic (+, -, * scalar) builds lazy expression objects
+// instead of Tensors. Nothing is computed until an expression is assigned to
+// a Tensor (constructor, =, +=, -=), which evaluates the whole chain in one
+// loop with no temporaries. Expressions keep leaf Tensors by reference and
+// inner nodes by value, so they must not outlive the Tensors they read.
+// Operands must be contiguous and hold the same number of elements; a new
+// Tensor built from an expression takes the shape of its first leaf.
+template <typename E>
+struct TensorExpr
+{
+    const E &self() const { return static_cast<const E &>(*this); }
+};
+
+class Tensor;
+
+// Reference-counted, copy-on-write float buffer behind Tensor::data. Copies
+// share the buffer; the first non-const access through a copy whose buffer
+// is shared clones it. const access never copies, so layers can cache their
+// inputs for backward for the price of a reference count. As with
+// std::vector, one object must not be written from several threads while it
+// may still be shared; fresh and moved-into buffers are never shared.
+class TensorStorage
+{
+public:
+    TensorStorage() = default;
+    explicit TensorStorage(std::size_t n) : values(n > 0 ? std::make_shared<std::vector<float>>(n) : nullptr) {}
+    TensorStorage(const TensorStorage &other);
+    TensorStorage(TensorStorage &&other) noexcept = default;
+    TensorStorage &operator=(const TensorStorage &other);
+    TensorStorage &operator=(TensorStorage &&other) noexcept = default;
+
+    std::size_t size() const { return values ? values->size() : 0; }
+    bool empty() const { return size() == 0; }
+    bool shared() const { return values && values.use_count() > 1; }
+
+    const float *data() const { return values ? values->data() : nullptr; }
+    float *data()
+    {
+        if (shared())
+            detach();
+        return values ? values->data() : nullptr;
+    }
+    const float &operator[](std::size_t i) const { return (*values)[i]; }
+    float &operator[](std::size_t i) { return data()[i]; }
+    const float *begin() const { return data(); }
+    const float *end() const { return data() + size(); }
+    float *begin() { return data(); }
+    float *end() { return data() + size(); }
+    void resize(std::size_t n, float value = 0.0f);
+    const std::vector<float> &vector() const;
+
+    // Bytes cloned by copy-on-write (or by every copy while sharing is off)
+    // and bytes handed out as shared references instead, since start.
+    static long long bytes_copied();
+    static long long bytes_shared();
+    static void reset_counters();
+    // false makes every copy a deep copy again, for measurements.
+    static void set_copy_on_write(bool enabled);
+
+private:
+    void detach();
+
+    std::shared_ptr<std::vector<float>> values;
+};
+
+template <typename E>
+struct ExprStorage
+{
+    using type = const E;
+};
+
+template <>
+struct ExprStorage<Tensor>
+{
+    using type = const Tensor &;
+};
+
+struct AddOp
+{
+    static float apply(float a, float b) { return a + b; }
+};
+
+struct SubOp
+{
+    static float apply(float a, float b) { return a - b; }
+};
+
+struct MulOp
+{
+    static float apply(float a, float b) { return a * b; }
+};
+
+template <typename L, typename R, typename Op>
+struct BinaryExpr : TensorExpr<BinaryExpr<L, R, Op>>
+{
+    typename ExprStorage<L>::type lhs;
+    typename ExprStorage<R>::type rhs;
+    int rows, cols;
+
+    BinaryExpr(const L &l, const R &r) : lhs(l), rhs(r), rows(l.rows), cols(l.cols)
+    {
+        assert(l.rows == r.rows && l.cols == r.cols);
+    }
+    float eval(std::size_t i) const { return Op::apply(lhs.eval(i), rhs.eval(i)); }
+    bool is_contiguous() const { return lhs.is_contiguous() && rhs.is_contiguous(); }
+    const Tensor &leaf() const { return lhs.leaf(); }
+};
+
+template <typename E>
+struct ScaleExpr : TensorExpr<ScaleExpr<E>>
+{
+    typename ExprStorage<E>::type expr;
+    float scalar;
+    int rows, cols;
+
+    ScaleExpr(const E &e, float s) : expr(e), scalar(s), rows(e.rows), cols(e.cols) {}
+    float eval(std::size_t i) const { return expr.eval(i) * scalar; }
+    bool is_contiguous() const { return expr.is_contiguous(); }
+    const Tensor &leaf() const { return expr.leaf(); }
+};
+
+// Rank-N tensor (up to kMaxRank axes) with per-axis strides over a shared
+// TensorStorage. Constructors make contiguous row-major tensors; reshape(),
+// permute(), select() and broadcast_to() return views over the same
+// storage, which are cloned on first write like any other copy, so views
+// are for reading: call contiguous() to get a dense tensor to work on.
+//
+// rows and cols are the 2-D view the original API works on: the last axis
+// is cols and all the others fold into rows, so a [batch, tokens, d_model]
+// tensor is handled by 2-D code as [batch * tokens, d_model] and a rank-1
+// tensor as a single row. The 2-D API (operator(), data[i], operator*,
+// slice...) expects a contiguous tensor; data holds the elements from
+// values() = data.data() + offset on.
+class Tensor : public TensorExpr<Tensor>
 {
 public:
-    std::vector<float> data;
+    static const int kMaxRank = 6;
+
+    TensorStorage data;
     int rows, cols;
     Tensor();
     Tensor(int r, int c);
+    explicit Tensor(const std::vector<int> &shape);
     Tensor(const std::vector<std::vector<float>> &d);
+    Tensor(const Tensor &other) = default;
+    Tensor(Tensor &&other) = default;
+    Tensor &operator=(const Tensor &other) = default;
+    Tensor &operator=(Tensor &&other) = default;
+
+    template <typename E>
+    Tensor(const TensorExpr<E> &expr);
+    template <typename E>
+    Tensor &operator=(const TensorExpr<E> &expr);
+    template <typename E>
+    Tensor &operator+=(const TensorExpr<E> &expr);
+    template <typename E>
+    Tensor &operator-=(const TensorExpr<E> &expr);
+    Tensor &operator*=(float scalar);
+
+    float eval(std::size_t i) const { return data[offset + i]; }
+    const Tensor &leaf() const { return *this; }
     float &operator()(int i, int j);
     const float &operator()(int i, int j) const;
-    Tensor operator+(const Tensor &other) const;
-    Tensor operator-(const Tensor &other) const;
+
+    int rank() const { return ndim; }
+    // Negative axes count from the end, as in dim(-1) == cols.
+    int dim(int axis) const { return dims[axis < 0 ? axis + ndim : axis]; }
+    long stride(int axis) const { return steps[axis < 0 ? axis + ndim : axis]; }
+    std::vector<int> shape() const { return std::vector<int>(dims, dims + ndim); }
+    std::size_t numel() const { return static_cast<std::size_t>(rows) * cols; }
+    bool is_contiguous() const;
+    const float *values() const { return data.data() + offset; }
+    float *values() { return data.data() + offset; }
+    template <typename... Index>
+    float &at(Index... index) { return data[element({static_cast<int>(index)...})]; }
+    template <typename... Index>
+    const float &at(Index... index) const { return data[element({static_cast<int>(index)...})]; }
+
+    // One entry of shape may be -1 and is inferred. A view when this tensor
+    // is contiguous, a dense copy otherwise.
+    Tensor reshape(const std::vector<int> &shape) const;
+    // Views: axes reordered, one index fixed (rank - 1 axes), or size-1 and
+    // missing leading axes repeated with stride 0 (NumPy broadcasting).
+    Tensor permute(const std::vector<int> &axes) const;
+    Tensor transpose(int axis_a, int axis_b) const;
+    Tensor select(int axis, int index) const;
+    Tensor broadcast_to(const std::vector<int> &shape) const;
+    // This tensor if already contiguous (sharing storage), else a dense copy.
+    Tensor contiguous() const;
+    // this += other, with other broadcast to this shape: a bias [d_model] or
+    // position embeddings [tokens, d_model] onto [batch, tokens, d_model].
+    Tensor &broadcast_add(const Tensor &other);
+    // Zeros with the shape of other, or with its last axis resized.
+    static Tensor zeros_like(const Tensor &other, int last_dim = -1);
+    // [n, shape...] from n tensors of the same shape.
+    static Tensor stack(const std::vector<Tensor> &tensors);
+    // Batched product over the leading axes: [..., m, k] x [..., k, n] ->
+    // [..., m, n], leading axes broadcast, so a rank-2 operand is shared by
+    // the whole batch. Each matrix is summed in the same order as operator*.
+    static Tensor matmul(const Tensor &a, const Tensor &b);
+
     Tensor operator*(const Tensor &other) const;
-    Tensor operator*(float scalar) const;
     Tensor transpose() const;
     void zero();
     void xavier_init();
@@ -34,6 +228,116 @@ public:
     void set_slice(int start_row, int start_col, const Tensor &src);
     Tensor hadamard(const Tensor &other) const;
     Tensor row_normalize() const;
+
+private:
+    int ndim = 2;
+    int dims[kMaxRank] = {};
+    long steps[kMaxRank] = {};
+    std::size_t offset = 0;
+
+    // Contiguous row-major strides for the given shape; rows and cols follow.
+    void set_shape(const int *shape, int rank);
+    void fold_2d();
+    std::size_t element(std::initializer_list<int> index) const;
+
+    // out[i] = combine(out[i], expr[i]) over every element, split across
+    // workers only when the tensor is large enough to pay for it.
+    template <typename E, typename Combine>
+    void evaluate(const E &expr, Combine combine)
+    {
+        assert(is_contiguous() && expr.is_contiguous());
+        float *out = values();
+        const int n = rows * cols;
+        auto body = [out, &expr, combine](int begin, int end)
+        {
+#pragma GCC ivdep
+            for (int i = begin; i < end; i++)
+            {
+                out[i] = combine(out[i], expr.eval(i));
+            }
+        };
+        const int grain = Parallel::grain_size(4);
+        if (n <= grain)
+            body(0, n);
+        else
+            Parallel::parallel_for(0, n, grain, body);
+    }
 };
 
+template <typename E>
+Tensor::Tensor(const TensorExpr<E> &expr)
+{
+    const Tensor &like = expr.self().leaf();
+    set_shape(like.dims, like.ndim);
+    data.resize(static_cast<std::size_t>(rows) * cols);
+    evaluate(expr.self(), [](float, float v)
+             { return v; });
+}
+
+template <typename E>
+Tensor &Tensor::operator=(const TensorExpr<E> &expr)
+{
+    // Elementwise expressions only read index i while writing index i, so
+    // assigning an expression that reads this tensor is safe in place. A
+    // shared buffer is replaced rather than cloned and then overwritten.
+    if (rows != expr.self().rows || cols != expr.self().cols || data.shared())
+    {
+        Tensor result(expr);
+        *this = std::move(result);
+        return *this;
+    }
+    evaluate(expr.self(), [](float, float v)
+             { return v; });
+    return *this;
+}
+
+template <typename E>
+Tensor &Tensor::operator+=(const TensorExpr<E> &expr)
+{
+    assert(rows == expr.self().rows && cols == expr.self().cols);
+    evaluate(expr.self(), [](float a, float v)
+             { return a + v; });
+    return *this;
+}
+
+template <typename E>
+Tensor &Tensor::operator-=(const TensorExpr<E> &expr)
+{
+    assert(rows == expr.self().rows && cols == expr.self().cols);
+    evaluate(expr.self(), [](float a, float v)
+             { return a - v; });
+    return *this;
+}
+
+inline Tensor &Tensor::operator*=(float scalar)
+{
+    evaluate(*this, [scalar](float a, float)
+             { return a * scalar; });
+    return *this;
+}
+
+template <typename L, typename R>
+BinaryExpr<L, R, AddOp> operator+(const TensorExpr<L> &lhs, const TensorExpr<R> &rhs)
+{
+    return BinaryExpr<L, R, AddOp>(lhs.self(), rhs.self());
+}
+
+template <typename L, typename R>
+BinaryExpr<L, R, SubOp> operator-(const TensorExpr<L> &lhs, const TensorExpr<R> &rhs)
+{
+    return BinaryExpr<L, R, SubOp>(lhs.self(), rhs.self());
+}
+
+template <typename E>
+ScaleExpr<E> operator*(const TensorExpr<E> &expr, float scalar)
+{
+    return ScaleExpr<E>(expr.self(), scalar);
+}
+
+template <typename E>
+ScaleExpr<E> operator*(float scalar, const TensorExpr<E> &expr)
+{
+    return ScaleExpr<E>(expr.self(), scalar);
+}
+
 #endif // TENSOR_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+// CPU / NUMA layout of the machine, read once from
+// /sys/devices/system/node and restricted to the CPUs this process may run
+// on. Without sysfs every CPU belongs to node 0.
+//
+// VIT_NUMA_NODES=<n> splits the allowed CPUs into n simulated nodes, so the
+// per-node code paths can be exercised on a single-socket host (combine with
+// `numactl --cpunodebind/--membind` to emulate placement on a real one).
+//
+// VIT_PIN_THREADS pins the TaskScheduler threads (slot 0 is the thread that
+// creates the pool, slot i the i-th worker):
+//   compact       fill node 0 first, then node 1, ...
+//   scatter       round-robin over nodes, so every node gets workers early
+//   <cpu list>    explicit CPUs, e.g. "0,2,4-7"; slots past the end wrap
+// Unset or "none" leaves the threads to the OS scheduler. Pinned threads
+// first-touch their activations, so per-worker buffers stay node-local.
+class Topology
+{
+public:
+    static int num_nodes();
+    static const std::vector<int> &cpus(int node);
+    // Node of cpu, or 0 for a CPU outside the allowed set.
+    static int node_of_cpu(int cpu);
+    // Node the calling thread is running on right now.
+    static int current_node();
+
+    // CPU assigned to pool slot under VIT_PIN_THREADS, or -1 when unpinned.
+    static int slot_cpu(int slot);
+    static bool pin_current_thread(int cpu);
+    // Lets the calling thread run on any CPU of node.
+    static bool pin_current_thread_to_node(int node);
+
+    // Parses "0,2,4-7" into CPU numbers; false on malformed input.
+    static bool parse_cpu_list(const std::string &text, std::vector<int> &cpus);
+    static std::string describe();
+};
+
+#endif // TOPOLOGY_H
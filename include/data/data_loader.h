@@ -0,0 +1,17 @@
+#ifndef DATA_LOADER_H
+#define DATA_LOADER_H
+
+#include "../../include/core/tensor.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Loads labelled 28x28 images from an MNIST-style CSV (header, then
+// "label,p0,...,p783" rows with pixels in 0..255).
+class DataLoader
+{
+public:
+    static std::pair<std::vector<Tensor>, std::vector<int>> load_data(const std::string &filename, int max_samples_to_load = -1, int num_classes_to_load = 10);
+};
+
+#endif // DATA_LOADER_H
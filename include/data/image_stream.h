@@ -0,0 +1,38 @@
+#ifndef IMAGE_STREAM_H
+#define IMAGE_STREAM_H
+
+#include "../../include/core/tensor.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Reads 28x28 images from one or more MNIST-style CSV files a chunk at a
+// time, so inputs of any size run in bounded memory. A path naming a
+// directory expands to every *.csv inside it, in name order. Rows with 785
+// cells are "label,p0,...,p783"; rows with 784 cells carry only pixels and
+// report label -1. A first line that does not start with a number is taken
+// as a header and skipped.
+class ImageStream
+{
+public:
+    explicit ImageStream(const std::string &path);
+
+    // Appends up to max_images images and labels; returns how many were
+    // read (0 once every file is exhausted). Malformed rows are skipped and
+    // counted in skipped_rows.
+    int next_batch(std::vector<Tensor> &images, std::vector<int> &labels, int max_images);
+
+    const std::vector<std::string> &files() const { return file_list; }
+    long skipped_rows = 0;
+
+private:
+    std::vector<std::string> file_list;
+    size_t next_file = 0;
+    std::ifstream current;
+    std::string line;
+
+    bool open_next();
+    static bool parse_row(const std::string &row, Tensor &image, int &label);
+};
+
+#endif // IMAGE_STREAM_H
@@ -0,0 +1,81 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "../../include/core/tensor.h"
+#include "vit.h"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Position of the training loop at a batch boundary, including the epoch
+// accumulators so a resumed epoch reports the same totals.
+struct TrainingProgress
+{
+    int epoch = 0;
+    int batch_count = 0;     // batches already applied in this epoch
+    size_t batch_start = 0;  // next position in the epoch's permutation
+    float train_loss = 0.0f; // running epoch sums
+    int train_correct = 0;
+};
+
+// Everything a resumed run needs to continue bit for bit: the weights, the
+// Random state and the current epoch's shuffle permutation (empty at
+// an epoch boundary, where the next epoch shuffles afresh). The optimizer
+// is plain SGD with clipping and gradients are zeroed every batch, so
+// there is no optimizer state to carry.
+struct TrainingState
+{
+    TrainingProgress progress;
+    std::vector<int> permutation;
+    std::string rng_state;
+    std::vector<std::pair<std::string, Tensor>> parameters;
+
+    // Copies the model parameters into this state, reusing its storage.
+    void capture(VisionTransformer &model, const TrainingProgress &progress, const std::vector<int> &permutation);
+    // Writes the parameters and RNG state back; false when the parameter
+    // names or shapes do not match the model.
+    bool restore(VisionTransformer &model) const;
+
+    // Binary, so floats and the RNG round-trip exactly. save() writes a
+    // temporary file and renames it over path, so a crash mid-write keeps
+    // the previous checkpoint intact.
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+};
+
+// Writes checkpoints on a background thread. submit() only copies the
+// state into the back buffer and returns; the writer thread swaps it with
+// the front buffer and serializes that while training continues. If a
+// snapshot is still waiting when the next one arrives, it is replaced:
+// only the latest state matters.
+class AsyncCheckpointWriter
+{
+public:
+    explicit AsyncCheckpointWriter(const std::string &path);
+    ~AsyncCheckpointWriter();
+    AsyncCheckpointWriter(const AsyncCheckpointWriter &) = delete;
+    AsyncCheckpointWriter &operator=(const AsyncCheckpointWriter &) = delete;
+
+    void submit(VisionTransformer &model, const TrainingProgress &progress, const std::vector<int> &permutation);
+    // Blocks until every submitted snapshot is on disk.
+    void flush();
+    int written() const;
+    int failed() const;
+
+private:
+    std::string path;
+    TrainingState back, front;
+    bool has_pending = false, writing = false, stopping = false;
+    int num_written = 0, num_failed = 0;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,159 @@
+#ifndef COMPILED_VISION_TRANSFORMER_H
+#define COMPILED_VISION_TRANSFORMER_H
+
+#include "../../include/core/tensor.h"
+#include "../../include/core/gemm.h"
+#include "vit.h"
+#include <string>
+#include <vector>
+
+// Inference-time reduction of the patch tokens entering each block. Prune
+// keeps the rows with the largest L2 norm; Merge pairs each even patch with
+// its most cosine-similar odd patch (bipartite matching) and averages the
+// closest pairs, weighted by how many patches each row already stands for
+// (so at most half of the patches can merge in front of one block).
+// The CLS row is never touched and kept rows stay in their original order.
+struct TokenReduction
+{
+    enum class Mode
+    {
+        None,
+        Prune,
+        Merge
+    };
+
+    Mode mode = Mode::None;
+    std::vector<float> keep_ratios; // fraction of patch tokens kept in front of block l; missing entries keep all
+
+    bool enabled() const { return mode != Mode::None && !keep_ratios.empty(); }
+    float keep_ratio(int block) const { return block < static_cast<int>(keep_ratios.size()) ? keep_ratios[block] : 1.0f; }
+};
+
+// Confidence thresholds for the early-exit heads: inference stops after
+// block l once the softmax of exit head l reaches thresholds[l]. Missing
+// entries never exit.
+struct ExitPolicy
+{
+    std::vector<float> thresholds;
+
+    bool enabled() const { return !thresholds.empty(); }
+    float threshold(int exit) const { return exit < static_cast<int>(thresholds.size()) ? thresholds[exit] : 2.0f; }
+};
+
+// Inference-only form of a trained VisionTransformer, built once after
+// load_model(). The model is lowered to a flat list of fused ops:
+//
+//   EmbedPatches        x[1..] = patches * W^T + (b + pos[1..]); x[0] is the
+//                       folded constant class_token + pos[0]
+//   NormLinearResidual  x += W' * normalize(x) + b'   (ln1 -> attention_proj)
+//   NormLinearGelu      h  = gelu(W' * normalize(x) + b')   (ln2 -> fc1)
+//   LinearNormResidual  x += ln(W * h + b)   (fc2 with MLP::ln in its epilogue)
+//   NormLinearExit      logits = W' * normalize(x[0]) + b'   (early-exit head
+//                       after a block; only evaluated under an ExitPolicy)
+//   NormLinearHead      logits = W' * normalize(x[0]) + b'   (final_ln -> head)
+//
+// "normalize" is LayerNorm without its affine part: gamma and beta are folded
+// into the following weights (W' = W diag(gamma), b' = b + W beta). Folded
+// weights are prepacked for gemm_packed and every op runs over blocks of
+// token rows. A factorized Linear (W = U V) keeps both factors, gamma folds
+// into V, and its op runs as two thin GEMMs. forward() is const and keeps no state, so a compiled model can
+// be shared between threads.
+class CompiledVisionTransformer
+{
+public:
+    enum class OpKind
+    {
+        EmbedPatches,
+        NormLinearResidual,
+        NormLinearGelu,
+        LinearNormResidual,
+        NormLinearExit,
+        NormLinearHead
+    };
+
+    struct Op
+    {
+        OpKind kind;
+        int in_features, out_features;
+        PackedMatrix weight;
+        PackedMatrix factor;            // low-rank ops: weight is U (out x r), factor is V (r x in)
+        GemmConfig config, factor_config; // tuned configs for weight and factor, see resolve_gemm_configs()
+        std::vector<float> bias;        // out_features, or num_patches x out_features for EmbedPatches
+        std::vector<float> gamma, beta; // LayerNorm applied in the epilogue (LinearNormResidual)
+    };
+
+    int image_size, patch_size, d_model, num_classes, num_patches;
+    float eps;
+    WeightDType weight_dtype = WeightDType::F32; // storage of every packed weight
+    std::vector<int> patch_gather; // image offset for every (patch, pixel)
+    std::vector<float> cls_row;    // class_token + position_embeddings[0]
+    std::vector<Op> ops;
+
+    // Blocks with a token mixer (see LinearAttention) have no compiled op;
+    // compile() throws std::runtime_error for such models.
+    static bool supports(const VisionTransformer &model);
+    // supports(), printing why not to std::cerr for the apps to bail out on.
+    static bool check_supported(const VisionTransformer &model);
+    // weight_dtype selects the storage precision of every packed weight.
+    static CompiledVisionTransformer compile(const VisionTransformer &model, WeightDType weight_dtype = WeightDType::F32);
+    // Bytes of packed weights one forward pass streams through the GEMMs.
+    size_t weight_bytes() const;
+    // The GEMM shapes the ops are tuned for: a full row block of tokens, or
+    // one row for the exit and classification heads.
+    std::vector<GemmShape> gemm_shapes() const;
+    // Looks up every op's GemmConfig for those shapes. compile() does this;
+    // call it again after tuning or toggling GemmTuner so the ops pick up
+    // the new table. Every row block of an op then runs the same config.
+    void resolve_gemm_configs();
+
+    // blocks_run, when given, receives the number of blocks evaluated before
+    // the returned logits (num_layers unless an exit head fired).
+    Tensor forward(const Tensor &image, const TokenReduction &reduction = TokenReduction(),
+                   const ExitPolicy &exits = ExitPolicy(), int *blocks_run = nullptr) const;
+    int predict(const Tensor &image) const;
+
+    // One image part-way through forward(): the token rows and MLP hidden
+    // rows after the last op that ran. forward() is run_ops over all ops;
+    // running contiguous op ranges on different threads, in order, gives
+    // the same logits (see PipelineEngine).
+    struct ForwardState
+    {
+        const Tensor *image = nullptr; // must outlive the state
+        int tokens = 0, block = 0, exit = 0, blocks_run = 0;
+        bool exited = false; // an exit head fired; later ops are skipped
+        std::vector<float> x, h, sizes;
+        Tensor logits;
+    };
+    ForwardState start_forward(const Tensor &image, const TokenReduction &reduction = TokenReduction()) const;
+    void run_ops(ForwardState &state, int first, int last, const TokenReduction &reduction = TokenReduction(),
+                 const ExitPolicy &exits = ExitPolicy()) const;
+
+    // Largest absolute logit difference against the reference model over
+    // num_images random inputs.
+    float max_abs_diff(VisionTransformer &reference, int num_images = 8) const;
+    static std::string op_name(OpKind kind);
+
+private:
+    void buffer_widths(int &hidden_dim, int &max_features) const;
+};
+
+// One copy of a compiled model per NUMA node (see Topology). Each copy is
+// built by a thread bound to its node, so first touch places its packed
+// weights in that node's memory; local() hands a worker the copy of the
+// node it is running on. On a single node no copy is made and the original
+// is shared, so it must outlive the ReplicatedModel.
+class ReplicatedModel
+{
+public:
+    explicit ReplicatedModel(const CompiledVisionTransformer &model);
+
+    int num_replicas() const { return replicas.empty() ? 1 : static_cast<int>(replicas.size()); }
+    const CompiledVisionTransformer &replica(int node) const { return replicas.empty() ? original : replicas[node]; }
+    const CompiledVisionTransformer &local() const;
+
+private:
+    const CompiledVisionTransformer &original;
+    std::vector<CompiledVisionTransformer> replicas; // empty on a single node
+};
+
+#endif // COMPILED_VISION_TRANSFORMER_H
@@ -5,6 +5,7 @@
 #include "linear.h"
 #include "layernorm.h"
 #include "mlp.h"  // TransformerBlock uses MLP
+#include "linear_attention.h"
 #include <memory> // For std::unique_ptr
 
 // Transformer Block mejorado
@@ -14,13 +15,22 @@ public:
     Linear attention_proj; // Simplified attention: just a linear projection
     MLP mlp;
     LayerNorm ln1, ln2; // Pre-norm layers
+    // Optional token mixing in front of attention_proj, which then acts as
+    // its output projection. Without it tokens are never mixed.
+    std::unique_ptr<LinearAttention> token_mixer;
     Tensor last_input, last_attn_out, last_residual1, last_normalized1, last_normalized2;
 
     TransformerBlock(int d_model);
+    TransformerBlock(int d_model, int hidden_dim);
     Tensor forward(const Tensor &input);
-    Tensor backward(const Tensor &grad_output);
+    Tensor forward(Tensor &&input);
+    Tensor backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks = nullptr);
     void update(float lr);
     void zero_grad();
+    void enable_token_mixing(int num_heads);
+
+private:
+    Tensor forward_cached_input();
 };
 
 #endif // TRANSFORMER_BLOCK_H
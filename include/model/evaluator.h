@@ -0,0 +1,74 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include "../../include/core/tensor.h"
+#include "vit.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loss and accuracy of one weight snapshot on the validation and test sets.
+struct EvalResult
+{
+    int epoch = 0;  // 0-based epoch the snapshot was taken in
+    long step = 0;  // optimizer steps applied before the snapshot
+    bool end_of_epoch = false;
+    float val_loss = 0.0f, val_acc = 0.0f;
+    float test_loss = 0.0f, test_acc = 0.0f;
+    double seconds = 0.0; // evaluation time on the worker
+};
+
+// Runs evaluations on a dedicated thread against a private copy of the
+// model, so training keeps going while a snapshot is scored. submit()
+// copies the parameters into a spare buffer (buffers are recycled, so
+// steady state allocates nothing) and queues it; the worker swaps the
+// buffer into its model and evaluates with eval_step, giving exactly the
+// numbers a synchronous pass over the same weights would.
+class BackgroundEvaluator
+{
+public:
+    // architecture supplies the layer shapes (including exit heads) the
+    // snapshots will have. The data sets must outlive the evaluator.
+    BackgroundEvaluator(VisionTransformer &architecture,
+                        const std::vector<Tensor> &val_images, const std::vector<int> &val_labels,
+                        const std::vector<Tensor> &test_images, const std::vector<int> &test_labels);
+    ~BackgroundEvaluator();
+    BackgroundEvaluator(const BackgroundEvaluator &) = delete;
+    BackgroundEvaluator &operator=(const BackgroundEvaluator &) = delete;
+
+    void submit(VisionTransformer &model, int epoch, long step, bool end_of_epoch);
+    // Finished results, in submission order; does not block.
+    std::vector<EvalResult> poll();
+    // Blocks until every submitted snapshot has been evaluated.
+    void flush();
+
+    // Synchronous evaluation of model itself.
+    static EvalResult evaluate(VisionTransformer &model,
+                               const std::vector<Tensor> &val_images, const std::vector<int> &val_labels,
+                               const std::vector<Tensor> &test_images, const std::vector<int> &test_labels);
+
+private:
+    struct Job
+    {
+        EvalResult result;
+        std::vector<Tensor> parameters;
+    };
+
+    const std::vector<Tensor> &val_images, &test_images;
+    const std::vector<int> &val_labels, &test_labels;
+    VisionTransformer model;
+    std::deque<Job> pending;
+    std::vector<std::vector<Tensor>> spare;
+    std::vector<EvalResult> finished;
+    bool busy = false, stopping = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // EVALUATOR_H
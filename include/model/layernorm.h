@@ -15,9 +15,14 @@ public:
     float eps;
     LayerNorm(int d_mod);
     Tensor forward(const Tensor &input);
+    Tensor forward(Tensor &&input);
     Tensor backward(const Tensor &grad_output);
+    Tensor backward(Tensor &&grad_output);
     void update(float lr);
     void zero_grad();
+
+private:
+    Tensor normalize(const Tensor &input);
 };
 
 #endif // LAYERNORM_H
\ No newline at end of file
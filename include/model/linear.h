@@ -2,7 +2,12 @@
 #define LINEAR_H
 
 #include "../../include/core/tensor.h"
+#include "../../include/core/gemm.h"
+#include "low_rank_linear.h"
 #include <algorithm> // For std::max, std::min
+#include <memory>
+
+class TaskGroup;
 
 class Linear
 {
@@ -10,12 +15,29 @@ public:
     Tensor weight, bias;
     Tensor weight_grad, bias_grad;
     Tensor last_input;
+    // Inference copy of weight in microkernel layout; used by forward() when
+    // not training, dropped by update() since it would go stale.
+    PackedMatrix packed_weight;
+    // Optional low-rank factorization used by forward() when not training;
+    // weight then holds U * V. Dropped by update() like packed_weight.
+    std::shared_ptr<LowRankLinear> low_rank;
     bool training;
     Linear(int in_features, int out_features);
+    // While training the input is kept for backward: shared with the
+    // caller's tensor, or moved in when the caller passes a temporary.
     Tensor forward(const Tensor &input);
-    Tensor backward(const Tensor &grad_output);
+    Tensor forward(Tensor &&input);
+    // When weight_grad_tasks is given, the weight/bias gradient is queued on it
+    // and only the input gradient (the critical path) is computed inline.
+    Tensor backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks = nullptr);
+    void accumulate_grads(const Tensor &grad_output);
+    void prepack(WeightDType dtype = WeightDType::F32);
+    void factorize(int rank);
     void update(float lr);
     void zero_grad();
+
+private:
+    Tensor apply(const Tensor &input) const;
 };
 
 #endif // LINEAR_H
\ No newline at end of file
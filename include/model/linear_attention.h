@@ -0,0 +1,42 @@
+#ifndef LINEAR_ATTENTION_H
+#define LINEAR_ATTENTION_H
+
+#include "../../include/core/tensor.h"
+#include "linear.h"
+#include <vector>
+
+class TaskGroup;
+
+// Kernelized self-attention across the token rows. With the feature map
+// phi(x) = elu(x) + 1 every head computes
+//   out_i = phi(q_i) S / (phi(q_i) . z),  S = sum_n phi(k_n)^T v_n,  z = sum_n phi(k_n)
+// so time and memory grow linearly with the number of tokens N
+// (O(N d^2 / heads)) instead of the O(N^2) of softmax attention. Every
+// token, the CLS row included, attends to the whole sequence. Inputs of
+// rank > 2 are a batch over the leading axes, each sample attending only
+// over its own N = dim(-2) tokens.
+class LinearAttention
+{
+public:
+    Linear q_proj, k_proj, v_proj;
+    int num_heads;
+
+    LinearAttention(int d_model, int num_heads);
+    Tensor forward(const Tensor &input);
+    Tensor backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks = nullptr);
+    void update(float lr);
+    void zero_grad();
+    void set_training(bool training);
+    // Bytes of activations kept for backward after the last forward.
+    size_t activation_bytes() const;
+
+private:
+    Tensor last_q, last_k, last_v;
+    Tensor last_phi_q, last_phi_k;
+    Tensor last_output;
+    Tensor last_state; // S per sample and head: [samples, heads, head_dim, head_dim]
+    // z per sample and head, and every row's normaliser phi(q_i) . z.
+    std::vector<float> last_norm, last_denominator;
+};
+
+#endif // LINEAR_ATTENTION_H
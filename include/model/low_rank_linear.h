@@ -0,0 +1,33 @@
+#ifndef LOW_RANK_LINEAR_H
+#define LOW_RANK_LINEAR_H
+
+#include "../../include/core/tensor.h"
+#include "../../include/core/gemm.h"
+#include <vector>
+
+// Rank-r factorization W ~= U * V of a Linear weight (out x in), with
+// U (out x r) and V (r x in) taken from a truncated SVD (singular values
+// folded into U). forward() runs two thin GEMMs, x * V^T then * U^T, which
+// costs r * (in + out) multiply-adds per row instead of in * out.
+class LowRankLinear
+{
+public:
+    Tensor u, v;
+    PackedMatrix packed_u, packed_v;
+
+    LowRankLinear(const Tensor &u_factor, const Tensor &v_factor);
+
+    static LowRankLinear decompose(const Tensor &weight, int rank);
+    // Smallest rank whose singular values keep `energy` of sum(sigma^2).
+    static int rank_for_energy(const Tensor &weight, float energy);
+    // Whether rank r beats the dense in x out product.
+    static bool is_cheaper(int rank, int in_features, int out_features) { return rank * (in_features + out_features) < in_features * out_features; }
+
+    int rank() const { return v.rows; }
+    Tensor reconstruct() const;
+    void prepack(WeightDType dtype = WeightDType::F32);
+    // input * (U V)^T + bias, with bias out x 1 as in Linear.
+    Tensor forward(const Tensor &input, const Tensor &bias) const;
+};
+
+#endif // LOW_RANK_LINEAR_H
@@ -5,6 +5,7 @@
 #include "../../include/core/activation.h" // For Activation::gelu and gelu_derivative
 #include "../../include/model/linear.h"
 #include "../../include/model/layernorm.h"
+#include <vector>
 
 // MLP con Layer Normalization
 class MLP
@@ -18,9 +19,12 @@ public:
 
     MLP(int d_model, int hidden_dim);
     Tensor forward(const Tensor &input);
-    Tensor backward(const Tensor &grad_output);
+    Tensor backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks = nullptr);
     void update(float lr);
     void zero_grad();
+    // Keeps only the listed hidden units, in the given order: fc1 loses the
+    // other output rows and fc2 the matching input columns.
+    void prune_hidden(const std::vector<int> &keep);
 };
 
 #endif // MLP_H
@@ -0,0 +1,92 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "../../include/core/tensor.h"
+#include "compiled_vit.h"
+#include <memory>
+#include <vector>
+
+struct PipelineOptions
+{
+    int num_stages = 2;
+    int micro_batch = 4;       // images handed from stage to stage at once
+    int queue_depth = 4;       // micro-batches buffered between two stages
+    int threads_per_stage = 1; // Parallel budget inside each stage
+};
+
+struct StageStats
+{
+    int first_op, last_op; // ops [first_op, last_op) of the compiled model
+    double busy_seconds;
+    double utilization; // busy_seconds / wall time of the run
+};
+
+struct PipelineStats
+{
+    long images = 0;
+    double seconds = 0.0;
+    std::vector<StageStats> stages;
+
+    double images_per_second() const { return seconds > 0.0 ? images / seconds : 0.0; }
+};
+
+// Streaming inference over a compiled model split into contiguous op
+// ranges (patch embedding, the ops of each block, the head), one stage
+// thread per range, joined by bounded SPSC rings. Micro-batches flow
+// through the stages, so up to num_stages of them are in flight at once.
+// Stage boundaries come from per-op timings measured on a sample image,
+// chosen to minimise the slowest stage. Results match forward() exactly.
+//
+// The stage threads start with the first submit() and live until the
+// engine is destroyed, so consecutive submissions stream through without
+// draining the pipeline in between. With VIT_PIN_THREADS they are pinned to
+// CPUs past the TaskScheduler's slots, or left unpinned when none is free.
+class PipelineEngine
+{
+public:
+    PipelineEngine(const CompiledVisionTransformer &model, const PipelineOptions &options, const Tensor &sample);
+    ~PipelineEngine();
+    PipelineEngine(const PipelineEngine &) = delete;
+    PipelineEngine &operator=(const PipelineEngine &) = delete;
+
+    // Queues images behind everything submitted before and returns at once;
+    // they must stay alive until collected. Call from one thread only.
+    void submit(const std::vector<Tensor> &images);
+    // Logits of the next count submitted images, in submission order.
+    std::vector<Tensor> collect(int count);
+    // submit() then collect() with nothing else in flight; stats covers
+    // this call only.
+    std::vector<Tensor> run(const std::vector<Tensor> &images, PipelineStats *stats = nullptr);
+    // Since the stage threads started: images collected, seconds with
+    // images in flight and the busy time of every stage.
+    PipelineStats totals() const;
+
+    int num_stages() const { return static_cast<int>(boundaries.size()) - 1; }
+    // Stage s runs ops [boundaries[s], boundaries[s + 1]).
+    const std::vector<int> &stage_boundaries() const { return boundaries; }
+    // Stops the stage threads, which restart with the next submit(); nothing
+    // may be in flight.
+    void set_stage_boundaries(const std::vector<int> &stage_boundaries);
+    // Measured single-thread seconds of every op and their sum per stage.
+    const std::vector<double> &op_seconds() const { return op_costs; }
+    std::vector<double> stage_seconds() const;
+
+    static std::vector<double> profile_ops(const CompiledVisionTransformer &model, const Tensor &sample, int repeats = 16);
+    // Contiguous split of costs into at most num_stages ranges that
+    // minimises the largest range sum.
+    static std::vector<int> balance(const std::vector<double> &costs, int num_stages);
+
+private:
+    struct Stream; // stage threads, queues and counters of a running pipeline
+
+    void start();
+    void stop();
+
+    const CompiledVisionTransformer &model;
+    PipelineOptions options;
+    std::vector<double> op_costs;
+    std::vector<int> boundaries;
+    std::unique_ptr<Stream> stream;
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,89 @@
+#ifndef PREDICTION_CACHE_H
+#define PREDICTION_CACHE_H
+
+#include "../../include/core/tensor.h"
+#include "../../include/core/half.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Bounded cache of output logits keyed by image contents. Keys are two
+// independent 64-bit hashes of the image bytes, so a false hit needs a
+// 128-bit collision. Entries are split over shards by key, each shard with
+// its own mutex and LRU list, so concurrent lookups rarely contend.
+//
+// Logits only make sense for the model that produced them: bind_model()
+// records the model checksum and drops every entry when it changes, and
+// the checksum is stored with a persisted cache so load() ignores a file
+// written for another model.
+class PredictionCache
+{
+public:
+    struct Stats
+    {
+        long hits = 0, misses = 0, evictions = 0;
+        std::size_t entries = 0;
+    };
+
+    explicit PredictionCache(std::size_t capacity, int num_shards = 16);
+
+    // Cache configured by VIT_CACHE_SIZE (entries; unset or 0 disables it)
+    // and VIT_CACHE_FILE (optional persistence path, loaded here when it
+    // matches the model). Returns nullptr when caching is disabled.
+    static std::unique_ptr<PredictionCache> from_env(uint64_t model_checksum);
+    // Checksum of a checkpoint compiled with weight_dtype: the same file
+    // gives different logits at each weight precision.
+    static uint64_t checksum_for(const std::string &model_path, WeightDType weight_dtype);
+    // Saves to VIT_CACHE_FILE when it is set.
+    bool save_to_env() const;
+
+    void bind_model(uint64_t checksum);
+    uint64_t model() const { return model_checksum; }
+
+    // Copies the cached logits into logits and refreshes the entry.
+    bool lookup(const Tensor &image, Tensor &logits);
+    void insert(const Tensor &image, const Tensor &logits);
+    void clear();
+    Stats stats() const;
+
+    // Entries are written least recently used first, so load() restores the
+    // LRU order. load() returns false (and keeps the cache empty) when the
+    // file is missing, malformed or belongs to another model.
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+private:
+    struct Key
+    {
+        uint64_t lo, hi;
+        bool operator==(const Key &other) const { return lo == other.lo && hi == other.hi; }
+    };
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const { return key.lo; }
+    };
+    struct Shard
+    {
+        std::mutex mutex;
+        std::list<std::pair<Key, std::vector<float>>> lru; // front = most recent
+        std::unordered_map<Key, std::list<std::pair<Key, std::vector<float>>>::iterator, KeyHash> index;
+    };
+
+    std::size_t shard_capacity;
+    uint64_t model_checksum = 0;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<long> hits{0}, misses{0}, evictions{0};
+
+    static Key key_of(const Tensor &image);
+    Shard &shard_of(const Key &key) const { return *shards[key.hi % shards.size()]; }
+    void insert_key(const Key &key, std::vector<float> values);
+};
+
+#endif // PREDICTION_CACHE_H
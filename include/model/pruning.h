@@ -0,0 +1,34 @@
+#ifndef PRUNING_H
+#define PRUNING_H
+
+#include "../../include/core/tensor.h"
+#include "vit.h"
+#include <vector>
+
+// Structured pruning of a trained VisionTransformer: whole MLP hidden units
+// are removed, so fc1/fc2 become physically smaller and the checkpoint
+// stores the reduced per-layer widths. attention_proj reads and writes the
+// residual stream (d_model on both sides), so it has no internal width to
+// remove.
+class StructuredPruning
+{
+public:
+    enum class Criterion
+    {
+        Magnitude, // ||fc1 row j|| * ||fc2 column j||
+        Gradient   // first-order Taylor: sum |w * dL/dw| over fc1 row j, its bias and fc2 column j
+    };
+
+    // One score per hidden unit of every block. Gradient accumulates dL/dw
+    // over the calibration samples without updating the weights, and leaves
+    // the model in inference mode with its gradients cleared.
+    static std::vector<std::vector<float>> mlp_importance(VisionTransformer &model, Criterion criterion,
+                                                          const std::vector<Tensor> &images = {},
+                                                          const std::vector<int> &labels = {});
+
+    // Drops the least important `sparsity` fraction of every block's hidden
+    // units (at least one survives) and repacks the model for inference.
+    static void prune_mlp(VisionTransformer &model, const std::vector<std::vector<float>> &importance, float sparsity);
+};
+
+#endif // PRUNING_H
@@ -0,0 +1,335 @@
+#ifndef STATIC_VISION_TRANSFORMER_H
+#define STATIC_VISION_TRANSFORMER_H
+
+#include "../../include/core/tensor.h"
+#include "../../include/core/activation.h"
+#include "../../include/core/parallel.h"
+#include "compiled_vit.h"
+#include <array>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Common interface of the shape-specialized models, so callers can hold any
+// specialization picked by make_static_model().
+class StaticModelBase
+{
+public:
+    virtual ~StaticModelBase() = default;
+    virtual Tensor forward(const Tensor &image) const = 0;
+    virtual std::string config() const = 0;
+    int predict(const Tensor &image) const { return Activation::argmax(forward(image)); }
+};
+
+// CompiledVisionTransformer with every extent fixed at compile time. Weights
+// live in std::array members (in 8-column panels), inner loops have constant
+// trip counts, and forward() keeps every activation on the stack instead of
+// in heap-allocated Tensors, with no per-op dispatch or parallel region.
+template <int ImageSize, int PatchSize, int DModel, int Layers, int Classes>
+class StaticVisionTransformer : public StaticModelBase
+{
+public:
+    static constexpr int kPatchDim = PatchSize * PatchSize;
+    static constexpr int kPatchesPerRow = ImageSize / PatchSize;
+    static constexpr int kPatches = kPatchesPerRow * kPatchesPerRow;
+    static constexpr int kTokens = kPatches + 1;
+    // Tokens run through the blocks kTile rows at a time; the activation
+    // buffer is padded to a whole number of tiles.
+    static constexpr int kTile = 4;
+    static constexpr int kPaddedTokens = (kTokens + kTile - 1) / kTile * kTile;
+    static constexpr int kHidden = DModel * 2;
+
+    struct Block
+    {
+        std::array<float, DModel * DModel> attn_w;
+        std::array<float, DModel> attn_b;
+        std::array<float, DModel * kHidden> fc1_w;
+        std::array<float, kHidden> fc1_b;
+        std::array<float, kHidden * DModel> fc2_w;
+        std::array<float, DModel> fc2_b, ln_gamma, ln_beta;
+    };
+
+    float eps;
+    std::array<float, kPatchDim * DModel> embed_w;
+    std::array<float, kPatches * DModel> embed_b;
+    std::array<float, DModel> cls_row;
+    std::array<Block, Layers> blocks;
+    std::array<float, DModel * Classes> head_w;
+    std::array<float, Classes> head_b;
+
+    // The ops of the main path; early-exit heads are not specialized.
+    static std::vector<const CompiledVisionTransformer::Op *> main_ops(const CompiledVisionTransformer &model)
+    {
+        std::vector<const CompiledVisionTransformer::Op *> main;
+        for (const auto &op : model.ops)
+        {
+            if (op.kind != CompiledVisionTransformer::OpKind::NormLinearExit)
+                main.push_back(&op);
+        }
+        return main;
+    }
+
+    static bool matches(const CompiledVisionTransformer &model)
+    {
+        const auto ops = main_ops(model);
+        if (model.image_size != ImageSize || model.patch_size != PatchSize || model.d_model != DModel ||
+            model.num_classes != Classes || static_cast<int>(ops.size()) != 3 * Layers + 2)
+            return false;
+        for (int l = 0; l < Layers; l++)
+        {
+            if (ops[1 + 3 * l + 1]->out_features != kHidden)
+                return false;
+        }
+        for (const auto *op : ops)
+        {
+            if (!op->factor.empty())
+                return false;
+        }
+        return true;
+    }
+
+    explicit StaticVisionTransformer(const CompiledVisionTransformer &model) : eps(model.eps)
+    {
+        const auto ops = main_ops(model);
+        unpack(ops[0]->weight, embed_w.data());
+        std::copy(ops[0]->bias.begin(), ops[0]->bias.end(), embed_b.begin());
+        std::copy(model.cls_row.begin(), model.cls_row.end(), cls_row.begin());
+        for (int l = 0; l < Layers; l++)
+        {
+            const auto &attn = *ops[1 + 3 * l];
+            const auto &fc1 = *ops[2 + 3 * l];
+            const auto &fc2 = *ops[3 + 3 * l];
+            Block &block = blocks[l];
+            unpack(attn.weight, block.attn_w.data());
+            std::copy(attn.bias.begin(), attn.bias.end(), block.attn_b.begin());
+            unpack(fc1.weight, block.fc1_w.data());
+            std::copy(fc1.bias.begin(), fc1.bias.end(), block.fc1_b.begin());
+            unpack(fc2.weight, block.fc2_w.data());
+            std::copy(fc2.bias.begin(), fc2.bias.end(), block.fc2_b.begin());
+            std::copy(fc2.gamma.begin(), fc2.gamma.end(), block.ln_gamma.begin());
+            std::copy(fc2.beta.begin(), fc2.beta.end(), block.ln_beta.begin());
+        }
+        const auto &head = *ops.back();
+        unpack(head.weight, head_w.data());
+        std::copy(head.bias.begin(), head.bias.end(), head_b.begin());
+    }
+
+    std::string config() const override
+    {
+        return std::to_string(ImageSize) + "/" + std::to_string(PatchSize) + "/" + std::to_string(DModel) + "/" +
+               std::to_string(Layers) + "/" + std::to_string(Classes);
+    }
+
+    Tensor forward(const Tensor &image) const override
+    {
+        assert(image.rows == ImageSize && image.cols == ImageSize);
+
+        std::array<float, kPaddedTokens * DModel> x;
+        const Tensor pixels = image.contiguous();
+        struct Context
+        {
+            const StaticVisionTransformer *model;
+            const float *pixels;
+            float *x;
+        } ctx{this, pixels.values(), x.data()};
+        // Tokens are independent through the whole stack, so each worker runs
+        // every block over its own range of tiles. The single-pointer capture
+        // keeps the std::function in its inline buffer.
+        Parallel::parallel_for(0, kPaddedTokens / kTile, Parallel::grain_size(4L * kTile * Layers * DModel * kHidden), [c = &ctx](int begin, int end)
+                               {
+            const int t0 = begin * kTile, rows = (end - begin) * kTile;
+            float *x_rows = c->x + t0 * DModel;
+            c->model->embed_rows(c->pixels, t0, rows, x_rows);
+            c->model->run_blocks(x_rows, rows); });
+
+        std::array<float, DModel> n;
+        normalize(x.data(), n.data());
+        Tensor logits(1, Classes);
+        matmul<DModel, Classes>(n.data(), 1, head_w.data(), head_b.data(), logits.data.data());
+        return logits;
+    }
+
+private:
+    typedef float vec8 __attribute__((vector_size(32)));
+
+    // Copies a packed (out x in) weight into the layout matmul reads: 8-column
+    // panels stored k-major when out is a multiple of 8, row-major in x out
+    // otherwise.
+    static void unpack(const PackedMatrix &packed, float *dst)
+    {
+        for (int k = 0; k < packed.cols; k++)
+        {
+            for (int o = 0; o < packed.rows; o++)
+            {
+                if (packed.rows % 8 == 0)
+                    dst[(o / 8) * packed.cols * 8 + k * 8 + o % 8] = packed.at(o, k);
+                else
+                    dst[k * packed.rows + o] = packed.at(o, k);
+            }
+        }
+    }
+
+    // y[rows x Out] = x[rows x In] * W^T + b with W laid out by unpack().
+    // Each 8-column panel stays in L1 while every kTile-row group of x streams
+    // past it; In and Out are constants, so the k loop has a fixed trip count.
+    template <int In, int Out>
+    static void matmul(const float *x, int rows, const float *w, const float *b, float *y)
+    {
+        if constexpr (Out % 8 == 0)
+        {
+            static_assert(kTile == 4, "the register tile below holds four rows");
+            for (int v = 0; v < Out / 8; v++)
+            {
+                const float *panel = w + v * In * 8;
+                for (int r0 = 0; r0 < rows; r0 += kTile)
+                {
+                    const float *a = x + r0 * In;
+                    vec8 acc0 = {}, acc1 = {}, acc2 = {}, acc3 = {};
+                    for (int k = 0; k < In; k++)
+                    {
+                        vec8 wv;
+                        __builtin_memcpy(&wv, panel + k * 8, sizeof(wv));
+                        acc0 += a[k] * wv;
+                        acc1 += a[In + k] * wv;
+                        acc2 += a[2 * In + k] * wv;
+                        acc3 += a[3 * In + k] * wv;
+                    }
+                    for (int j = 0; j < 8; j++)
+                    {
+                        y[r0 * Out + v * 8 + j] = acc0[j] + b[v * 8 + j];
+                        y[(r0 + 1) * Out + v * 8 + j] = acc1[j] + b[v * 8 + j];
+                        y[(r0 + 2) * Out + v * 8 + j] = acc2[j] + b[v * 8 + j];
+                        y[(r0 + 3) * Out + v * 8 + j] = acc3[j] + b[v * 8 + j];
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (int r = 0; r < rows; r++)
+            {
+                float acc[Out] = {};
+                for (int k = 0; k < In; k++)
+                {
+                    const float xk = x[r * In + k];
+                    for (int o = 0; o < Out; o++)
+                    {
+                        acc[o] += xk * w[k * Out + o];
+                    }
+                }
+                for (int o = 0; o < Out; o++)
+                {
+                    y[r * Out + o] = acc[o] + b[o];
+                }
+            }
+        }
+    }
+
+    void normalize(const float *x, float *out) const
+    {
+        float mean = 0.0f;
+        for (int j = 0; j < DModel; j++)
+        {
+            mean += x[j];
+        }
+        mean /= DModel;
+        float var = 0.0f;
+        for (int j = 0; j < DModel; j++)
+        {
+            float diff = x[j] - mean;
+            var += diff * diff;
+        }
+        var /= DModel;
+        float inv_std = 1.0f / std::sqrt(var + eps);
+        for (int j = 0; j < DModel; j++)
+        {
+            out[j] = (x[j] - mean) * inv_std;
+        }
+    }
+
+    // Fills token rows [t0, t0 + rows): the CLS row, embedded patches, and
+    // zero padding past the last token.
+    void embed_rows(const float *pixels, int t0, int rows, float *x) const
+    {
+        std::array<float, kPaddedTokens * kPatchDim> patches{};
+        for (int r = 0; r < rows; r++)
+        {
+            const int p = t0 + r - 1;
+            if (p < 0 || p >= kPatches)
+                continue;
+            const int row0 = (p / kPatchesPerRow) * PatchSize, col0 = (p % kPatchesPerRow) * PatchSize;
+            for (int pi = 0; pi < PatchSize; pi++)
+            {
+                for (int pj = 0; pj < PatchSize; pj++)
+                {
+                    patches[r * kPatchDim + pi * PatchSize + pj] = pixels[(row0 + pi) * ImageSize + col0 + pj];
+                }
+            }
+        }
+        std::array<float, DModel> zero{};
+        matmul<kPatchDim, DModel>(patches.data(), rows, embed_w.data(), zero.data(), x);
+        for (int r = 0; r < rows; r++)
+        {
+            const int p = t0 + r - 1;
+            float *row = x + r * DModel;
+            if (p < 0)
+                std::copy(cls_row.begin(), cls_row.end(), row);
+            else if (p >= kPatches)
+                std::fill(row, row + DModel, 0.0f);
+            else
+            {
+                for (int j = 0; j < DModel; j++)
+                {
+                    row[j] += embed_b[p * DModel + j];
+                }
+            }
+        }
+    }
+
+    void run_blocks(float *x, int rows) const
+    {
+        std::array<float, kPaddedTokens * DModel> n{}, out;
+        std::array<float, kPaddedTokens * kHidden> h;
+        for (const Block &block : blocks)
+        {
+            for (int r = 0; r < rows; r++)
+            {
+                normalize(x + r * DModel, n.data() + r * DModel);
+            }
+            matmul<DModel, DModel>(n.data(), rows, block.attn_w.data(), block.attn_b.data(), out.data());
+            for (int i = 0; i < rows * DModel; i++)
+            {
+                x[i] += out[i];
+            }
+
+            for (int r = 0; r < rows; r++)
+            {
+                normalize(x + r * DModel, n.data() + r * DModel);
+            }
+            matmul<DModel, kHidden>(n.data(), rows, block.fc1_w.data(), block.fc1_b.data(), h.data());
+            for (int i = 0; i < rows * kHidden; i++)
+            {
+                h[i] = Activation::gelu(h[i]);
+            }
+
+            matmul<kHidden, DModel>(h.data(), rows, block.fc2_w.data(), block.fc2_b.data(), out.data());
+            for (int r = 0; r < rows; r++)
+            {
+                float *n_row = n.data() + r * DModel;
+                float *x_row = x + r * DModel;
+                normalize(out.data() + r * DModel, n_row);
+                for (int j = 0; j < DModel; j++)
+                {
+                    x_row[j] += block.ln_gamma[j] * n_row[j] + block.ln_beta[j];
+                }
+            }
+        }
+    }
+};
+
+// Returns the specialization matching the compiled model's configuration,
+// or nullptr when none was built for it (callers keep the dynamic path).
+std::unique_ptr<StaticModelBase> make_static_model(const CompiledVisionTransformer &model);
+
+#endif // STATIC_VISION_TRANSFORMER_H
@@ -4,6 +4,7 @@
 #include "../../include/core/tensor.h"
 #include "../../include/core/activation.h" // For Activation::softmax
 #include "../../include/core/random.h"     // For Random::randn
+#include "../../include/core/gemm_tuner.h"
 #include "linear.h"
 #include "layernorm.h"
 #include "encoder.h" // VisionTransformer uses TransformerBlock
@@ -11,6 +12,17 @@
 #include <memory>    // For std::unique_ptr
 #include <cmath>     // For log, max
 #include <numeric>   // For iota (though not directly used in VT, good to have for related utilities)
+#include <functional>
+#include <string>
+#include <utility>
+
+// Result of a single forward pass over one labelled sample.
+struct StepResult
+{
+    float loss;
+    int prediction;
+    Tensor logits;
+};
 
 // Vision Transformer mejorado
 class VisionTransformer
@@ -24,21 +36,67 @@ public:
     Linear classification_head;
     LayerNorm final_ln;
 
+    // Optional early-exit classifiers reading the CLS row after every block
+    // but the last one, which already feeds final_ln / classification_head.
+    std::vector<std::unique_ptr<LayerNorm>> exit_lns;
+    std::vector<std::unique_ptr<Linear>> exit_heads;
+    float exit_loss_weight;
+
     // For backpropagation: store intermediate results
     Tensor last_patches;
     Tensor last_logits; // Store the final logits for loss calculation and backward pass
+    std::vector<Tensor> last_exit_logits;
+    // Precision of the Linear weights in the last loaded checkpoint.
+    WeightDType checkpoint_dtype;
 
     VisionTransformer(int img_size, int patch_sz, int d_mod, int n_layers, int n_classes);
 
     Tensor image_to_patches(const Tensor &image);
     Tensor forward(const Tensor &image);
     void backward(int true_label);
+    // exit_grad_logits, when given, holds one gradient per exit head.
+    void backward_from_logits(const Tensor &grad_logits, const std::vector<Tensor> *exit_grad_logits = nullptr);
+    // One forward pass plus fused softmax-cross-entropy; train_step also
+    // backpropagates the gradient produced by that same kernel. With exit
+    // heads, each one adds exit_loss_weight times its own cross-entropy to
+    // the objective; the reported loss is still the main head's.
+    StepResult train_step(const Tensor &image, int true_label);
+    StepResult eval_step(const Tensor &image, int true_label);
     float compute_loss(const Tensor &logits, int true_label);
     void update_weights(float lr);
     void zero_grad();
     int predict(const Tensor &image);
+    void set_training(bool training);
+    size_t num_parameters() const;
+    // Every trainable tensor under the name save_model() gives it (dense
+    // weights only; low-rank factors are an inference-time form).
+    std::vector<std::pair<std::string, Tensor *>> named_parameters();
+    // Gradient tensors grouped in the order backward_from_logits finalizes
+    // them: bucket 0 is the classification head and final_ln, bucket
+    // num_layers - i is block i together with its exit head, and the last
+    // bucket is the patch embedding.
+    std::vector<std::vector<Tensor *>> gradient_buckets();
+    int num_gradient_buckets() const { return num_layers + 2; }
+    // When set, backward_from_logits calls it with each bucket index, in
+    // order, as soon as that bucket's gradients are complete, so a
+    // data-parallel trainer can reduce them while later layers are still
+    // backpropagating.
+    std::function<void(int)> on_gradients_ready;
+    void enable_exit_heads();
+    bool has_exit_heads() const { return !exit_heads.empty(); }
+    // Linear attention across tokens in every block (see LinearAttention);
+    // 0 heads means blocks do not mix tokens, as originally.
+    void enable_token_mixing(int num_heads);
+    int token_mixing_heads() const;
+    // Packs every Linear weight for inference; load_model() calls it with
+    // the precision the checkpoint stored its weights in.
+    void prepack_weights(WeightDType dtype = WeightDType::F32);
+    // Every distinct GEMM an inference forward pass runs, for GemmTuner.
+    std::vector<GemmShape> gemm_shapes() const;
     void load_model(const std::string &filename);
-    void save_model(const std::string &filename) const;
+    // weight_dtype F16/BF16 stores every Linear weight (or low-rank factor)
+    // as 16-bit codes; embeddings, biases and norms stay fp32.
+    void save_model(const std::string &filename, WeightDType weight_dtype = WeightDType::F32) const;
 };
 
 #endif // VISION_TRANSFORMER_H
@@ -9,10 +9,50 @@ show_help() {
     echo ""
     echo "Comandos disponibles:"
     echo "  train <train.csv> <test.csv>     - Entrenar modelo"
+    echo "  launch <procesos> <shm|tcp> <train.csv> <test.csv>"
+    echo "                                   - Entrenar con varios procesos en paralelo de datos"
+    echo "  sweep <spec.txt> <train.csv> <resultados.csv>"
+    echo "                                   - Barrido de hiperparámetros con successive halving"
     echo "  infer <modelo.bin> <imagen.csv>  - Hacer inferencia"
     echo "  predict                          - Extraer imagen y predecir"
+    echo "  batch <modelo.bin> <entrada.csv|directorio> <salida.csv> [top-k] [tamaño_lote]"
+    echo "                                   - Clasificar archivos completos y guardar las predicciones"
+    echo "  prune <modelo.bin> <train.csv> <test.csv> <sparsity> [magnitude|gradient] [épocas]"
+    echo "                                   - Podar unidades del MLP y guardar el modelo reducido"
+    echo "  factorize <modelo.bin> <test.csv> <energía|rango>"
+    echo "                                   - Factorizar capas con SVD truncada y guardar el modelo"
+    echo "  convert <modelo.bin> <test.csv> <f16|bf16>"
+    echo "                                   - Guardar los pesos en media precisión y comparar"
+    echo "  tune <modelo.bin | d_model capas> [f32|f16|bf16]"
+    echo "                                   - Ajustar las GEMM del modelo a esta CPU y guardar la caché"
     echo "  clean                            - Limpiar archivos build"
     echo ""
+    echo "Variables de entorno:"
+    echo "  VIT_NUM_THREADS=<n>              - Hilos por operador (por defecto: todos los núcleos)"
+    echo "  VIT_TOKEN_MODE=prune|merge       - Reducir tokens entre bloques en inferencia"
+    echo "  VIT_TOKEN_KEEP=<r0,r1,...>       - Fracción de tokens conservada antes de cada bloque"
+    echo "  VIT_EXIT_HEADS=1                 - Entrenar cabezas de salida temprana tras cada bloque"
+    echo "  VIT_TOKEN_MIXER=linear           - Mezclar tokens con atención lineal en cada bloque (coste O(N))"
+    echo "  VIT_MIXER_HEADS=<n>              - Cabezas de la atención lineal (por defecto: 4)"
+    echo "  VIT_CHECKPOINT=<ruta>            - Guardar el estado de entrenamiento en segundo plano"
+    echo "  VIT_CHECKPOINT_EVERY=<lotes>     - Lotes entre checkpoints (por defecto: 10, y al final de cada época)"
+    echo "  VIT_RESUME=1                     - Reanudar el entrenamiento desde VIT_CHECKPOINT"
+    echo "  VIT_EVAL_EVERY=<pasos>           - Evaluar también cada n pasos (además de cada época)"
+    echo "  VIT_EVAL_ASYNC=0                 - Evaluar en el hilo de entrenamiento en vez de en segundo plano"
+    echo "  VIT_EXIT_THRESHOLD=<t0,t1,...>   - Confianza para salir tras cada bloque en inferencia"
+    echo "  VIT_WEIGHT_DTYPE=f32|f16|bf16    - Precisión de los pesos empaquetados en inferencia"
+    echo "  VIT_CACHE_SIZE=<n>               - Cachear las predicciones de hasta n imágenes repetidas"
+    echo "  VIT_CACHE_FILE=<ruta>            - Conservar la caché de predicciones entre ejecuciones"
+    echo "  VIT_PIPELINE_STAGES=<n>          - batch_infer: repartir las capas en n etapas encadenadas (pipeline)"
+    echo "  VIT_GEMM_TUNING=<ruta>|off       - Caché de ajuste de GEMM por CPU (por defecto: models/gemm_tuning.txt)"
+    echo "  VIT_GEMM_TUNE=0|1                - batch_infer: no ajustar formas nuevas / reajustar todas"
+    echo "  VIT_DIST_ADDR=<host:puerto,...>  - Direcciones de launch tcp (o nombre del segmento shm)"
+    echo "  VIT_DIST_TIMEOUT=<s>             - Espera máxima entre procesos (por defecto: 300)"
+    echo "  VIT_HUGE_PAGES=off|thp|hugetlb   - Páginas de 2 MB para pesos y datos (por defecto: thp)"
+    echo "  VIT_PIN_THREADS=compact|scatter|<cpus>"
+    echo "                                   - Fijar los hilos a CPUs (p. ej. 0,2,4-7)"
+    echo "  VIT_NUMA_NODES=<n>               - Simular n nodos NUMA repartiendo las CPUs"
+    echo ""
     echo "Ejemplos:"
     echo "  ./run.sh train data/mnist/mnist_train.csv data/mnist/mnist_test.csv"
     echo "  ./run.sh infer models/modelo.bin data/predict/imagen.csv"
@@ -28,6 +68,12 @@ fi
 COMMAND=$1
 shift
 
+# El heap de malloc (imágenes, activaciones) también usa páginas grandes
+# salvo con VIT_HUGE_PAGES=off.
+if [ "${VIT_HUGE_PAGES:-thp}" != "off" ] && [ "${VIT_HUGE_PAGES:-thp}" != "0" ]; then
+    export GLIBC_TUNABLES="${GLIBC_TUNABLES:+$GLIBC_TUNABLES:}glibc.malloc.hugetlb=1"
+fi
+
 case $COMMAND in
     "train")
         if [ $# -ne 2 ]; then
@@ -48,6 +94,44 @@ case $COMMAND in
         fi
         ;;
         
+    "launch")
+        if [ $# -ne 4 ]; then
+            echo "Error: launch requiere 4 argumentos"
+            echo "Uso: ./run.sh launch <procesos> <shm|tcp> <train.csv> <test.csv>"
+            exit 1
+        fi
+
+        echo "Compilando entrenamiento distribuido..."
+        make launch
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando entrenamiento distribuido..."
+            ./${BUILD_DIR}/launch.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
+    "sweep")
+        if [ $# -ne 3 ]; then
+            echo "Error: sweep requiere 3 argumentos"
+            echo "Uso: ./run.sh sweep <spec.txt> <train.csv> <resultados.csv>"
+            exit 1
+        fi
+
+        echo "Compilando barrido..."
+        make sweep
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando barrido..."
+            ./${BUILD_DIR}/sweep.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
     "infer")
         if [ $# -ne 2 ]; then
             echo "Error: infer requiere 2 argumentos"
@@ -91,6 +175,101 @@ case $COMMAND in
         ./${BUILD_DIR}/infer.out "$MODEL" "$IMAGE"
         ;;
         
+    "batch")
+        if [ $# -lt 3 ]; then
+            echo "Error: batch requiere al menos 3 argumentos"
+            echo "Uso: ./run.sh batch <modelo.bin> <entrada.csv|directorio> <salida.csv> [top-k] [tamaño_lote]"
+            exit 1
+        fi
+
+        echo "Compilando inferencia por lotes..."
+        make batch_infer
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando inferencia por lotes..."
+            ./${BUILD_DIR}/batch_infer.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
+    "prune")
+        if [ $# -lt 4 ]; then
+            echo "Error: prune requiere al menos 4 argumentos"
+            echo "Uso: ./run.sh prune <modelo.bin> <train.csv> <test.csv> <sparsity> [magnitude|gradient] [épocas]"
+            exit 1
+        fi
+
+        echo "Compilando poda..."
+        make prune
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando poda..."
+            ./${BUILD_DIR}/prune.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
+    "factorize")
+        if [ $# -ne 3 ]; then
+            echo "Error: factorize requiere 3 argumentos"
+            echo "Uso: ./run.sh factorize <modelo.bin> <test.csv> <energía|rango>"
+            exit 1
+        fi
+
+        echo "Compilando factorización..."
+        make factorize
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando factorización..."
+            ./${BUILD_DIR}/factorize.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
+    "convert")
+        if [ $# -ne 3 ]; then
+            echo "Error: convert requiere 3 argumentos"
+            echo "Uso: ./run.sh convert <modelo.bin> <test.csv> <f16|bf16>"
+            exit 1
+        fi
+
+        echo "Compilando conversión..."
+        make convert
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando conversión..."
+            ./${BUILD_DIR}/convert.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
+    "tune")
+        if [ $# -lt 1 ]; then
+            echo "Error: tune requiere al menos 1 argumento"
+            echo "Uso: ./run.sh tune <modelo.bin | d_model capas> [f32|f16|bf16]"
+            exit 1
+        fi
+
+        echo "Compilando ajuste de GEMM..."
+        make tune
+
+        if [ $? -eq 0 ]; then
+            echo "Ejecutando ajuste de GEMM..."
+            ./${BUILD_DIR}/tune.out "$@"
+        else
+            echo "Error en compilación"
+            exit 1
+        fi
+        ;;
+
     "clean")
         echo "Limpiando archivos build..."
         make clean
@@ -1,4 +1,5 @@
 #include "../../include/core/activation.h"
+#include "../../include/core/parallel.h"
 
 float Activation::relu(float x)
 {
@@ -25,34 +26,82 @@ float Activation::gelu_derivative(float x)
 
 Tensor Activation::apply(const Tensor &input, float (*func)(float))
 {
-    Tensor result(input.rows, input.cols);
-    for (int i = 0; i < input.rows * input.cols; i++)
-    {
-        result.data[i] = func(input.data[i]);
-    }
+    Tensor result = Tensor::zeros_like(input);
+    const float *in = input.values();
+    float *out = result.data.data();
+    Parallel::parallel_for(0, input.rows * input.cols, Parallel::grain_size(32), [&](int begin, int end)
+                           {
+        for (int i = begin; i < end; i++)
+        {
+            out[i] = func(in[i]);
+        } });
     return result;
 }
 
 Tensor Activation::softmax(const Tensor &input)
 {
     Tensor result(input.rows, input.cols);
-    for (int i = 0; i < input.rows; i++)
-    {
-        float max_val = input(i, 0);
-        for (int j = 1; j < input.cols; j++)
-        {
-            max_val = std::max(max_val, input(i, j));
-        }
-        float sum = 0.0f;
-        for (int j = 0; j < input.cols; j++)
+    Parallel::parallel_for(0, input.rows, Parallel::grain_size(8L * input.cols), [&](int begin, int end)
+                           {
+        for (int i = begin; i < end; i++)
         {
-            result(i, j) = exp(input(i, j) - max_val);
-            sum += result(i, j);
-        }
-        for (int j = 0; j < input.cols; j++)
+            float max_val = input(i, 0);
+            for (int j = 1; j < input.cols; j++)
+            {
+                max_val = std::max(max_val, input(i, j));
+            }
+            float sum = 0.0f;
+            for (int j = 0; j < input.cols; j++)
+            {
+                result(i, j) = exp(input(i, j) - max_val);
+                sum += result(i, j);
+            }
+            for (int j = 0; j < input.cols; j++)
+            {
+                result(i, j) /= sum;
+            }
+        } });
+    return result;
+}
+
+float Activation::softmax_cross_entropy(const Tensor &logits, int label, Tensor *grad)
+{
+    const int n = logits.cols;
+    float max_val = logits(0, 0);
+    for (int j = 1; j < n; j++)
+    {
+        max_val = std::max(max_val, logits(0, j));
+    }
+
+    if (grad != nullptr)
+        *grad = Tensor(1, n);
+    float sum = 0.0f;
+    for (int j = 0; j < n; j++)
+    {
+        float e = exp(logits(0, j) - max_val);
+        if (grad != nullptr)
+            (*grad)(0, j) = e;
+        sum += e;
+    }
+
+    if (grad != nullptr)
+    {
+        for (int j = 0; j < n; j++)
         {
-            result(i, j) /= sum;
+            (*grad)(0, j) /= sum;
         }
+        (*grad)(0, label) -= 1.0f;
     }
-    return result;
+    return max_val + log(sum) - logits(0, label);
+}
+
+int Activation::argmax(const Tensor &logits)
+{
+    int best = 0;
+    for (int j = 1; j < logits.cols; j++)
+    {
+        if (logits(0, j) > logits(0, best))
+            best = j;
+    }
+    return best;
 }
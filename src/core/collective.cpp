@@ -0,0 +1,122 @@
+#include "../../include/core/collective.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+void Collective::barrier()
+{
+    float token = 0.0f;
+    all_reduce_sum(&token, 1);
+}
+
+// A sum in which only root contributes is a broadcast.
+void Collective::broadcast(float *data, std::size_t count, int root)
+{
+    if (rank_ != root)
+        std::fill(data, data + count, 0.0f);
+    all_reduce_sum(data, count);
+}
+
+std::unique_ptr<Collective> Collective::create(const std::string &backend, int rank, int world_size, const std::string &address)
+{
+    if (world_size < 1 || rank < 0 || rank >= world_size)
+        throw std::runtime_error("rango " + std::to_string(rank) + " fuera de [0, " + std::to_string(world_size) + ")");
+    if (backend == "shm")
+        return std::make_unique<ShmCollective>(rank, world_size, address);
+    if (backend == "tcp")
+        return std::make_unique<TcpCollective>(rank, world_size, address);
+    throw std::runtime_error("backend de comunicación desconocido: " + backend);
+}
+
+std::unique_ptr<Collective> Collective::from_env()
+{
+    const char *world_env = std::getenv("VIT_WORLD_SIZE");
+    const char *rank_env = std::getenv("VIT_RANK");
+    if (world_env == nullptr || std::atoi(world_env) <= 1)
+        return nullptr;
+    const char *backend_env = std::getenv("VIT_DIST_BACKEND");
+    const char *address_env = std::getenv("VIT_DIST_ADDR");
+    std::string backend = backend_env != nullptr ? backend_env : "shm";
+    std::string address = address_env != nullptr ? address_env : (backend == "tcp" ? "127.0.0.1:29500" : "/vit_dist");
+    return create(backend, rank_env != nullptr ? std::atoi(rank_env) : 0, std::atoi(world_env), address);
+}
+
+OverlappedAllReduce::OverlappedAllReduce(Collective &group)
+    : collective(group), worker(&OverlappedAllReduce::run, this)
+{
+}
+
+OverlappedAllReduce::~OverlappedAllReduce()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void OverlappedAllReduce::submit(const std::vector<Tensor *> &tensors)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(tensors);
+    }
+    cv.notify_all();
+}
+
+void OverlappedAllReduce::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]
+            { return pending.empty() && !reducing; });
+    if (!error.empty())
+        throw std::runtime_error(error);
+}
+
+void OverlappedAllReduce::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cv.wait(lock, [this]
+                { return !pending.empty() || stopping; });
+        if (pending.empty())
+            return;
+        std::vector<Tensor *> group = std::move(pending.front());
+        pending.pop_front();
+        reducing = true;
+        bool failed = !error.empty();
+        lock.unlock();
+
+        // One message per group: the tensors are packed back to back. After
+        // a failure the remaining groups are dropped; wait() reports it.
+        std::string message;
+        if (!failed)
+        {
+            buffer.clear();
+            for (const Tensor *tensor : group)
+                buffer.insert(buffer.end(), tensor->data.begin(), tensor->data.end());
+            try
+            {
+                collective.all_reduce_sum(buffer.data(), buffer.size());
+                std::size_t offset = 0;
+                for (Tensor *tensor : group)
+                {
+                    std::copy(buffer.begin() + offset, buffer.begin() + offset + tensor->data.size(), tensor->data.begin());
+                    offset += tensor->data.size();
+                }
+            }
+            catch (const std::exception &e)
+            {
+                message = e.what();
+            }
+        }
+
+        lock.lock();
+        if (!message.empty())
+            error = message;
+        reducing = false;
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,186 @@
+#include "../../include/core/gemm.h"
+#include <algorithm>
+
+namespace
+{
+    const int NR = PackedMatrix::NR;
+
+    typedef float vec8 __attribute__((vector_size(32)));
+
+    // R x NR register tiles over the full depth k, one per supported mr.
+    inline void kernel_6x8(const float *a, int lda, const float *panel, int k, vec8 acc[6])
+    {
+        for (int r = 0; r < 6; r++)
+        {
+            acc[r] = vec8{};
+        }
+        for (int kk = 0; kk < k; kk++)
+        {
+            vec8 b;
+            __builtin_memcpy(&b, panel + static_cast<std::size_t>(kk) * NR, sizeof(b));
+            acc[0] += a[kk] * b;
+            acc[1] += a[lda + kk] * b;
+            acc[2] += a[2 * lda + kk] * b;
+            acc[3] += a[3 * lda + kk] * b;
+            acc[4] += a[4 * lda + kk] * b;
+            acc[5] += a[5 * lda + kk] * b;
+        }
+    }
+
+    inline void kernel_4x8(const float *a, int lda, const float *panel, int k, vec8 acc[4])
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            acc[r] = vec8{};
+        }
+        for (int kk = 0; kk < k; kk++)
+        {
+            vec8 b;
+            __builtin_memcpy(&b, panel + static_cast<std::size_t>(kk) * NR, sizeof(b));
+            acc[0] += a[kk] * b;
+            acc[1] += a[lda + kk] * b;
+            acc[2] += a[2 * lda + kk] * b;
+            acc[3] += a[3 * lda + kk] * b;
+        }
+    }
+
+    inline void kernel_2x8(const float *a, int lda, const float *panel, int k, vec8 acc[2])
+    {
+        acc[0] = acc[1] = vec8{};
+        for (int kk = 0; kk < k; kk++)
+        {
+            vec8 b;
+            __builtin_memcpy(&b, panel + static_cast<std::size_t>(kk) * NR, sizeof(b));
+            acc[0] += a[kk] * b;
+            acc[1] += a[lda + kk] * b;
+        }
+    }
+
+    inline void kernel_1x8(const float *a, const float *panel, int k, vec8 &acc)
+    {
+        acc = vec8{};
+        for (int kk = 0; kk < k; kk++)
+        {
+            vec8 b;
+            __builtin_memcpy(&b, panel + static_cast<std::size_t>(kk) * NR, sizeof(b));
+            acc += a[kk] * b;
+        }
+    }
+
+    inline void store_row(const vec8 &acc, const float *bias, int col0, int width, float *c)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            c[col0 + j] = bias != nullptr ? acc[j] + bias[col0 + j] : acc[j];
+        }
+    }
+
+    // Rows [begin, end) of one panel: tiles of mr rows, then the remainder
+    // with the narrower kernels.
+    void sweep_rows(const float *a, int lda, int begin, int end, int mr, const float *panel, int k,
+                    const float *bias, int col0, int width, float *c, int ldc)
+    {
+        int i = begin;
+        vec8 acc[6];
+        if (mr >= 6)
+        {
+            for (; i + 6 <= end; i += 6)
+            {
+                kernel_6x8(a + static_cast<std::size_t>(i) * lda, lda, panel, k, acc);
+                for (int r = 0; r < 6; r++)
+                    store_row(acc[r], bias, col0, width, c + static_cast<std::size_t>(i + r) * ldc);
+            }
+        }
+        if (mr >= 4)
+        {
+            for (; i + 4 <= end; i += 4)
+            {
+                kernel_4x8(a + static_cast<std::size_t>(i) * lda, lda, panel, k, acc);
+                for (int r = 0; r < 4; r++)
+                    store_row(acc[r], bias, col0, width, c + static_cast<std::size_t>(i + r) * ldc);
+            }
+        }
+        if (mr >= 2)
+        {
+            for (; i + 2 <= end; i += 2)
+            {
+                kernel_2x8(a + static_cast<std::size_t>(i) * lda, lda, panel, k, acc);
+                for (int r = 0; r < 2; r++)
+                    store_row(acc[r], bias, col0, width, c + static_cast<std::size_t>(i + r) * ldc);
+            }
+        }
+        for (; i < end; i++)
+        {
+            kernel_1x8(a + static_cast<std::size_t>(i) * lda, panel, k, acc[0]);
+            store_row(acc[0], bias, col0, width, c + static_cast<std::size_t>(i) * ldc);
+        }
+    }
+}
+
+void PackedMatrix::pack(const Tensor &weight, WeightDType storage)
+{
+    rows = weight.rows;
+    cols = weight.cols;
+    dtype = storage;
+    data.assign(num_panels() * panel_size(), 0.0f);
+    for (int p = 0; p < num_panels(); p++)
+    {
+        float *dst = data.data() + p * panel_size();
+        for (int kk = 0; kk < cols; kk++)
+        {
+            for (int j = 0; j < NR; j++)
+            {
+                int o = p * NR + j;
+                dst[static_cast<std::size_t>(kk) * NR + j] = o < rows ? weight(o, kk) : 0.0f;
+            }
+        }
+    }
+    if (dtype == WeightDType::F32)
+    {
+        half.clear();
+        return;
+    }
+    half.resize(data.size());
+    for (std::size_t i = 0; i < data.size(); i++)
+    {
+        half[i] = narrow(data[i], dtype);
+    }
+    data.clear();
+    data.shrink_to_fit();
+}
+
+void PackedMatrix::clear()
+{
+    rows = cols = 0;
+    dtype = WeightDType::F32;
+    data.clear();
+    half.clear();
+}
+
+void gemm_packed(const float *a, int m, int lda, const PackedMatrix &w, const float *bias, float *c, int ldc,
+                 const GemmConfig &config)
+{
+    const int k = w.cols;
+    // Half-precision panels are widened once per row block into an L1-sized
+    // buffer and reused by every row tile, so memory traffic stays at 16
+    // bits a weight.
+    thread_local std::vector<float> widened;
+    if (w.dtype != WeightDType::F32)
+        widened.resize(w.panel_size());
+    const int row_block = config.row_block > 0 ? config.row_block : m;
+    for (int i0 = 0; i0 < m; i0 += row_block)
+    {
+        const int i1 = std::min(m, i0 + row_block);
+        for (int p = 0; p < w.num_panels(); p++)
+        {
+            const float *panel = w.panel(p);
+            if (w.dtype != WeightDType::F32)
+            {
+                widen(w.half_panel(p), widened.data(), w.panel_size(), w.dtype);
+                panel = widened.data();
+            }
+            const int col0 = p * NR;
+            sweep_rows(a, lda, i0, i1, config.mr, panel, k, bias, col0, std::min(NR, w.rows - col0), c, ldc);
+        }
+    }
+}
@@ -0,0 +1,357 @@
+#include "../../include/core/gemm_tuner.h"
+#include "../../include/core/parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+namespace
+{
+    struct Entry
+    {
+        int m;
+        GemmConfig config;
+        double gflops;
+    };
+
+    typedef std::tuple<int, int, int, int> Key; // k, n, dtype, site
+
+    struct Table
+    {
+        std::map<Key, std::vector<Entry>> entries; // each sorted by m
+        std::vector<std::string> other_cpus;       // other groups of the cache file, verbatim
+        bool enabled = true;
+    };
+
+    Key key_of(int k, int n, WeightDType dtype, GemmSite site)
+    {
+        return Key(k, n, static_cast<int>(dtype), static_cast<int>(site));
+    }
+
+    void insert(Table &table, const GemmShape &shape, const GemmConfig &config, double gflops)
+    {
+        const int m = shape.m;
+        std::vector<Entry> &list = table.entries[key_of(shape.k, shape.n, shape.dtype, shape.site)];
+        auto it = std::lower_bound(list.begin(), list.end(), m, [](const Entry &e, int value)
+                                   { return e.m < value; });
+        if (it != list.end() && it->m == m)
+            *it = {m, config, gflops};
+        else
+            list.insert(it, {m, config, gflops});
+    }
+
+    const Entry *find(const Table &table, int m, int k, int n, WeightDType dtype, GemmSite site)
+    {
+        auto it = table.entries.find(key_of(k, n, dtype, site));
+        if (it == table.entries.end())
+            return nullptr;
+        const Entry *best = nullptr;
+        for (const Entry &e : it->second)
+        {
+            if (best == nullptr || std::abs(e.m - m) < std::abs(best->m - m))
+                best = &e;
+        }
+        return best;
+    }
+
+    bool read_cache(const std::string &path, Table &table)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        table.entries.clear();
+        table.other_cpus.clear();
+        std::string line;
+        bool ours = false;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            if (line.compare(0, 4, "cpu ") == 0)
+                ours = line.substr(4) == GemmTuner::cpu_key();
+            if (!ours)
+            {
+                table.other_cpus.push_back(line);
+                continue;
+            }
+            std::istringstream fields(line);
+            GemmShape shape;
+            std::string dtype_text, site_text;
+            GemmConfig config;
+            double gflops;
+            if (fields >> shape.m >> shape.k >> shape.n >> dtype_text >> site_text >> config.mr >> config.row_block >>
+                    config.threads >> gflops &&
+                parse_dtype(dtype_text, shape.dtype) && parse_site(site_text, shape.site))
+                insert(table, shape, config, gflops);
+        }
+        return true;
+    }
+
+    Table &table()
+    {
+        static Table instance = []
+        {
+            Table t;
+            t.enabled = GemmTuner::cache_path() != "off";
+            if (t.enabled)
+                read_cache(GemmTuner::cache_path(), t);
+            return t;
+        }();
+        return instance;
+    }
+
+    struct Problem
+    {
+        GemmShape shape;
+        std::vector<float> a, bias, c;
+        PackedMatrix w;
+
+        explicit Problem(const GemmShape &s) : shape(s)
+        {
+            // A private generator: tuning must not move the model's Random stream.
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+            a.resize(static_cast<size_t>(s.m) * s.k);
+            bias.resize(s.n);
+            c.resize(static_cast<size_t>(s.m) * s.n);
+            for (float &v : a)
+                v = uniform(rng);
+            for (float &v : bias)
+                v = uniform(rng);
+            Tensor weight(s.n, s.k);
+            for (size_t i = 0; i < weight.numel(); i++)
+                weight.values()[i] = uniform(rng);
+            w.pack(weight, s.dtype);
+        }
+
+        // Runs the shape the way its site does: one call on this thread for
+        // the compiled engine, rows split over config.threads for a Linear
+        // (0 splits them like an untuned Linear does).
+        void run(const GemmConfig &config)
+        {
+            const int m = shape.m, k = shape.k, n = shape.n;
+            if (shape.site == GemmSite::Compiled)
+            {
+                gemm_packed(a.data(), m, k, w, bias.data(), c.data(), n, config);
+                return;
+            }
+            const int grain = GemmTuner::grain(config, m, Parallel::grain_size(2L * k * n));
+            Parallel::parallel_for(0, m, grain, [&](int begin, int end)
+                                   { gemm_packed(a.data() + static_cast<size_t>(begin) * k, end - begin, k, w, bias.data(),
+                                                 c.data() + static_cast<size_t>(begin) * n, n, config); });
+        }
+
+        // Best of several timed trials, in GFLOP/s.
+        double gflops(const GemmConfig &config)
+        {
+            using clock = std::chrono::steady_clock;
+            run(config);
+            int reps = 1;
+            for (;;)
+            {
+                auto start = clock::now();
+                for (int r = 0; r < reps; r++)
+                    run(config);
+                if (clock::now() - start > std::chrono::milliseconds(2) || reps >= (1 << 16))
+                    break;
+                reps *= 2;
+            }
+            double best = 1e30;
+            for (int trial = 0; trial < 5; trial++)
+            {
+                auto start = clock::now();
+                for (int r = 0; r < reps; r++)
+                    run(config);
+                best = std::min(best, std::chrono::duration<double>(clock::now() - start).count() / reps);
+            }
+            return 2.0 * shape.m * shape.k * shape.n / best * 1e-9;
+        }
+    };
+
+    std::vector<GemmConfig> candidates(const GemmShape &shape)
+    {
+        std::vector<int> row_blocks = {0}, threads = {1};
+        for (int block : {16, 64, 256})
+        {
+            if (block < shape.m)
+                row_blocks.push_back(block);
+        }
+        // The compiled engine already spreads its row blocks over the workers.
+        const int max_threads = shape.site == GemmSite::Compiled ? 1 : std::min(Parallel::num_threads(), shape.m);
+        for (int t = 2; t <= max_threads; t *= 2)
+            threads.push_back(t);
+        std::vector<GemmConfig> list;
+        for (int mr : {1, 2, 4, 6})
+        {
+            for (int block : row_blocks)
+            {
+                for (int t : threads)
+                {
+                    GemmConfig config;
+                    config.mr = mr;
+                    config.row_block = block;
+                    config.threads = t;
+                    list.push_back(config);
+                }
+            }
+        }
+        return list;
+    }
+}
+
+std::string site_name(GemmSite site)
+{
+    return site == GemmSite::Compiled ? "compiled" : "linear";
+}
+
+bool parse_site(const std::string &name, GemmSite &site)
+{
+    if (name != "linear" && name != "compiled")
+        return false;
+    site = name == "compiled" ? GemmSite::Compiled : GemmSite::Linear;
+    return true;
+}
+
+GemmConfig GemmTuner::config(int m, int k, int n, WeightDType dtype, GemmSite site)
+{
+    const Table &t = table();
+    if (!t.enabled || t.entries.empty())
+        return GemmConfig();
+    const Entry *e = find(t, m, k, n, dtype, site);
+    return e != nullptr ? e->config : GemmConfig();
+}
+
+int GemmTuner::grain(const GemmConfig &config, int m, int default_grain)
+{
+    return config.threads > 0 ? std::max(1, (m + config.threads - 1) / config.threads) : default_grain;
+}
+
+std::vector<GemmTuneResult> GemmTuner::tune(std::vector<GemmShape> shapes, bool retune)
+{
+    std::sort(shapes.begin(), shapes.end());
+    shapes.erase(std::unique(shapes.begin(), shapes.end()), shapes.end());
+    Table &t = table();
+    std::vector<GemmTuneResult> results;
+    for (const GemmShape &shape : shapes)
+    {
+        if (shape.m < 1 || shape.k < 1 || shape.n < 1)
+            continue;
+        GemmTuneResult result;
+        result.shape = shape;
+        const Entry *known = find(t, shape.m, shape.k, shape.n, shape.dtype, shape.site);
+        if (!retune && known != nullptr && known->m == shape.m)
+        {
+            result.config = known->config;
+            result.tuned_gflops = known->gflops;
+            result.cached = true;
+            results.push_back(result);
+            continue;
+        }
+
+        Problem problem(shape);
+        problem.run(GemmConfig());
+        const std::vector<float> reference = problem.c;
+        // The default stays unless a candidate beats its measurement.
+        result.default_gflops = result.tuned_gflops = problem.gflops(GemmConfig());
+        for (const GemmConfig &config : candidates(shape))
+        {
+            std::fill(problem.c.begin(), problem.c.end(), 0.0f);
+            problem.run(config);
+            // Every variant must reproduce the default bit for bit.
+            if (std::memcmp(problem.c.data(), reference.data(), reference.size() * sizeof(float)) != 0)
+                continue;
+            double gflops = problem.gflops(config);
+            if (gflops > result.tuned_gflops)
+            {
+                result.tuned_gflops = gflops;
+                result.config = config;
+            }
+        }
+        insert(t, shape, result.config, result.tuned_gflops);
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::string GemmTuner::cache_path()
+{
+    const char *env = std::getenv("VIT_GEMM_TUNING");
+    return env != nullptr && *env != '\0' ? env : "models/gemm_tuning.txt";
+}
+
+bool GemmTuner::load(const std::string &path)
+{
+    return read_cache(path, table());
+}
+
+bool GemmTuner::save(const std::string &path)
+{
+    const Table &t = table();
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path);
+    if (!file)
+        return false;
+    file << "# gemm_packed: m k n dtype site mr row_block threads gflops" << std::endl;
+    for (const std::string &line : t.other_cpus)
+        file << line << std::endl;
+    file << "cpu " << cpu_key() << std::endl;
+    for (const auto &[key, list] : t.entries)
+    {
+        for (const Entry &e : list)
+        {
+            file << e.m << " " << std::get<0>(key) << " " << std::get<1>(key) << " "
+                 << dtype_name(static_cast<WeightDType>(std::get<2>(key))) << " "
+                 << site_name(static_cast<GemmSite>(std::get<3>(key))) << " " << e.config.mr << " "
+                 << e.config.row_block << " " << e.config.threads << " " << e.gflops << std::endl;
+        }
+    }
+    file.close();
+    if (!file)
+        return false;
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool GemmTuner::enabled()
+{
+    return table().enabled;
+}
+
+void GemmTuner::set_enabled(bool enabled)
+{
+    table().enabled = enabled;
+}
+
+int GemmTuner::size()
+{
+    int count = 0;
+    for (const auto &[key, list] : table().entries)
+        count += list.size();
+    return count;
+}
+
+const std::string &GemmTuner::cpu_key()
+{
+    static const std::string key = []
+    {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line, model = "unknown";
+        while (std::getline(cpuinfo, line))
+        {
+            if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos)
+            {
+                model = line.substr(line.find(':') + 1);
+                model.erase(0, model.find_first_not_of(" \t"));
+                break;
+            }
+        }
+        return model + " x" + std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+    }();
+    return key;
+}
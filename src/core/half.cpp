@@ -0,0 +1,207 @@
+#include "../../include/core/half.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VIT_HAVE_X86_F16C 1
+#endif
+
+namespace
+{
+    uint32_t float_bits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bits_float(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+#ifdef VIT_HAVE_X86_F16C
+    __attribute__((target("avx512f"))) void widen_f16_avx512(const uint16_t *src, float *dst, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            // maskz sidesteps a -Wmaybe-uninitialized false positive in GCC 12.
+            _mm512_storeu_ps(dst + i, _mm512_maskz_cvtph_ps(static_cast<__mmask16>(0xffff), h));
+        }
+        for (; i < n; i++)
+        {
+            dst[i] = half_to_float(src[i]);
+        }
+    }
+
+    __attribute__((target("avx,f16c"))) void widen_f16_f16c(const uint16_t *src, float *dst, std::size_t n)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+        }
+        for (; i < n; i++)
+        {
+            dst[i] = half_to_float(src[i]);
+        }
+    }
+
+    enum class F16Path
+    {
+        Portable,
+        F16C,
+        AVX512
+    };
+
+    F16Path detect_f16_path()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return F16Path::AVX512;
+        if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c"))
+            return F16Path::F16C;
+        return F16Path::Portable;
+    }
+#endif
+}
+
+uint16_t float_to_half(float value)
+{
+    const uint32_t x = float_bits(value);
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t mantissa = x & 0x7fffffu;
+    const int exponent = static_cast<int>((x >> 23) & 0xffu);
+
+    if (exponent == 0xff)
+        return static_cast<uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+    const int e = exponent - 127 + 15;
+    if (e >= 0x1f)
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    if (e <= 0)
+    {
+        // Subnormal half: value = mantissa * 2^-24.
+        if (e < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        const int shift = 14 - e;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1u), halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fffu;
+    // A carry out of the mantissa correctly bumps the exponent.
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++;
+    return static_cast<uint16_t>(half);
+}
+
+float half_to_float(uint16_t value)
+{
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    int exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ffu;
+
+    if (exponent == 0x1f)
+        return bits_float(sign | 0x7f800000u | (mantissa << 13));
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+            return bits_float(sign);
+        exponent = 1;
+        while ((mantissa & 0x400u) == 0)
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        mantissa &= 0x3ffu;
+    }
+    return bits_float(sign | (static_cast<uint32_t>(exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+uint16_t float_to_bf16(float value)
+{
+    const uint32_t x = float_bits(value);
+    if ((x & 0x7f800000u) == 0x7f800000u && (x & 0x7fffffu) != 0)
+        return static_cast<uint16_t>((x >> 16) | 0x40u); // keep NaN quiet
+    return static_cast<uint16_t>((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+}
+
+float bf16_to_float(uint16_t value)
+{
+    return bits_float(static_cast<uint32_t>(value) << 16);
+}
+
+uint16_t narrow(float value, WeightDType dtype)
+{
+    return dtype == WeightDType::BF16 ? float_to_bf16(value) : float_to_half(value);
+}
+
+float widen(uint16_t value, WeightDType dtype)
+{
+    return dtype == WeightDType::BF16 ? bf16_to_float(value) : half_to_float(value);
+}
+
+void widen(const uint16_t *src, float *dst, std::size_t n, WeightDType dtype)
+{
+    if (dtype == WeightDType::BF16)
+    {
+        for (std::size_t i = 0; i < n; i++)
+        {
+            dst[i] = bits_float(static_cast<uint32_t>(src[i]) << 16);
+        }
+        return;
+    }
+#ifdef VIT_HAVE_X86_F16C
+    static const F16Path path = detect_f16_path();
+    if (path == F16Path::AVX512)
+        return widen_f16_avx512(src, dst, n);
+    if (path == F16Path::F16C)
+        return widen_f16_f16c(src, dst, n);
+#endif
+    for (std::size_t i = 0; i < n; i++)
+    {
+        dst[i] = half_to_float(src[i]);
+    }
+}
+
+std::size_t dtype_bytes(WeightDType dtype)
+{
+    return dtype == WeightDType::F32 ? 4 : 2;
+}
+
+std::string dtype_name(WeightDType dtype)
+{
+    switch (dtype)
+    {
+    case WeightDType::F32:
+        return "f32";
+    case WeightDType::F16:
+        return "f16";
+    case WeightDType::BF16:
+        return "bf16";
+    }
+    return "?";
+}
+
+bool parse_dtype(const std::string &name, WeightDType &dtype)
+{
+    if (name == "f32")
+        dtype = WeightDType::F32;
+    else if (name == "f16")
+        dtype = WeightDType::F16;
+    else if (name == "bf16")
+        dtype = WeightDType::BF16;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,53 @@
+#include "../../include/core/hash.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    inline uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+}
+
+uint64_t hash_bytes(const void *data, std::size_t size, uint64_t seed)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    uint64_t h = mix(seed ^ (size * 0x9e3779b97f4a7c15ULL));
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t k;
+        std::memcpy(&k, p + i, 8);
+        k *= 0x87c37b91114253d5ULL;
+        k = (k << 31) | (k >> 33);
+        h = (h ^ k) * 0x4cf5ad432745937fULL;
+        h = (h << 27) | (h >> 37);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + i, size - i);
+    return mix(h ^ tail);
+}
+
+uint64_t hash_file(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return 0;
+    uint64_t h = 0;
+    std::vector<char> buffer(1 << 16);
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize read = file.gcount();
+        if (read > 0)
+            h = hash_bytes(buffer.data(), read, h);
+    }
+    return h;
+}
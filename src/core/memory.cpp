@@ -0,0 +1,144 @@
+#include "../../include/core/memory.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <sys/mman.h>
+
+namespace
+{
+    Memory::HugePages default_mode()
+    {
+        Memory::HugePages mode = Memory::HugePages::Transparent;
+        const char *env = std::getenv("VIT_HUGE_PAGES");
+        if (env != nullptr)
+            Memory::parse_huge_pages(env, mode);
+        return mode;
+    }
+
+    Memory::HugePages &mode()
+    {
+        static Memory::HugePages value = default_mode();
+        return value;
+    }
+
+    std::size_t round_up(std::size_t bytes)
+    {
+        return (bytes + Memory::kHugePageSize - 1) / Memory::kHugePageSize * Memory::kHugePageSize;
+    }
+
+    // Over-maps by one huge page and trims both ends, so the result starts
+    // on a 2 MB boundary and THP can back it from the first byte.
+    void *map_aligned(std::size_t size)
+    {
+        const std::size_t padded = size + Memory::kHugePageSize;
+        void *raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            return nullptr;
+        std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(raw);
+        std::uintptr_t aligned = (begin + Memory::kHugePageSize - 1) / Memory::kHugePageSize * Memory::kHugePageSize;
+        if (aligned > begin)
+            munmap(raw, aligned - begin);
+        std::size_t tail = padded - (aligned - begin) - size;
+        if (tail > 0)
+            munmap(reinterpret_cast<void *>(aligned + size), tail);
+        return reinterpret_cast<void *>(aligned);
+    }
+}
+
+void Memory::set_huge_pages(HugePages value)
+{
+    mode() = value;
+}
+
+Memory::HugePages Memory::huge_pages()
+{
+    return mode();
+}
+
+bool Memory::parse_huge_pages(const std::string &name, HugePages &value)
+{
+    if (name == "off" || name == "0")
+        value = HugePages::Off;
+    else if (name == "thp" || name == "1")
+        value = HugePages::Transparent;
+    else if (name == "hugetlb")
+        value = HugePages::HugeTLB;
+    else
+        return false;
+    return true;
+}
+
+std::string Memory::huge_pages_name(HugePages value)
+{
+    switch (value)
+    {
+    case HugePages::Off:
+        return "off";
+    case HugePages::Transparent:
+        return "thp";
+    case HugePages::HugeTLB:
+        return "hugetlb";
+    }
+    return "?";
+}
+
+// Whether a buffer is mapped depends only on its size, never on the current
+// mode, so deallocate() stays correct after the mode changes.
+void *Memory::allocate(std::size_t bytes)
+{
+    if (bytes < kHugePageSize)
+        return ::operator new(bytes == 0 ? 1 : bytes, std::align_val_t(kAlignment));
+
+    const std::size_t size = round_up(bytes);
+    void *p = nullptr;
+    if (mode() == HugePages::HugeTLB)
+    {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            return p;
+        // An empty or too small reserved pool is common; warn once.
+        static std::once_flag warned;
+        std::call_once(warned, []
+                       { std::cerr << "Advertencia: no hay páginas hugetlb reservadas; se usan páginas transparentes." << std::endl; });
+    }
+    p = map_aligned(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    madvise(p, size, mode() == HugePages::Off ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+    return p;
+}
+
+void Memory::deallocate(void *p, std::size_t bytes)
+{
+    if (p == nullptr)
+        return;
+    if (bytes < kHugePageSize)
+    {
+        ::operator delete(p, std::align_val_t(kAlignment));
+        return;
+    }
+    munmap(p, round_up(bytes));
+}
+
+long Memory::huge_page_bytes()
+{
+    std::ifstream file("/proc/self/smaps_rollup");
+    if (!file.is_open())
+        return -1;
+    long total = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string key;
+        long kb = 0;
+        ss >> key >> kb;
+        if (key == "AnonHugePages:" || key == "Private_Hugetlb:" || key == "Shared_Hugetlb:")
+            total += kb * 1024;
+    }
+    return total;
+}
@@ -0,0 +1,81 @@
+#include "../../include/core/parallel.h"
+#include "../../include/core/task_scheduler.h"
+#include <atomic>
+
+namespace
+{
+    // Below this many (approximate) flops per chunk the cost of handing a
+    // chunk to another worker outweighs the work it would take over.
+    const long kMinWorkPerChunk = 16384;
+
+    // Chunks handed out per thread, so uneven chunks still balance out.
+    const int kChunksPerThread = 4;
+
+    thread_local int budget = 0;
+}
+
+void Parallel::set_num_threads(int n)
+{
+    TaskScheduler::set_num_threads(n);
+}
+
+int Parallel::num_threads()
+{
+    return TaskScheduler::num_threads();
+}
+
+void Parallel::set_thread_budget(int n)
+{
+    budget = std::max(0, n);
+}
+
+int Parallel::thread_budget()
+{
+    return budget;
+}
+
+int Parallel::grain_size(long cost_per_item)
+{
+    if (cost_per_item <= 0)
+        return 1;
+    return static_cast<int>(std::max(1L, kMinWorkPerChunk / cost_per_item));
+}
+
+void Parallel::parallel_for(int begin, int end, int grain, const std::function<void(int, int)> &body)
+{
+    if (end <= begin)
+        return;
+    if (grain < 1)
+        grain = 1;
+
+    int n = end - begin;
+    int threads = budget > 0 ? std::min(budget, num_threads()) : num_threads();
+    if (threads == 1 || n <= grain)
+    {
+        body(begin, end);
+        return;
+    }
+
+    int chunk = std::max(grain, (n + threads * kChunksPerThread - 1) / (threads * kChunksPerThread));
+    int num_chunks = (n + chunk - 1) / chunk;
+    std::atomic<int> next(begin);
+    auto run_chunks = [&]
+    {
+        int lo;
+        while ((lo = next.fetch_add(chunk)) < end)
+        {
+            body(lo, std::min(end, lo + chunk));
+        }
+    };
+
+    // Helpers that start after the range is exhausted return immediately;
+    // the caller always takes part, so progress never depends on a free
+    // worker.
+    TaskGroup helpers;
+    for (int h = 0; h < std::min(threads, num_chunks) - 1; h++)
+    {
+        helpers.run(run_chunks);
+    }
+    run_chunks();
+    helpers.wait();
+}
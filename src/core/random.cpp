@@ -1,31 +1,268 @@
 #include "../../include/core/random.h"
+#include "../../include/core/parallel.h"
+#include <atomic>
+#include <cmath>
 #include <random>
+#include <sstream>
 
-std::mt19937 Random::gen;
-std::random_device Random::rd;
+namespace
+{
+    const uint32_t kPhiloxM0 = 0xD2511F53, kPhiloxM1 = 0xCD9E8D57;
+    const uint32_t kPhiloxW0 = 0x9E3779B9, kPhiloxW1 = 0xBB67AE85;
+    const int kPhiloxRounds = 10;
+    // Blocks generated together by the bulk fills; the lane loops are plain
+    // enough for the compiler to vectorize.
+    const int kLanes = 8;
+    const float kTwoPi = 6.283185307179586f;
+
+    // Thread-private streams are numbered from this bit up, bulk fills from 1
+    // and the seeding thread uses stream 0, so the three never overlap.
+    const uint64_t kThreadStreamBit = 1ULL << 63;
+
+    std::atomic<uint64_t> global_seed{5489};
+    std::atomic<uint64_t> generation{1};
+    std::atomic<uint64_t> bulk_streams{1};
+    std::atomic<uint64_t> thread_streams{0};
+
+    struct ThreadStream
+    {
+        RandomStream stream;
+        uint64_t generation = 0;
+    };
+    thread_local ThreadStream local;
+
+    inline float to_unit(uint32_t word) // [0, 1)
+    {
+        return (word >> 8) * (1.0f / 16777216.0f);
+    }
+
+    inline float to_open_unit(uint32_t word) // (0, 1]
+    {
+        return ((word >> 8) + 1) * (1.0f / 16777216.0f);
+    }
+
+    // words[w][l] = word w of block (first + l).
+    void philox_lanes(uint64_t seed, uint64_t stream, uint64_t first, uint32_t words[4][kLanes])
+    {
+        uint32_t c0[kLanes], c1[kLanes], c2[kLanes], c3[kLanes];
+        for (int l = 0; l < kLanes; l++)
+        {
+            uint64_t index = first + l;
+            c0[l] = static_cast<uint32_t>(index);
+            c1[l] = static_cast<uint32_t>(index >> 32);
+            c2[l] = static_cast<uint32_t>(stream);
+            c3[l] = static_cast<uint32_t>(stream >> 32);
+        }
+        uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+        for (int r = 0; r < kPhiloxRounds; r++)
+        {
+            for (int l = 0; l < kLanes; l++)
+            {
+                uint64_t p0 = static_cast<uint64_t>(kPhiloxM0) * c0[l];
+                uint64_t p1 = static_cast<uint64_t>(kPhiloxM1) * c2[l];
+                uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1[l] ^ k0;
+                uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3[l] ^ k1;
+                c1[l] = static_cast<uint32_t>(p1);
+                c3[l] = static_cast<uint32_t>(p0);
+                c0[l] = n0;
+                c2[l] = n2;
+            }
+            k0 += kPhiloxW0;
+            k1 += kPhiloxW1;
+        }
+        for (int l = 0; l < kLanes; l++)
+        {
+            words[0][l] = c0[l];
+            words[1][l] = c1[l];
+            words[2][l] = c2[l];
+            words[3][l] = c3[l];
+        }
+    }
+
+    // Calls emit(element, block words) for blocks [block_begin, block_end),
+    // kLanes blocks at a time.
+    template <typename Emit>
+    void for_each_block(uint64_t seed, uint64_t stream, std::size_t block_begin, std::size_t block_end, Emit emit)
+    {
+        uint32_t words[4][kLanes];
+        for (std::size_t b = block_begin; b < block_end; b += kLanes)
+        {
+            philox_lanes(seed, stream, b, words);
+            for (int l = 0; l < kLanes && b + l < block_end; l++)
+            {
+                emit(4 * (b + l), words[0][l], words[1][l], words[2][l], words[3][l]);
+            }
+        }
+    }
+
+    // Splits the blocks of an n-element fill across workers; block b always
+    // covers elements [4b, 4b + 4), whatever the split.
+    template <typename Emit>
+    void parallel_fill(std::size_t n, uint64_t seed, uint64_t stream, long cost_per_block, Emit emit)
+    {
+        const int num_blocks = static_cast<int>((n + 3) / 4);
+        Parallel::parallel_for(0, num_blocks, Parallel::grain_size(cost_per_block), [&](int begin, int end)
+                               { for_each_block(seed, stream, begin, end, emit); });
+    }
+}
+
+Philox::Block Philox::block(uint64_t seed, uint64_t stream, uint64_t index)
+{
+    uint32_t c0 = static_cast<uint32_t>(index), c1 = static_cast<uint32_t>(index >> 32);
+    uint32_t c2 = static_cast<uint32_t>(stream), c3 = static_cast<uint32_t>(stream >> 32);
+    uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+    for (int r = 0; r < kPhiloxRounds; r++)
+    {
+        uint64_t p0 = static_cast<uint64_t>(kPhiloxM0) * c0;
+        uint64_t p1 = static_cast<uint64_t>(kPhiloxM1) * c2;
+        uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c1 = static_cast<uint32_t>(p1);
+        c3 = static_cast<uint32_t>(p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+    return {c0, c1, c2, c3};
+}
+
+RandomStream::RandomStream(uint64_t s, uint64_t id) : seed(s), stream(id), position(0), cache{}
+{
+}
+
+uint32_t RandomStream::next_u32()
+{
+    // Recomputed whenever position enters a new block, so position can be
+    // set directly (e.g. when restoring a checkpoint).
+    if (cache_index != position / 4)
+    {
+        cache = Philox::block(seed, stream, position / 4);
+        cache_index = position / 4;
+    }
+    return cache[position++ % 4];
+}
+
+float RandomStream::uniform(float min, float max)
+{
+    return min + (max - min) * to_unit(next_u32());
+}
+
+float RandomStream::randn(float mean, float stddev)
+{
+    float u1 = to_open_unit(next_u32());
+    float u2 = to_unit(next_u32());
+    return mean + stddev * std::sqrt(-2.0f * std::log(u1)) * std::cos(kTwoPi * u2);
+}
+
+int RandomStream::randint(int min, int max)
+{
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    return min + static_cast<int>((static_cast<uint64_t>(next_u32()) * range) >> 32);
+}
 
-void Random::seed(unsigned int s)
+void Random::seed(uint64_t s)
 {
     if (s == 0)
-        gen.seed(rd());
-    else
-        gen.seed(s);
+    {
+        std::random_device rd;
+        s = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+    global_seed = s;
+    bulk_streams = 1;
+    thread_streams = 0;
+    local.stream = RandomStream(s, 0);
+    local.generation = ++generation;
+}
+
+RandomStream &Random::stream()
+{
+    if (local.generation != generation)
+    {
+        local.stream = RandomStream(global_seed, kThreadStreamBit | thread_streams++);
+        local.generation = generation;
+    }
+    return local.stream;
 }
 
 float Random::randn(float mean, float stddev)
 {
-    std::normal_distribution<float> d(mean, stddev);
-    return d(gen);
+    return stream().randn(mean, stddev);
 }
 
 float Random::uniform(float min, float max)
 {
-    std::uniform_real_distribution<float> d(min, max);
-    return d(gen);
+    return stream().uniform(min, max);
 }
 
 int Random::randint(int min, int max)
 {
-    std::uniform_int_distribution<int> d(min, max);
-    return d(gen);
+    return stream().randint(min, max);
+}
+
+uint64_t Random::next_stream()
+{
+    return bulk_streams++;
+}
+
+void Random::fill_normal(float *data, std::size_t n, float mean, float stddev)
+{
+    fill_normal(data, n, mean, stddev, global_seed, next_stream());
+}
+
+void Random::fill_uniform(float *data, std::size_t n, float min, float max)
+{
+    fill_uniform(data, n, min, max, global_seed, next_stream());
+}
+
+void Random::fill_normal(float *data, std::size_t n, float mean, float stddev, uint64_t seed, uint64_t stream)
+{
+    // Box-Muller on both word pairs of a block, keeping cos and sin: four
+    // normals per block.
+    parallel_fill(n, seed, stream, 200, [&](std::size_t i, uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3)
+                  {
+        float r0 = stddev * std::sqrt(-2.0f * std::log(to_open_unit(w0)));
+        float r1 = stddev * std::sqrt(-2.0f * std::log(to_open_unit(w2)));
+        float t0 = kTwoPi * to_unit(w1), t1 = kTwoPi * to_unit(w3);
+        const float values[4] = {mean + r0 * std::cos(t0), mean + r0 * std::sin(t0),
+                                 mean + r1 * std::cos(t1), mean + r1 * std::sin(t1)};
+        for (std::size_t j = 0; j < 4 && i + j < n; j++)
+        {
+            data[i + j] = values[j];
+        } });
+}
+
+void Random::fill_uniform(float *data, std::size_t n, float min, float max, uint64_t seed, uint64_t stream)
+{
+    const float scale = max - min;
+    parallel_fill(n, seed, stream, 60, [&](std::size_t i, uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3)
+                  {
+        const uint32_t words[4] = {w0, w1, w2, w3};
+        for (std::size_t j = 0; j < 4 && i + j < n; j++)
+        {
+            data[i + j] = min + scale * to_unit(words[j]);
+        } });
+}
+
+std::string Random::state()
+{
+    RandomStream &s = stream();
+    std::ostringstream os;
+    os << global_seed << " " << bulk_streams << " " << s.stream << " " << s.position;
+    return os.str();
+}
+
+bool Random::set_state(const std::string &state)
+{
+    std::istringstream is(state);
+    uint64_t seed, next_bulk, id, position;
+    if (!(is >> seed >> next_bulk >> id >> position))
+        return false;
+    global_seed = seed;
+    bulk_streams = next_bulk;
+    thread_streams = 0;
+    local.stream = RandomStream(seed, id);
+    local.stream.position = position;
+    local.generation = ++generation;
+    return true;
 }
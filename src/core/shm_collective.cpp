@@ -0,0 +1,201 @@
+#include "../../include/core/collective.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const int kMaxRanks = 64;
+    // Floats each rank can post at once; larger reductions run in windows
+    // of world_size * kSlotFloats.
+    const std::size_t kSlotFloats = 256 * 1024;
+    const unsigned long long kReady = 0x56495453484d3031ULL; // "VITSHM01"
+
+    struct alignas(64) RankFlags
+    {
+        std::atomic<unsigned long long> posted;   // messages written to this rank's slot
+        std::atomic<unsigned long long> consumed; // messages this rank has read from its predecessor
+    };
+
+    double timeout_seconds()
+    {
+        const char *env = std::getenv("VIT_DIST_TIMEOUT");
+        return env != nullptr && std::atof(env) > 0 ? std::atof(env) : 300.0;
+    }
+
+    // Spins briefly, then yields: ranks usually outnumber idle cores.
+    template <typename Predicate>
+    void wait_until(Predicate ready, const char *what)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout_seconds());
+        for (long spins = 0; !ready(); spins++)
+        {
+            if (spins < 256)
+                continue;
+            sched_yield();
+            if (spins % 4096 == 0 && std::chrono::steady_clock::now() > deadline)
+                throw std::runtime_error(std::string("tiempo de espera agotado en ") + what);
+        }
+    }
+}
+
+// Rank 0 creates and sizes the segment; everybody else attaches. The
+// flags live in the header and every rank owns one slot after it.
+struct ShmCollective::Segment
+{
+    std::atomic<unsigned long long> ready;
+    int world_size;
+    alignas(64) std::atomic<unsigned long long> arrived;
+    alignas(64) std::atomic<unsigned long long> generation;
+    RankFlags flags[kMaxRanks];
+};
+
+ShmCollective::ShmCollective(int rank, int world_size, const std::string &name)
+    : Collective(rank, world_size)
+{
+    if (world_size > kMaxRanks)
+        throw std::runtime_error("shm admite hasta " + std::to_string(kMaxRanks) + " procesos");
+    mapped_bytes = sizeof(Segment) + world_size * kSlotFloats * sizeof(float);
+
+    int fd = -1;
+    if (rank == 0)
+    {
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, mapped_bytes) != 0)
+            throw std::runtime_error("no se pudo crear la memoria compartida " + name + ": " + std::strerror(errno));
+    }
+    else
+    {
+        struct stat st;
+        wait_until([&]
+                   {
+            if (fd < 0)
+                fd = shm_open(name.c_str(), O_RDWR, 0600);
+            return fd >= 0 && fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) == mapped_bytes; },
+                   "la conexión a la memoria compartida");
+    }
+    void *p = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("no se pudo mapear la memoria compartida " + name);
+    segment = static_cast<Segment *>(p);
+
+    // ftruncate zero-fills, which is a valid initial state for the atomics.
+    if (rank == 0)
+    {
+        segment->world_size = world_size;
+        segment->ready.store(kReady, std::memory_order_release);
+    }
+    else
+    {
+        wait_until([&]
+                   { return segment->ready.load(std::memory_order_acquire) == kReady; },
+                   "la inicialización de la memoria compartida");
+        if (segment->world_size != world_size)
+            throw std::runtime_error("la memoria compartida " + name + " pertenece a otro trabajo");
+    }
+    barrier();
+    // Everybody is attached: the name is no longer needed, and the mapping
+    // disappears with the last process even after a crash.
+    if (rank == 0)
+        shm_unlink(name.c_str());
+}
+
+ShmCollective::~ShmCollective()
+{
+    if (segment != nullptr)
+        munmap(segment, mapped_bytes);
+}
+
+float *ShmCollective::slot(int r) const
+{
+    return reinterpret_cast<float *>(reinterpret_cast<char *>(segment) + sizeof(Segment)) + r * kSlotFloats;
+}
+
+void ShmCollective::barrier()
+{
+    unsigned long long generation = segment->generation.load(std::memory_order_acquire);
+    if (segment->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<unsigned long long>(world_size_))
+    {
+        segment->arrived.store(0, std::memory_order_relaxed);
+        segment->generation.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+    wait_until([&]
+               { return segment->generation.load(std::memory_order_acquire) != generation; },
+               "la barrera");
+}
+
+// Every rank alternates send / receive, so message m from a rank is read by
+// its successor as that successor's m-th receive.
+void ShmCollective::send(const float *data, std::size_t count)
+{
+    const unsigned long long message = ++sent;
+    RankFlags &next = segment->flags[(rank_ + 1) % world_size_];
+    wait_until([&]
+               { return next.consumed.load(std::memory_order_acquire) >= message - 1; },
+               "all-reduce (envío)");
+    std::memcpy(slot(rank_), data, count * sizeof(float));
+    segment->flags[rank_].posted.store(message, std::memory_order_release);
+}
+
+void ShmCollective::receive(float *data, std::size_t count, bool accumulate)
+{
+    const int prev = (rank_ + world_size_ - 1) % world_size_;
+    const unsigned long long message = sent;
+    wait_until([&]
+               { return segment->flags[prev].posted.load(std::memory_order_acquire) >= message; },
+               "all-reduce (recepción)");
+    const float *in = slot(prev);
+    if (accumulate)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            data[i] += in[i];
+    }
+    else
+    {
+        std::memcpy(data, in, count * sizeof(float));
+    }
+    segment->flags[rank_].consumed.store(message, std::memory_order_release);
+}
+
+// Ring all-reduce: w - 1 reduce-scatter steps leave rank r with the full sum
+// of chunk r + 1, and w - 1 all-gather steps pass the sums around.
+void ShmCollective::all_reduce_sum(float *data, std::size_t count)
+{
+    const int w = world_size_;
+    if (w == 1)
+        return;
+    const std::size_t window = w * kSlotFloats;
+    for (std::size_t base = 0; base < count; base += window)
+    {
+        float *x = data + base;
+        const std::size_t n = std::min(window, count - base);
+        auto begin = [&](int chunk)
+        { return chunk * n / w; };
+        auto length = [&](int chunk)
+        { return (chunk + 1) * n / w - chunk * n / w; };
+
+        for (int s = 0; s < w - 1; s++)
+        {
+            int out = (rank_ - s + w) % w, in = (rank_ - s - 1 + 2 * w) % w;
+            send(x + begin(out), length(out));
+            receive(x + begin(in), length(in), true);
+        }
+        for (int s = 0; s < w - 1; s++)
+        {
+            int out = (rank_ + 1 - s + w) % w, in = (rank_ - s + w) % w;
+            send(x + begin(out), length(out));
+            receive(x + begin(in), length(in), false);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include "../../include/core/svd.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+    const int kMaxSweeps = 60;
+    const double kTolerance = 1e-12;
+
+    // Orthogonalizes the columns of a (rows x cols, column-major) against
+    // each other, applying the same rotations to v (cols x cols).
+    void jacobi_sweeps(std::vector<double> &a, int rows, int cols, std::vector<double> &v)
+    {
+        for (int sweep = 0; sweep < kMaxSweeps; sweep++)
+        {
+            bool rotated = false;
+            for (int p = 0; p < cols - 1; p++)
+            {
+                for (int q = p + 1; q < cols; q++)
+                {
+                    double *ap = &a[static_cast<size_t>(p) * rows], *aq = &a[static_cast<size_t>(q) * rows];
+                    double alpha = 0.0, beta = 0.0, gamma = 0.0;
+                    for (int i = 0; i < rows; i++)
+                    {
+                        alpha += ap[i] * ap[i];
+                        beta += aq[i] * aq[i];
+                        gamma += ap[i] * aq[i];
+                    }
+                    if (std::fabs(gamma) <= kTolerance * std::sqrt(alpha * beta))
+                        continue;
+                    rotated = true;
+
+                    double zeta = (beta - alpha) / (2.0 * gamma);
+                    double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                    double c = 1.0 / std::sqrt(1.0 + t * t), s = c * t;
+                    for (int i = 0; i < rows; i++)
+                    {
+                        double x = ap[i], y = aq[i];
+                        ap[i] = c * x - s * y;
+                        aq[i] = s * x + c * y;
+                    }
+                    double *vp = &v[static_cast<size_t>(p) * cols], *vq = &v[static_cast<size_t>(q) * cols];
+                    for (int i = 0; i < cols; i++)
+                    {
+                        double x = vp[i], y = vq[i];
+                        vp[i] = c * x - s * y;
+                        vq[i] = s * x + c * y;
+                    }
+                }
+            }
+            if (!rotated)
+                break;
+        }
+    }
+}
+
+void svd(const Tensor &a, Tensor &u, std::vector<float> &s, Tensor &v)
+{
+    // Jacobi works on the columns, so decompose whichever of a / a^T has
+    // fewer of them and swap the factors back at the end.
+    const bool transposed = a.cols > a.rows;
+    const int rows = transposed ? a.cols : a.rows;
+    const int cols = transposed ? a.rows : a.cols;
+
+    std::vector<double> work(static_cast<size_t>(rows) * cols), rot(static_cast<size_t>(cols) * cols, 0.0);
+    for (int j = 0; j < cols; j++)
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            work[static_cast<size_t>(j) * rows + i] = transposed ? a(j, i) : a(i, j);
+        }
+        rot[static_cast<size_t>(j) * cols + j] = 1.0;
+    }
+    jacobi_sweeps(work, rows, cols, rot);
+
+    std::vector<double> norms(cols, 0.0);
+    for (int j = 0; j < cols; j++)
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            norms[j] += work[static_cast<size_t>(j) * rows + i] * work[static_cast<size_t>(j) * rows + i];
+        }
+        norms[j] = std::sqrt(norms[j]);
+    }
+    std::vector<int> order(cols);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int x, int y)
+                     { return norms[x] > norms[y]; });
+
+    // left: rows x cols singular vectors of the decomposed matrix, right: cols x cols.
+    Tensor left(rows, cols), right(cols, cols);
+    s.assign(cols, 0.0f);
+    for (int k = 0; k < cols; k++)
+    {
+        const int j = order[k];
+        s[k] = static_cast<float>(norms[j]);
+        for (int i = 0; i < rows; i++)
+        {
+            left(i, k) = norms[j] > 0.0 ? static_cast<float>(work[static_cast<size_t>(j) * rows + i] / norms[j]) : 0.0f;
+        }
+        for (int i = 0; i < cols; i++)
+        {
+            right(i, k) = static_cast<float>(rot[static_cast<size_t>(j) * cols + i]);
+        }
+    }
+    u = transposed ? right : left;
+    v = transposed ? left : right;
+}
@@ -0,0 +1,312 @@
+#include "../../include/core/task_scheduler.h"
+#include "../../include/core/topology.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct Task
+{
+    std::function<void()> fn;
+    // Unfinished dependencies plus one guard held by spawn() itself.
+    std::atomic<int> unfinished{1};
+    std::atomic<bool> done{false};
+    std::mutex mutex;
+    std::vector<TaskHandle> dependents;
+};
+
+namespace
+{
+    // How long an idle waiter sleeps before polling the queues again.
+    const std::chrono::microseconds kWaitPoll(50);
+
+    // Index of the calling thread in the pool, or -1 outside the pool.
+    thread_local int worker_index = -1;
+
+    int default_num_threads()
+    {
+        const char *env = std::getenv("VIT_NUM_THREADS");
+        if (env != nullptr && std::atoi(env) > 0)
+            return std::atoi(env);
+        int hw = static_cast<int>(std::thread::hardware_concurrency());
+        return hw > 0 ? hw : 1;
+    }
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<TaskHandle> tasks;
+    };
+
+    class Scheduler
+    {
+    public:
+        // The creating thread takes pool slot 0 under VIT_PIN_THREADS.
+        explicit Scheduler(int n)
+        {
+            Topology::pin_current_thread(Topology::slot_cpu(0));
+            start(n);
+        }
+        ~Scheduler() { stop(); }
+
+        int size() const { return static_cast<int>(workers.size()) + 1; }
+
+        void resize(int n)
+        {
+            std::lock_guard<std::mutex> lock(resize_mutex);
+            stop();
+            start(n);
+        }
+
+        void enqueue(const TaskHandle &task)
+        {
+            if (worker_index >= 0 && worker_index < static_cast<int>(queues.size()))
+            {
+                WorkQueue &own = *queues[worker_index];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                own.tasks.push_back(task);
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(injection.mutex);
+                injection.tasks.push_back(task);
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                queued++;
+            }
+            wake.notify_one();
+        }
+
+        void release(const TaskHandle &task)
+        {
+            if (task->unfinished.fetch_sub(1) == 1)
+                enqueue(task);
+        }
+
+        void execute(const TaskHandle &task)
+        {
+            task->fn();
+            task->fn = nullptr;
+
+            std::vector<TaskHandle> ready;
+            {
+                std::lock_guard<std::mutex> lock(task->mutex);
+                task->done.store(true);
+                ready.swap(task->dependents);
+            }
+            for (const TaskHandle &dependent : ready)
+            {
+                release(dependent);
+            }
+            if (waiters.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                wake.notify_all();
+            }
+        }
+
+        void wait(const TaskHandle &task)
+        {
+            while (!task->done.load())
+            {
+                TaskHandle next = find_task();
+                if (next)
+                {
+                    execute(next);
+                    continue;
+                }
+                waiters++;
+                {
+                    std::unique_lock<std::mutex> lock(sleep_mutex);
+                    wake.wait_for(lock, kWaitPoll, [&]
+                                  { return task->done.load() || queued > 0; });
+                }
+                waiters--;
+            }
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        WorkQueue injection;
+        std::mutex resize_mutex;
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        long queued = 0;
+        std::atomic<int> waiters{0};
+        bool stopping = false;
+
+        void start(int n)
+        {
+            stopping = false;
+            for (int i = 1; i < n; i++)
+            {
+                queues.push_back(std::make_unique<WorkQueue>());
+            }
+            for (int i = 0; i < n - 1; i++)
+            {
+                workers.emplace_back([this, i]
+                                     { worker_loop(i); });
+            }
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+            workers.clear();
+            // Anything still queued on a worker moves to the injection queue
+            // so it survives the resize.
+            for (auto &queue : queues)
+            {
+                for (TaskHandle &task : queue->tasks)
+                {
+                    injection.tasks.push_back(task);
+                }
+            }
+            queues.clear();
+        }
+
+        TaskHandle pop_back(WorkQueue &queue)
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                return nullptr;
+            TaskHandle task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return task;
+        }
+
+        TaskHandle pop_front(WorkQueue &queue)
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                return nullptr;
+            TaskHandle task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return task;
+        }
+
+        TaskHandle find_task()
+        {
+            TaskHandle task;
+            int self = worker_index;
+            int n = static_cast<int>(queues.size());
+            if (self >= 0 && self < n)
+                task = pop_back(*queues[self]);
+            if (!task)
+                task = pop_front(injection);
+            for (int offset = 1; !task && offset <= n; offset++)
+            {
+                int victim = ((self < 0 ? 0 : self) + offset) % n;
+                if (victim != self)
+                    task = pop_front(*queues[victim]);
+            }
+            if (task)
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                queued--;
+            }
+            return task;
+        }
+
+        void worker_loop(int index)
+        {
+            worker_index = index;
+            Topology::pin_current_thread(Topology::slot_cpu(index + 1));
+            while (true)
+            {
+                TaskHandle task = find_task();
+                if (task)
+                {
+                    execute(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wake.wait(lock, [this]
+                          { return stopping || queued > 0; });
+                if (stopping)
+                    break;
+            }
+            worker_index = -1;
+        }
+    };
+
+    Scheduler &scheduler()
+    {
+        static Scheduler instance(default_num_threads());
+        return instance;
+    }
+}
+
+void TaskScheduler::set_num_threads(int n)
+{
+    scheduler().resize(std::max(1, n));
+}
+
+int TaskScheduler::num_threads()
+{
+    return scheduler().size();
+}
+
+TaskHandle TaskScheduler::spawn(std::function<void()> fn, const std::vector<TaskHandle> &dependencies)
+{
+    TaskHandle task = std::make_shared<Task>();
+    task->fn = std::move(fn);
+    for (const TaskHandle &dependency : dependencies)
+    {
+        if (!dependency)
+            continue;
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->done.load())
+        {
+            task->unfinished++;
+            dependency->dependents.push_back(task);
+        }
+    }
+    scheduler().release(task);
+    return task;
+}
+
+void TaskScheduler::wait(const TaskHandle &task)
+{
+    if (task)
+        scheduler().wait(task);
+}
+
+bool TaskScheduler::is_done(const TaskHandle &task)
+{
+    return !task || task->done.load();
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+TaskHandle TaskGroup::run(std::function<void()> fn, const std::vector<TaskHandle> &dependencies)
+{
+    TaskHandle task = TaskScheduler::spawn(std::move(fn), dependencies);
+    tasks.push_back(task);
+    return task;
+}
+
+void TaskGroup::wait()
+{
+    for (const TaskHandle &task : tasks)
+    {
+        TaskScheduler::wait(task);
+    }
+    tasks.clear();
+}
@@ -0,0 +1,250 @@
+#include "../../include/core/collective.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    struct Endpoint
+    {
+        std::string host;
+        int port;
+    };
+
+    double timeout_seconds()
+    {
+        const char *env = std::getenv("VIT_DIST_TIMEOUT");
+        return env != nullptr && std::atof(env) > 0 ? std::atof(env) : 300.0;
+    }
+
+    Endpoint parse_endpoint(const std::string &text)
+    {
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos)
+            throw std::runtime_error("dirección sin puerto: " + text);
+        return {text.substr(0, colon), std::atoi(text.c_str() + colon + 1)};
+    }
+
+    // "host:port" gives rank r port + r on that host; a comma-separated
+    // list gives every rank its own endpoint.
+    std::vector<Endpoint> parse_endpoints(const std::string &address, int world_size)
+    {
+        std::vector<Endpoint> endpoints;
+        if (address.find(',') == std::string::npos)
+        {
+            Endpoint base = parse_endpoint(address);
+            for (int r = 0; r < world_size; r++)
+                endpoints.push_back({base.host, base.port + r});
+            return endpoints;
+        }
+        std::stringstream ss(address);
+        std::string item;
+        while (std::getline(ss, item, ','))
+            endpoints.push_back(parse_endpoint(item));
+        if (static_cast<int>(endpoints.size()) != world_size)
+            throw std::runtime_error("VIT_DIST_ADDR debe tener una dirección por proceso");
+        return endpoints;
+    }
+
+    sockaddr_storage resolve(const Endpoint &endpoint, socklen_t &length)
+    {
+        addrinfo hints{}, *result = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        std::string port = std::to_string(endpoint.port);
+        if (getaddrinfo(endpoint.host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr)
+            throw std::runtime_error("no se pudo resolver " + endpoint.host);
+        sockaddr_storage address{};
+        std::memcpy(&address, result->ai_addr, result->ai_addrlen);
+        length = result->ai_addrlen;
+        freeaddrinfo(result);
+        return address;
+    }
+
+    void write_all(int fd, const void *data, size_t bytes)
+    {
+        const char *p = static_cast<const char *>(data);
+        while (bytes > 0)
+        {
+            ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL);
+            if (n <= 0)
+                throw std::runtime_error(std::string("error de envío: ") + std::strerror(errno));
+            p += n;
+            bytes -= n;
+        }
+    }
+
+    void read_all(int fd, void *data, size_t bytes)
+    {
+        char *p = static_cast<char *>(data);
+        while (bytes > 0)
+        {
+            ssize_t n = recv(fd, p, bytes, 0);
+            if (n <= 0)
+                throw std::runtime_error("conexión cerrada por otro proceso");
+            p += n;
+            bytes -= n;
+        }
+    }
+
+    void configure(int fd)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+// Every rank listens on its own endpoint, connects to the next rank and
+// accepts the previous one; each side sends its rank first so a stray
+// connection is caught before any data moves.
+TcpCollective::TcpCollective(int rank, int world_size, const std::string &address)
+    : Collective(rank, world_size)
+{
+    if (world_size == 1)
+        return;
+    std::vector<Endpoint> endpoints = parse_endpoints(address, world_size);
+    const int next = (rank + 1) % world_size, prev = (rank + world_size - 1) % world_size;
+
+    socklen_t length;
+    sockaddr_storage own = resolve(endpoints[rank], length);
+    int listener = socket(own.ss_family, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&own), length) != 0 || listen(listener, 4) != 0)
+    {
+        std::string reason = std::strerror(errno);
+        if (listener >= 0)
+            close(listener);
+        throw std::runtime_error("no se pudo escuchar en " + endpoints[rank].host + ":" +
+                                 std::to_string(endpoints[rank].port) + ": " + reason);
+    }
+
+    // The next rank may not be listening yet: retry until the timeout.
+    sockaddr_storage target = resolve(endpoints[next], length);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout_seconds());
+    while (true)
+    {
+        next_fd = socket(target.ss_family, SOCK_STREAM, 0);
+        if (next_fd >= 0 && connect(next_fd, reinterpret_cast<sockaddr *>(&target), length) == 0)
+            break;
+        if (next_fd >= 0)
+            close(next_fd);
+        next_fd = -1;
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            close(listener);
+            throw std::runtime_error("no se pudo conectar con el proceso " + std::to_string(next));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    configure(next_fd);
+    int32_t id = rank;
+    write_all(next_fd, &id, sizeof(id));
+
+    prev_fd = accept(listener, nullptr, nullptr);
+    close(listener);
+    if (prev_fd < 0)
+        throw std::runtime_error("no se pudo aceptar la conexión del proceso " + std::to_string(prev));
+    configure(prev_fd);
+    read_all(prev_fd, &id, sizeof(id));
+    if (id != prev)
+        throw std::runtime_error("se esperaba el proceso " + std::to_string(prev) + " y se conectó el " + std::to_string(id));
+
+    fcntl(next_fd, F_SETFL, fcntl(next_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(prev_fd, F_SETFL, fcntl(prev_fd, F_GETFL) | O_NONBLOCK);
+}
+
+TcpCollective::~TcpCollective()
+{
+    if (next_fd >= 0)
+        close(next_fd);
+    if (prev_fd >= 0)
+        close(prev_fd);
+}
+
+void TcpCollective::exchange(const float *out, std::size_t out_count, float *in, std::size_t in_count)
+{
+    const char *send_ptr = reinterpret_cast<const char *>(out);
+    char *recv_ptr = reinterpret_cast<char *>(in);
+    size_t to_send = out_count * sizeof(float), to_recv = in_count * sizeof(float);
+    const int timeout_ms = static_cast<int>(timeout_seconds() * 1000);
+    while (to_send > 0 || to_recv > 0)
+    {
+        pollfd fds[2] = {{next_fd, static_cast<short>(to_send > 0 ? POLLOUT : 0), 0},
+                         {prev_fd, static_cast<short>(to_recv > 0 ? POLLIN : 0), 0}};
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready == 0)
+            throw std::runtime_error("tiempo de espera agotado en all-reduce (tcp)");
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("error en poll: ") + std::strerror(errno));
+        }
+        if (to_send > 0 && (fds[0].revents & (POLLOUT | POLLERR | POLLHUP)))
+        {
+            ssize_t n = send(next_fd, send_ptr, to_send, MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                throw std::runtime_error(std::string("error de envío: ") + std::strerror(errno));
+            if (n > 0)
+            {
+                send_ptr += n;
+                to_send -= n;
+            }
+        }
+        if (to_recv > 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP)))
+        {
+            ssize_t n = recv(prev_fd, recv_ptr, to_recv, 0);
+            if (n == 0)
+                throw std::runtime_error("conexión cerrada por otro proceso");
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                throw std::runtime_error(std::string("error de recepción: ") + std::strerror(errno));
+            if (n > 0)
+            {
+                recv_ptr += n;
+                to_recv -= n;
+            }
+        }
+    }
+}
+
+// Same ring schedule as ShmCollective, with no window limit: the socket
+// buffers bound nothing since both directions progress together.
+void TcpCollective::all_reduce_sum(float *data, std::size_t count)
+{
+    const int w = world_size_;
+    if (w == 1 || count == 0)
+        return;
+    auto begin = [&](int chunk)
+    { return chunk * count / w; };
+    auto length = [&](int chunk)
+    { return (chunk + 1) * count / w - chunk * count / w; };
+    incoming.resize(count / w + 1);
+
+    for (int s = 0; s < w - 1; s++)
+    {
+        int out = (rank_ - s + w) % w, in = (rank_ - s - 1 + 2 * w) % w;
+        exchange(data + begin(out), length(out), incoming.data(), length(in));
+        float *target = data + begin(in);
+        for (std::size_t i = 0; i < length(in); i++)
+            target[i] += incoming[i];
+    }
+    for (int s = 0; s < w - 1; s++)
+    {
+        int out = (rank_ + 1 - s + w) % w, in = (rank_ - s + w) % w;
+        exchange(data + begin(out), length(out), data + begin(in), length(in));
+    }
+}
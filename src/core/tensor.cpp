@@ -1,83 +1,433 @@
 #include "../../include/core/tensor.h"
 #include "../../include/core/random.h"
+#include "../../include/core/parallel.h"
 
-Tensor::Tensor() : rows(0), cols(0) {}
+namespace
+{
+    std::atomic<long long> copied_bytes{0};
+    std::atomic<long long> shared_bytes{0};
+    std::atomic<bool> copy_on_write{true};
+}
+
+TensorStorage::TensorStorage(const TensorStorage &other) : values(other.values)
+{
+    if (!values)
+        return;
+    if (copy_on_write.load(std::memory_order_relaxed))
+        shared_bytes.fetch_add(values->size() * sizeof(float), std::memory_order_relaxed);
+    else
+        detach();
+}
+
+TensorStorage &TensorStorage::operator=(const TensorStorage &other)
+{
+    if (this != &other)
+    {
+        TensorStorage copy(other);
+        values = std::move(copy.values);
+    }
+    return *this;
+}
+
+void TensorStorage::detach()
+{
+    copied_bytes.fetch_add(values->size() * sizeof(float), std::memory_order_relaxed);
+    values = std::make_shared<std::vector<float>>(*values);
+}
+
+void TensorStorage::resize(std::size_t n, float value)
+{
+    if (n == size())
+        return;
+    if (!values)
+        values = std::make_shared<std::vector<float>>(n, value);
+    else if (shared())
+    {
+        auto resized = std::make_shared<std::vector<float>>(n, value);
+        std::copy(values->begin(), values->begin() + std::min(n, values->size()), resized->begin());
+        copied_bytes.fetch_add(std::min(n, values->size()) * sizeof(float), std::memory_order_relaxed);
+        values = std::move(resized);
+    }
+    else
+        values->resize(n, value);
+}
+
+const std::vector<float> &TensorStorage::vector() const
+{
+    static const std::vector<float> none;
+    return values ? *values : none;
+}
+
+long long TensorStorage::bytes_copied()
+{
+    return copied_bytes.load();
+}
+
+long long TensorStorage::bytes_shared()
+{
+    return shared_bytes.load();
+}
+
+void TensorStorage::reset_counters()
+{
+    copied_bytes = 0;
+    shared_bytes = 0;
+}
+
+void TensorStorage::set_copy_on_write(bool enabled)
+{
+    copy_on_write = enabled;
+}
+
+Tensor::Tensor()
+{
+    const int shape[] = {0, 0};
+    set_shape(shape, 2);
+}
 
-Tensor::Tensor(int r, int c) : rows(r), cols(c)
+Tensor::Tensor(int r, int c) : data(static_cast<std::size_t>(r) * c)
 {
-    data.resize(rows * cols, 0.0f);
+    const int shape[] = {r, c};
+    set_shape(shape, 2);
 }
 
-Tensor::Tensor(const std::vector<std::vector<float>> &d) : rows(d.size()), cols(d[0].size())
+Tensor::Tensor(const std::vector<int> &shape)
 {
-    data.resize(rows * cols);
+    assert(!shape.empty() && static_cast<int>(shape.size()) <= kMaxRank);
+    set_shape(shape.data(), shape.size());
+    data.resize(numel());
+}
+
+Tensor::Tensor(const std::vector<std::vector<float>> &d) : data(d.size() * d[0].size())
+{
+    const int shape[] = {static_cast<int>(d.size()), static_cast<int>(d[0].size())};
+    set_shape(shape, 2);
+    float *out = data.data();
     for (int i = 0; i < rows; i++)
     {
-        for (int j = 0; j < cols; j++)
-        {
-            data[i * cols + j] = d[i][j];
-        }
+        std::copy(d[i].begin(), d[i].end(), out + static_cast<std::size_t>(i) * cols);
+    }
+}
+
+void Tensor::set_shape(const int *shape, int rank)
+{
+    ndim = rank;
+    long step = 1;
+    for (int axis = rank - 1; axis >= 0; axis--)
+    {
+        dims[axis] = shape[axis];
+        steps[axis] = step;
+        step *= shape[axis];
+    }
+    fold_2d();
+}
+
+void Tensor::fold_2d()
+{
+    cols = dims[ndim - 1];
+    rows = 1;
+    for (int axis = 0; axis + 1 < ndim; axis++)
+        rows *= dims[axis];
+}
+
+bool Tensor::is_contiguous() const
+{
+    long step = 1;
+    for (int axis = ndim - 1; axis >= 0; axis--)
+    {
+        if (dims[axis] != 1 && steps[axis] != step)
+            return false;
+        step *= dims[axis];
     }
+    return true;
+}
+
+std::size_t Tensor::element(std::initializer_list<int> index) const
+{
+    assert(static_cast<int>(index.size()) == ndim);
+    std::size_t e = offset;
+    int axis = 0;
+    for (int i : index)
+        e += static_cast<long>(i) * steps[axis++];
+    return e;
 }
 
 float &Tensor::operator()(int i, int j)
 {
-    return data[i * cols + j];
+    return data[offset + static_cast<std::size_t>(i) * cols + j];
 }
 
 const float &Tensor::operator()(int i, int j) const
 {
-    return data[i * cols + j];
+    return data[offset + static_cast<std::size_t>(i) * cols + j];
 }
 
-Tensor Tensor::operator+(const Tensor &other) const
+Tensor Tensor::reshape(const std::vector<int> &shape) const
 {
-    assert(rows == other.rows && cols == other.cols);
-    Tensor result(rows, cols);
-    for (int i = 0; i < rows * cols; i++)
+    if (!is_contiguous())
+        return contiguous().reshape(shape);
+    std::vector<int> resolved = shape;
+    long known = 1;
+    int inferred = -1;
+    for (size_t axis = 0; axis < resolved.size(); axis++)
+    {
+        if (resolved[axis] < 0)
+            inferred = axis;
+        else
+            known *= resolved[axis];
+    }
+    if (inferred >= 0)
+        resolved[inferred] = known > 0 ? static_cast<int>(numel() / known) : 0;
+    assert(!resolved.empty() && static_cast<int>(resolved.size()) <= kMaxRank);
+
+    Tensor view = *this;
+    view.set_shape(resolved.data(), resolved.size());
+    assert(view.numel() == numel());
+    return view;
+}
+
+Tensor Tensor::permute(const std::vector<int> &axes) const
+{
+    assert(static_cast<int>(axes.size()) == ndim);
+    Tensor view = *this;
+    for (int axis = 0; axis < ndim; axis++)
+    {
+        view.dims[axis] = dims[axes[axis]];
+        view.steps[axis] = steps[axes[axis]];
+    }
+    view.fold_2d();
+    return view;
+}
+
+Tensor Tensor::transpose(int axis_a, int axis_b) const
+{
+    std::vector<int> axes(ndim);
+    for (int axis = 0; axis < ndim; axis++)
+        axes[axis] = axis;
+    std::swap(axes[axis_a < 0 ? axis_a + ndim : axis_a], axes[axis_b < 0 ? axis_b + ndim : axis_b]);
+    return permute(axes);
+}
+
+Tensor Tensor::select(int axis, int index) const
+{
+    axis = axis < 0 ? axis + ndim : axis;
+    assert(ndim > 1 && index >= 0 && index < dims[axis]);
+    Tensor view = *this;
+    view.offset = offset + static_cast<std::size_t>(index) * steps[axis];
+    view.ndim = ndim - 1;
+    for (int a = axis; a + 1 < ndim; a++)
+    {
+        view.dims[a] = dims[a + 1];
+        view.steps[a] = steps[a + 1];
+    }
+    view.fold_2d();
+    return view;
+}
+
+Tensor Tensor::broadcast_to(const std::vector<int> &shape) const
+{
+    const int rank = shape.size();
+    assert(rank >= ndim && rank <= kMaxRank);
+    Tensor view = *this;
+    view.set_shape(shape.data(), rank);
+    for (int axis = rank - 1; axis >= 0; axis--)
     {
-        result.data[i] = data[i] + other.data[i];
+        const int own = axis - (rank - ndim);
+        if (own >= 0 && dims[own] == shape[axis])
+            view.steps[axis] = steps[own];
+        else
+        {
+            assert(own < 0 || dims[own] == 1);
+            view.steps[axis] = 0;
+        }
     }
+    return view;
+}
+
+Tensor Tensor::contiguous() const
+{
+    if (is_contiguous())
+        return *this;
+    // One pass per run of the last axis; every run starts at the storage
+    // position of its multi-index over the other axes.
+    Tensor result(shape());
+    const int inner = cols;
+    const long inner_step = steps[ndim - 1];
+    const float *in = data.data();
+    float *out = result.data.data();
+    Parallel::parallel_for(0, rows, Parallel::grain_size(inner), [&](int begin, int end)
+                           {
+        for (int r = begin; r < end; r++)
+        {
+            std::size_t from = offset;
+            for (int axis = ndim - 2, rest = r; axis >= 0; axis--)
+            {
+                from += static_cast<long>(rest % dims[axis]) * steps[axis];
+                rest /= dims[axis];
+            }
+            float *to = out + static_cast<std::size_t>(r) * inner;
+            for (int j = 0; j < inner; j++)
+                to[j] = in[from + j * inner_step];
+        } });
     return result;
 }
 
-Tensor Tensor::operator-(const Tensor &other) const
+Tensor &Tensor::broadcast_add(const Tensor &other)
 {
-    assert(rows == other.rows && cols == other.cols);
-    Tensor result(rows, cols);
-    for (int i = 0; i < rows * cols; i++)
+    if (!is_contiguous())
+        *this = contiguous();
+    const std::size_t n = numel(), block = other.numel();
+    bool suffix = other.is_contiguous() && other.ndim <= ndim;
+    for (int axis = 0; suffix && axis < other.ndim; axis++)
+        suffix = other.dims[axis] == dims[ndim - other.ndim + axis];
+    float *out = values();
+    if (suffix)
     {
-        result.data[i] = data[i] - other.data[i];
+        // The common case, a bias or embedding table repeated over the
+        // leading axes: a contiguous add per block.
+        const float *in = other.values();
+        Parallel::parallel_for(0, n / std::max<std::size_t>(1, block), Parallel::grain_size(block), [&](int begin, int end)
+                               {
+            for (int b = begin; b < end; b++)
+            {
+                float *to = out + static_cast<std::size_t>(b) * block;
+#pragma GCC ivdep
+                for (std::size_t j = 0; j < block; j++)
+                    to[j] += in[j];
+            } });
+        return *this;
     }
+    Tensor expanded = other.broadcast_to(shape()).contiguous();
+    const float *in = expanded.values();
+    for (std::size_t i = 0; i < n; i++)
+        out[i] += in[i];
+    return *this;
+}
+
+Tensor Tensor::zeros_like(const Tensor &other, int last_dim)
+{
+    int shape[kMaxRank];
+    std::copy(other.dims, other.dims + other.ndim, shape);
+    if (last_dim >= 0)
+        shape[other.ndim - 1] = last_dim;
+    Tensor result;
+    result.set_shape(shape, other.ndim);
+    result.data.resize(result.numel());
     return result;
 }
 
-Tensor Tensor::operator*(const Tensor &other) const
+Tensor Tensor::stack(const std::vector<Tensor> &tensors)
 {
-    assert(cols == other.rows);
-    Tensor result(rows, other.cols);
-    for (int i = 0; i < rows; i++)
+    assert(!tensors.empty() && tensors[0].ndim < kMaxRank);
+    std::vector<int> shape = tensors[0].shape();
+    shape.insert(shape.begin(), tensors.size());
+    Tensor result(shape);
+    const std::size_t block = tensors[0].numel();
+    float *out = result.data.data();
+    for (size_t i = 0; i < tensors.size(); i++)
+    {
+        assert(tensors[i].numel() == block);
+        Tensor dense = tensors[i].contiguous();
+        std::copy(dense.values(), dense.values() + block, out + i * block);
+    }
+    return result;
+}
+
+Tensor Tensor::matmul(const Tensor &a, const Tensor &b)
+{
+    assert(a.ndim >= 2 && b.ndim >= 2 && a.dim(-1) == b.dim(-2));
+    const Tensor lhs = a.contiguous(), rhs = b.contiguous();
+    const int m = a.dim(-2), inner = a.dim(-1), n = b.dim(-1);
+
+    // Leading axes, aligned from the right; a missing or size-1 axis of
+    // one operand is repeated along the other.
+    const int batch_rank = std::max(a.ndim, b.ndim) - 2;
+    std::vector<int> shape(batch_rank + 2);
+    for (int axis = 0; axis < batch_rank; axis++)
+    {
+        const int ai = axis - (batch_rank - (a.ndim - 2)), bi = axis - (batch_rank - (b.ndim - 2));
+        const int da = ai >= 0 ? a.dims[ai] : 1, db = bi >= 0 ? b.dims[bi] : 1;
+        assert(da == db || da == 1 || db == 1);
+        shape[axis] = std::max(da, db);
+    }
+    shape[batch_rank] = m;
+    shape[batch_rank + 1] = n;
+    Tensor result(shape);
+    const int batch = result.numel() / (static_cast<std::size_t>(m) * n);
+
+    std::vector<std::size_t> a_offsets(batch), b_offsets(batch);
+    for (int bi = 0; bi < batch; bi++)
     {
-        for (int j = 0; j < other.cols; j++)
+        std::size_t a_index = 0, b_index = 0, a_scale = 1, b_scale = 1;
+        for (int axis = batch_rank - 1, rest = bi; axis >= 0; axis--)
         {
-            float sum = 0.0f;
-            for (int k = 0; k < cols; k++)
+            const int i = rest % shape[axis];
+            rest /= shape[axis];
+            const int ax = axis - (batch_rank - (a.ndim - 2)), bx = axis - (batch_rank - (b.ndim - 2));
+            if (ax >= 0)
+            {
+                a_index += (a.dims[ax] == 1 ? 0 : i) * a_scale;
+                a_scale *= a.dims[ax];
+            }
+            if (bx >= 0)
             {
-                sum += (*this)(i, k) * other(k, j);
+                b_index += (b.dims[bx] == 1 ? 0 : i) * b_scale;
+                b_scale *= b.dims[bx];
             }
-            result(i, j) = sum;
         }
+        a_offsets[bi] = a_index * m * inner;
+        b_offsets[bi] = b_index * inner * n;
     }
+
+    // Same i-k-j order as operator*, over batch * m output rows.
+    const float *pa = lhs.values(), *pb = rhs.values();
+    float *pc = result.data.data();
+    Parallel::parallel_for(0, batch * m, Parallel::grain_size(static_cast<long>(inner) * n), [&](int begin, int end)
+                           {
+        for (int row = begin; row < end; row++)
+        {
+            const int bi = row / m, i = row % m;
+            const float *a_row = pa + a_offsets[bi] + static_cast<size_t>(i) * inner;
+            const float *b_mat = pb + b_offsets[bi];
+            float *c_row = pc + static_cast<size_t>(row) * n;
+            for (int k = 0; k < inner; k++)
+            {
+                float a_ik = a_row[k];
+                const float *b_row = b_mat + static_cast<size_t>(k) * n;
+                for (int j = 0; j < n; j++)
+                {
+                    c_row[j] += a_ik * b_row[j];
+                }
+            }
+        } });
     return result;
 }
 
-Tensor Tensor::operator*(float scalar) const
+Tensor Tensor::operator*(const Tensor &other) const
 {
-    Tensor result(rows, cols);
-    for (int i = 0; i < rows * cols; i++)
-    {
-        result.data[i] = data[i] * scalar;
-    }
+    assert(cols == other.rows);
+    Tensor result(rows, other.cols);
+    const int inner = cols, out_cols = other.cols;
+    const float *a = values();
+    const float *b = other.values();
+    float *c = result.data.data();
+    // i-k-j order keeps the innermost loop on contiguous rows of `other` and
+    // `result`; every output still accumulates over k in ascending order.
+    Parallel::parallel_for(0, rows, Parallel::grain_size(static_cast<long>(inner) * out_cols), [&](int begin, int end)
+                           {
+        for (int i = begin; i < end; i++)
+        {
+            float *c_row = c + static_cast<size_t>(i) * out_cols;
+            for (int k = 0; k < inner; k++)
+            {
+                float a_ik = a[static_cast<size_t>(i) * inner + k];
+                const float *b_row = b + static_cast<size_t>(k) * out_cols;
+                for (int j = 0; j < out_cols; j++)
+                {
+                    c_row[j] += a_ik * b_row[j];
+                }
+            }
+        } });
     return result;
 }
 
@@ -96,25 +446,20 @@ Tensor Tensor::transpose() const
 
 void Tensor::zero()
 {
-    std::fill(data.begin(), data.end(), 0.0f);
+    assert(is_contiguous());
+    std::fill(values(), values() + numel(), 0.0f);
 }
 
 void Tensor::xavier_init()
 {
     float std = sqrt(2.0f / (rows + cols));
-    for (float &val : data)
-    {
-        val = Random::randn(0.0f, std);
-    }
+    Random::fill_normal(values(), numel(), 0.0f, std);
 }
 
 void Tensor::he_init()
 {
     float std = sqrt(2.0f / rows);
-    for (float &val : data)
-    {
-        val = Random::randn(0.0f, std);
-    }
+    Random::fill_normal(values(), numel(), 0.0f, std);
 }
 
 Tensor Tensor::eye(int n)
@@ -165,13 +510,7 @@ void Tensor::set_slice(int start_row, int start_col, const Tensor &src)
 
 Tensor Tensor::hadamard(const Tensor &other) const
 {
-    assert(rows == other.rows && cols == other.cols);
-    Tensor result(rows, cols);
-    for (int i = 0; i < rows * cols; i++)
-    {
-        result.data[i] = data[i] * other.data[i];
-    }
-    return result;
+    return BinaryExpr<Tensor, Tensor, MulOp>(*this, other);
 }
 
 Tensor Tensor::row_normalize() const
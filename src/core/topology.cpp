@@ -0,0 +1,244 @@
+#include "../../include/core/topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+    struct Layout
+    {
+        std::vector<std::vector<int>> nodes;
+        std::vector<int> node_of; // indexed by CPU number, -1 outside the allowed set
+        std::vector<int> pin_plan;
+        std::string pin_policy = "none";
+        bool simulated = false;
+    };
+
+    std::vector<int> allowed_cpus()
+    {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+            }
+        }
+        if (cpus.empty())
+            cpus.push_back(0);
+        return cpus;
+    }
+
+    std::string read_line(const std::string &path)
+    {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    // Real nodes with at least one allowed CPU, in node order. Memory-only
+    // nodes and nodes outside the affinity mask are dropped.
+    std::vector<std::vector<int>> sysfs_nodes(const std::vector<int> &allowed)
+    {
+        std::vector<std::vector<int>> nodes;
+        std::vector<int> online;
+        if (!Topology::parse_cpu_list(read_line("/sys/devices/system/node/online"), online))
+            return nodes;
+        for (int node : online)
+        {
+            std::vector<int> cpus, usable;
+            Topology::parse_cpu_list(read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"), cpus);
+            for (int cpu : cpus)
+            {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+                    usable.push_back(cpu);
+            }
+            if (!usable.empty())
+                nodes.push_back(usable);
+        }
+        return nodes;
+    }
+
+    Layout build_layout()
+    {
+        Layout layout;
+        std::vector<int> allowed = allowed_cpus();
+        layout.nodes = sysfs_nodes(allowed);
+        if (layout.nodes.empty())
+            layout.nodes.push_back(allowed);
+
+        const char *simulate = std::getenv("VIT_NUMA_NODES");
+        if (simulate != nullptr && std::atoi(simulate) > 0)
+        {
+            std::vector<int> flat;
+            for (const std::vector<int> &node : layout.nodes)
+            {
+                flat.insert(flat.end(), node.begin(), node.end());
+            }
+            int n = std::min<int>(std::atoi(simulate), flat.size());
+            layout.nodes.assign(n, {});
+            for (size_t i = 0; i < flat.size(); i++)
+            {
+                layout.nodes[i * n / flat.size()].push_back(flat[i]);
+            }
+            layout.simulated = true;
+        }
+
+        for (size_t node = 0; node < layout.nodes.size(); node++)
+        {
+            for (int cpu : layout.nodes[node])
+            {
+                if (cpu >= static_cast<int>(layout.node_of.size()))
+                    layout.node_of.resize(cpu + 1, -1);
+                layout.node_of[cpu] = node;
+            }
+        }
+
+        const char *pin = std::getenv("VIT_PIN_THREADS");
+        std::string policy = pin != nullptr ? pin : "none";
+        if (policy == "compact")
+        {
+            for (const std::vector<int> &node : layout.nodes)
+            {
+                layout.pin_plan.insert(layout.pin_plan.end(), node.begin(), node.end());
+            }
+        }
+        else if (policy == "scatter")
+        {
+            size_t depth = 0;
+            for (const std::vector<int> &node : layout.nodes)
+            {
+                depth = std::max(depth, node.size());
+            }
+            for (size_t i = 0; i < depth; i++)
+            {
+                for (const std::vector<int> &node : layout.nodes)
+                {
+                    if (i < node.size())
+                        layout.pin_plan.push_back(node[i]);
+                }
+            }
+        }
+        else if (policy != "none" && !Topology::parse_cpu_list(policy, layout.pin_plan))
+        {
+            layout.pin_plan.clear();
+            policy = "none";
+        }
+        layout.pin_policy = layout.pin_plan.empty() ? "none" : policy;
+        return layout;
+    }
+
+    const Layout &layout()
+    {
+        static const Layout instance = build_layout();
+        return instance;
+    }
+}
+
+int Topology::num_nodes()
+{
+    return layout().nodes.size();
+}
+
+const std::vector<int> &Topology::cpus(int node)
+{
+    return layout().nodes[node];
+}
+
+int Topology::node_of_cpu(int cpu)
+{
+    const Layout &l = layout();
+    if (cpu < 0 || cpu >= static_cast<int>(l.node_of.size()) || l.node_of[cpu] < 0)
+        return 0;
+    return l.node_of[cpu];
+}
+
+int Topology::current_node()
+{
+    if (num_nodes() == 1)
+        return 0;
+    return node_of_cpu(sched_getcpu());
+}
+
+int Topology::slot_cpu(int slot)
+{
+    const std::vector<int> &plan = layout().pin_plan;
+    if (plan.empty() || slot < 0)
+        return -1;
+    return plan[slot % plan.size()];
+}
+
+bool Topology::pin_current_thread(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool Topology::pin_current_thread_to_node(int node)
+{
+    if (node < 0 || node >= num_nodes())
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus(node))
+    {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool Topology::parse_cpu_list(const std::string &text, std::vector<int> &cpus)
+{
+    cpus.clear();
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty())
+            continue;
+        size_t dash = range.find('-');
+        char *end = nullptr;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end == range.c_str())
+            return false;
+        if (dash != std::string::npos)
+        {
+            const char *second = range.c_str() + dash + 1;
+            last = std::strtol(second, &end, 10);
+            if (end == second)
+                return false;
+        }
+        if (*end != '\0' || first < 0 || last < first)
+            return false;
+        for (long cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return !cpus.empty();
+}
+
+std::string Topology::describe()
+{
+    const Layout &l = layout();
+    std::ostringstream out;
+    out << l.nodes.size() << (l.simulated ? " nodo(s) simulados" : " nodo(s) NUMA") << ":";
+    for (size_t node = 0; node < l.nodes.size(); node++)
+    {
+        out << " [" << node << ": " << l.nodes[node].size() << " CPU]";
+    }
+    out << ", fijación de hilos: " << l.pin_policy;
+    return out.str();
+}
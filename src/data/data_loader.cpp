@@ -0,0 +1,49 @@
+#include "../../include/data/data_loader.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::pair<std::vector<Tensor>, std::vector<int>> DataLoader::load_data(const std::string &filename, int max_samples_to_load, int num_classes_to_load)
+{
+    std::vector<Tensor> images;
+    std::vector<int> labels;
+
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: No se pudo abrir el archivo " << filename << std::endl;
+        exit(1);
+    }
+
+    std::string line;
+    int samples_loaded = 0;
+
+    // Skip header
+    getline(file, line);
+    while (getline(file, line) && (max_samples_to_load == -1 || samples_loaded < max_samples_to_load))
+    {
+        std::stringstream ss(line);
+        std::string cell;
+
+        if (!getline(ss, cell, ','))
+            continue;
+        int label = stoi(cell);
+        if (label >= num_classes_to_load)
+            continue;
+
+        Tensor image(28, 28);
+        for (int i = 0; i < 784; i++)
+        {
+            if (!getline(ss, cell, ','))
+                break;
+            image(i / 28, i % 28) = stof(cell) / 255.0f;
+        }
+        images.push_back(image);
+        labels.push_back(label);
+        samples_loaded++;
+    }
+    file.close();
+    std::cout << "Datos cargados: " << samples_loaded << " muestras de " << filename << std::endl;
+    return {images, labels};
+}
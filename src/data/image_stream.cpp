@@ -0,0 +1,111 @@
+#include "../../include/data/image_stream.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+ImageStream::ImageStream(const std::string &path)
+{
+    namespace fs = std::filesystem;
+    if (fs::is_directory(path))
+    {
+        for (const auto &entry : fs::directory_iterator(path))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".csv")
+                file_list.push_back(entry.path().string());
+        }
+        std::sort(file_list.begin(), file_list.end());
+    }
+    else
+    {
+        file_list.push_back(path);
+    }
+    if (file_list.empty())
+    {
+        std::cerr << "Error: No se encontraron archivos CSV en " << path << std::endl;
+        exit(1);
+    }
+}
+
+bool ImageStream::open_next()
+{
+    while (next_file < file_list.size())
+    {
+        current.close();
+        current.clear();
+        const std::string &filename = file_list[next_file++];
+        current.open(filename);
+        if (!current.is_open())
+        {
+            std::cerr << "Error: No se pudo abrir el archivo " << filename << std::endl;
+            exit(1);
+        }
+        int first = current.peek();
+        if (first != EOF && !std::isdigit(first) && first != '-')
+            getline(current, line);
+        return true;
+    }
+    return false;
+}
+
+bool ImageStream::parse_row(const std::string &row, Tensor &image, int &label)
+{
+    // strtof over the raw characters: stringstream dominates the cost of a
+    // large scoring job otherwise.
+    float cells[785];
+    int count = 0;
+    const char *p = row.c_str();
+    while (*p != '\0' && count < 785)
+    {
+        char *end;
+        cells[count] = std::strtof(p, &end);
+        if (end == p)
+            return false;
+        count++;
+        p = end;
+        while (*p == ' ' || *p == '\r')
+            p++;
+        if (*p == ',')
+            p++;
+        else if (*p != '\0')
+            return false;
+    }
+    if (*p != '\0' || (count != 784 && count != 785))
+        return false;
+
+    const float *pixels = cells + (count - 784);
+    label = count == 785 ? static_cast<int>(cells[0]) : -1;
+    for (int i = 0; i < 784; i++)
+    {
+        image.data[i] = pixels[i] / 255.0f;
+    }
+    return true;
+}
+
+int ImageStream::next_batch(std::vector<Tensor> &images, std::vector<int> &labels, int max_images)
+{
+    int read = 0;
+    while (read < max_images)
+    {
+        if (!current.is_open() || !getline(current, line))
+        {
+            if (!open_next())
+                break;
+            continue;
+        }
+        if (line.empty() || line == "\r")
+            continue;
+        Tensor image(28, 28);
+        int label;
+        if (!parse_row(line, image, label))
+        {
+            skipped_rows++;
+            continue;
+        }
+        images.push_back(std::move(image));
+        labels.push_back(label);
+        read++;
+    }
+    return read;
+}
@@ -0,0 +1,220 @@
+#include "../../include/model/checkpoint.h"
+#include "../../include/core/random.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    const char kCheckpointMagic[8] = {'V', 'I', 'T', 'C', 'K', 'P', 'T', '1'};
+
+    template <typename T>
+    void write_pod(std::ostream &os, const T &value)
+    {
+        os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool read_pod(std::istream &is, T &value)
+    {
+        return static_cast<bool>(is.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    void write_string(std::ostream &os, const std::string &s)
+    {
+        write_pod(os, static_cast<uint64_t>(s.size()));
+        os.write(s.data(), s.size());
+    }
+
+    bool read_string(std::istream &is, std::string &s)
+    {
+        uint64_t size;
+        if (!read_pod(is, size) || size > (1u << 20))
+            return false;
+        s.resize(size);
+        return static_cast<bool>(is.read(&s[0], size));
+    }
+}
+
+void TrainingState::capture(VisionTransformer &model, const TrainingProgress &current, const std::vector<int> &order)
+{
+    progress = current;
+    permutation = order;
+    rng_state = Random::state();
+
+    auto params = model.named_parameters();
+    parameters.resize(params.size());
+    for (size_t i = 0; i < params.size(); i++)
+    {
+        parameters[i].first = params[i].first;
+        parameters[i].second = *params[i].second;
+    }
+}
+
+bool TrainingState::restore(VisionTransformer &model) const
+{
+    auto params = model.named_parameters();
+    if (params.size() != parameters.size())
+        return false;
+    for (size_t i = 0; i < params.size(); i++)
+    {
+        const Tensor &saved = parameters[i].second;
+        if (params[i].first != parameters[i].first || params[i].second->rows != saved.rows || params[i].second->cols != saved.cols)
+            return false;
+    }
+    for (size_t i = 0; i < params.size(); i++)
+    {
+        *params[i].second = parameters[i].second;
+    }
+    return Random::set_state(rng_state);
+}
+
+bool TrainingState::save(const std::string &path) const
+{
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream os(tmp_path, std::ios::binary);
+        if (!os.is_open())
+            return false;
+        os.write(kCheckpointMagic, sizeof(kCheckpointMagic));
+        write_pod(os, static_cast<int32_t>(progress.epoch));
+        write_pod(os, static_cast<int32_t>(progress.batch_count));
+        write_pod(os, static_cast<uint64_t>(progress.batch_start));
+        write_pod(os, progress.train_loss);
+        write_pod(os, static_cast<int32_t>(progress.train_correct));
+        write_string(os, rng_state);
+        write_pod(os, static_cast<uint64_t>(permutation.size()));
+        for (int index : permutation)
+        {
+            write_pod(os, static_cast<int32_t>(index));
+        }
+        write_pod(os, static_cast<uint64_t>(parameters.size()));
+        for (const auto &[name, tensor] : parameters)
+        {
+            write_string(os, name);
+            write_pod(os, static_cast<int32_t>(tensor.rows));
+            write_pod(os, static_cast<int32_t>(tensor.cols));
+            const Tensor dense = tensor.contiguous();
+            os.write(reinterpret_cast<const char *>(dense.values()), dense.numel() * sizeof(float));
+        }
+        os.flush();
+        if (!os)
+            return false;
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool TrainingState::load(const std::string &path)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is.is_open())
+        return false;
+    char magic[sizeof(kCheckpointMagic)];
+    if (!is.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kCheckpointMagic))
+        return false;
+
+    int32_t epoch, batch_count, train_correct, value;
+    uint64_t batch_start, count;
+    if (!read_pod(is, epoch) || !read_pod(is, batch_count) || !read_pod(is, batch_start) ||
+        !read_pod(is, progress.train_loss) || !read_pod(is, train_correct) || !read_string(is, rng_state))
+        return false;
+    progress.epoch = epoch;
+    progress.batch_count = batch_count;
+    progress.batch_start = batch_start;
+    progress.train_correct = train_correct;
+
+    if (!read_pod(is, count))
+        return false;
+    permutation.clear();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (!read_pod(is, value))
+            return false;
+        permutation.push_back(value);
+    }
+
+    if (!read_pod(is, count))
+        return false;
+    parameters.clear();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        std::string name;
+        int32_t rows, cols;
+        if (!read_string(is, name) || !read_pod(is, rows) || !read_pod(is, cols) || rows < 0 || cols < 0)
+            return false;
+        Tensor tensor(rows, cols);
+        if (!is.read(reinterpret_cast<char *>(tensor.values()), tensor.numel() * sizeof(float)))
+            return false;
+        parameters.emplace_back(name, std::move(tensor));
+    }
+    return true;
+}
+
+AsyncCheckpointWriter::AsyncCheckpointWriter(const std::string &checkpoint_path)
+    : path(checkpoint_path), worker(&AsyncCheckpointWriter::run, this)
+{
+}
+
+AsyncCheckpointWriter::~AsyncCheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void AsyncCheckpointWriter::submit(VisionTransformer &model, const TrainingProgress &progress, const std::vector<int> &permutation)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        back.capture(model, progress, permutation);
+        has_pending = true;
+    }
+    cv.notify_all();
+}
+
+void AsyncCheckpointWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]
+            { return !has_pending && !writing; });
+}
+
+int AsyncCheckpointWriter::written() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_written;
+}
+
+int AsyncCheckpointWriter::failed() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_failed;
+}
+
+void AsyncCheckpointWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cv.wait(lock, [this]
+                { return has_pending || stopping; });
+        // Pending snapshots are still written on shutdown.
+        if (!has_pending)
+            return;
+        std::swap(back, front);
+        has_pending = false;
+        writing = true;
+        lock.unlock();
+
+        bool ok = front.save(path);
+
+        lock.lock();
+        writing = false;
+        ok ? num_written++ : num_failed++;
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,597 @@
+#include "../../include/model/compiled_vit.h"
+#include "../../include/core/activation.h"
+#include "../../include/core/parallel.h"
+#include "../../include/core/random.h"
+#include "../../include/core/topology.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+    // Token rows processed together by one gemm_packed call.
+    const int kRowBlock = 16;
+
+    const char *const kUnsupported = "los modelos con mezcla de tokens no se pueden compilar";
+
+    void normalize(const float *x, int n, float eps, float *out)
+    {
+        float mean = 0.0f;
+        for (int j = 0; j < n; j++)
+        {
+            mean += x[j];
+        }
+        mean /= n;
+        float var = 0.0f;
+        for (int j = 0; j < n; j++)
+        {
+            float diff = x[j] - mean;
+            var += diff * diff;
+        }
+        var /= n;
+        float inv_std = 1.0f / sqrt(var + eps);
+        for (int j = 0; j < n; j++)
+        {
+            out[j] = (x[j] - mean) * inv_std;
+        }
+    }
+
+    // Moves the CLS row and the patch rows flagged in keep to the front of x,
+    // preserving their order. Returns the new token count.
+    int compact_tokens(std::vector<float> &x, std::vector<float> &sizes, int tokens, int d, const std::vector<char> &keep)
+    {
+        int kept = 1;
+        for (int t = 1; t < tokens; t++)
+        {
+            if (!keep[t - 1])
+                continue;
+            if (kept != t)
+            {
+                std::copy(&x[static_cast<size_t>(t) * d], &x[static_cast<size_t>(t + 1) * d], &x[static_cast<size_t>(kept) * d]);
+                sizes[kept] = sizes[t];
+            }
+            kept++;
+        }
+        return kept;
+    }
+
+    int prune_tokens(std::vector<float> &x, std::vector<float> &sizes, int tokens, int d, int keep_count)
+    {
+        const int patches = tokens - 1;
+        std::vector<float> norm(patches, 0.0f);
+        for (int p = 0; p < patches; p++)
+        {
+            const float *row = &x[static_cast<size_t>(p + 1) * d];
+            for (int j = 0; j < d; j++)
+            {
+                norm[p] += row[j] * row[j];
+            }
+        }
+        std::vector<int> order(patches);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                         { return norm[a] > norm[b]; });
+        std::vector<char> keep(patches, 0);
+        for (int i = 0; i < keep_count; i++)
+        {
+            keep[order[i]] = 1;
+        }
+        return compact_tokens(x, sizes, tokens, d, keep);
+    }
+
+    int merge_tokens(std::vector<float> &x, std::vector<float> &sizes, int tokens, int d, int keep_count)
+    {
+        const int patches = tokens - 1;
+        // Patch p sits in set A when p is even, B when odd; only A rows merge.
+        const int num_a = (patches + 1) / 2, num_b = patches / 2;
+        const int merges = std::min(patches - keep_count, num_b > 0 ? num_a : 0);
+        if (merges <= 0)
+            return tokens;
+
+        std::vector<float> unit(static_cast<size_t>(patches) * d);
+        for (int p = 0; p < patches; p++)
+        {
+            const float *row = &x[static_cast<size_t>(p + 1) * d];
+            float norm = 0.0f;
+            for (int j = 0; j < d; j++)
+            {
+                norm += row[j] * row[j];
+            }
+            float inv = norm > 0.0f ? 1.0f / std::sqrt(norm) : 0.0f;
+            for (int j = 0; j < d; j++)
+            {
+                unit[static_cast<size_t>(p) * d + j] = row[j] * inv;
+            }
+        }
+
+        std::vector<int> best(num_a, 1);
+        std::vector<float> similarity(num_a, -2.0f);
+        for (int a = 0; a < num_a; a++)
+        {
+            const float *ua = &unit[static_cast<size_t>(2 * a) * d];
+            for (int b = 0; b < num_b; b++)
+            {
+                const float *ub = &unit[static_cast<size_t>(2 * b + 1) * d];
+                float dot = 0.0f;
+                for (int j = 0; j < d; j++)
+                {
+                    dot += ua[j] * ub[j];
+                }
+                if (dot > similarity[a])
+                {
+                    similarity[a] = dot;
+                    best[a] = 2 * b + 1;
+                }
+            }
+        }
+
+        std::vector<int> order(num_a);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                         { return similarity[a] > similarity[b]; });
+        std::vector<char> keep(patches, 1);
+        for (int i = 0; i < merges; i++)
+        {
+            const int src = 2 * order[i] + 1, dst = best[order[i]] + 1; // token rows
+            float *dst_row = &x[static_cast<size_t>(dst) * d];
+            const float *src_row = &x[static_cast<size_t>(src) * d];
+            const float total = sizes[dst] + sizes[src];
+            for (int j = 0; j < d; j++)
+            {
+                dst_row[j] = (dst_row[j] * sizes[dst] + src_row[j] * sizes[src]) / total;
+            }
+            sizes[dst] = total;
+            keep[src - 1] = 0;
+        }
+        return compact_tokens(x, sizes, tokens, d, keep);
+    }
+
+    // c = a * W^T (+ bias) for an op, through its low-rank factors when it
+    // has them; scratch holds the m x rank intermediate.
+    void op_gemm(const CompiledVisionTransformer::Op &op, const float *a, int m, int lda, const float *bias,
+                 float *c, int ldc, std::vector<float> &scratch)
+    {
+        if (op.factor.empty())
+        {
+            gemm_packed(a, m, lda, op.weight, bias, c, ldc, op.config);
+            return;
+        }
+        const int rank = op.factor.rows;
+        scratch.resize(static_cast<size_t>(m) * rank);
+        gemm_packed(a, m, lda, op.factor, nullptr, scratch.data(), rank, op.factor_config);
+        gemm_packed(scratch.data(), m, rank, op.weight, bias, c, ldc, op.config);
+    }
+
+    // Rows of the GEMMs an op's configs are tuned for: a full row block, or
+    // the single CLS row the heads see.
+    int gemm_rows(const CompiledVisionTransformer::Op &op, int num_patches)
+    {
+        typedef CompiledVisionTransformer::OpKind OpKind;
+        if (op.kind == OpKind::NormLinearExit || op.kind == OpKind::NormLinearHead)
+            return 1;
+        return std::min(kRowBlock, op.kind == OpKind::EmbedPatches ? num_patches : num_patches + 1);
+    }
+
+    // Folds a preceding LayerNorm's affine transform into a Linear:
+    // W * (gamma * n + beta) + b == (W diag(gamma)) * n + (W * beta + b).
+    // For W = U V the scaling lands on V's columns.
+    CompiledVisionTransformer::Op fold_norm_linear(CompiledVisionTransformer::OpKind kind,
+                                                   const LayerNorm &ln, const Linear &linear, WeightDType dtype)
+    {
+        CompiledVisionTransformer::Op op;
+        op.kind = kind;
+        op.in_features = linear.weight.cols;
+        op.out_features = linear.weight.rows;
+        op.bias.resize(op.out_features);
+        for (int o = 0; o < op.out_features; o++)
+        {
+            float b = linear.bias(o, 0);
+            for (int k = 0; k < op.in_features; k++)
+            {
+                b += linear.weight(o, k) * ln.beta(0, k);
+            }
+            op.bias[o] = b;
+        }
+
+        const Tensor &inner = linear.low_rank ? linear.low_rank->v : linear.weight;
+        Tensor scaled(inner.rows, inner.cols);
+        for (int r = 0; r < inner.rows; r++)
+        {
+            for (int k = 0; k < inner.cols; k++)
+            {
+                scaled(r, k) = inner(r, k) * ln.gamma(0, k);
+            }
+        }
+        if (linear.low_rank)
+        {
+            op.factor.pack(scaled, dtype);
+            op.weight.pack(linear.low_rank->u, dtype);
+        }
+        else
+        {
+            op.weight.pack(scaled, dtype);
+        }
+        return op;
+    }
+}
+
+bool CompiledVisionTransformer::supports(const VisionTransformer &model)
+{
+    return model.token_mixing_heads() == 0;
+}
+
+bool CompiledVisionTransformer::check_supported(const VisionTransformer &model)
+{
+    if (supports(model))
+        return true;
+    std::cerr << "Error: " << kUnsupported << "; use infer.out." << std::endl;
+    return false;
+}
+
+CompiledVisionTransformer CompiledVisionTransformer::compile(const VisionTransformer &model, WeightDType weight_dtype)
+{
+    if (!supports(model))
+        throw std::runtime_error(std::string("CompiledVisionTransformer: ") + kUnsupported);
+    CompiledVisionTransformer compiled;
+    compiled.image_size = model.image_size;
+    compiled.patch_size = model.patch_size;
+    compiled.d_model = model.d_model;
+    compiled.num_classes = model.num_classes;
+    compiled.num_patches = model.num_patches;
+    compiled.eps = model.final_ln.eps;
+    compiled.weight_dtype = weight_dtype;
+
+    // Patch extraction is a fixed gather; precompute its source offsets.
+    int patch_dim = model.patch_size * model.patch_size;
+    int patches_per_row = model.image_size / model.patch_size;
+    compiled.patch_gather.resize(static_cast<size_t>(model.num_patches) * patch_dim);
+    for (int p = 0; p < model.num_patches; p++)
+    {
+        int i = p / patches_per_row, j = p % patches_per_row;
+        for (int pi = 0; pi < model.patch_size; pi++)
+        {
+            for (int pj = 0; pj < model.patch_size; pj++)
+            {
+                int row = i * model.patch_size + pi, col = j * model.patch_size + pj;
+                compiled.patch_gather[static_cast<size_t>(p) * patch_dim + pi * model.patch_size + pj] = row * model.image_size + col;
+            }
+        }
+    }
+
+    compiled.cls_row.resize(model.d_model);
+    for (int j = 0; j < model.d_model; j++)
+    {
+        compiled.cls_row[j] = model.class_token(0, j) + model.position_embeddings(0, j);
+    }
+
+    Op embed;
+    embed.kind = OpKind::EmbedPatches;
+    embed.in_features = patch_dim;
+    embed.out_features = model.d_model;
+    embed.weight.pack(model.patch_embedding.weight, weight_dtype);
+    embed.bias.resize(static_cast<size_t>(model.num_patches) * model.d_model);
+    for (int p = 0; p < model.num_patches; p++)
+    {
+        for (int j = 0; j < model.d_model; j++)
+        {
+            embed.bias[static_cast<size_t>(p) * model.d_model + j] =
+                model.patch_embedding.bias(j, 0) + model.position_embeddings(p + 1, j);
+        }
+    }
+    compiled.ops.push_back(std::move(embed));
+
+    for (size_t l = 0; l < model.transformer_blocks.size(); l++)
+    {
+        const auto &block = model.transformer_blocks[l];
+        compiled.ops.push_back(fold_norm_linear(OpKind::NormLinearResidual, block->ln1, block->attention_proj, weight_dtype));
+        compiled.ops.push_back(fold_norm_linear(OpKind::NormLinearGelu, block->ln2, block->mlp.fc1, weight_dtype));
+
+        Op fc2;
+        fc2.kind = OpKind::LinearNormResidual;
+        fc2.in_features = block->mlp.fc2.weight.cols;
+        fc2.out_features = block->mlp.fc2.weight.rows;
+        if (block->mlp.fc2.low_rank)
+        {
+            fc2.factor.pack(block->mlp.fc2.low_rank->v, weight_dtype);
+            fc2.weight.pack(block->mlp.fc2.low_rank->u, weight_dtype);
+        }
+        else
+        {
+            fc2.weight.pack(block->mlp.fc2.weight, weight_dtype);
+        }
+        fc2.bias = block->mlp.fc2.bias.data.vector();
+        fc2.gamma = block->mlp.ln.gamma.data.vector();
+        fc2.beta = block->mlp.ln.beta.data.vector();
+        compiled.ops.push_back(std::move(fc2));
+
+        if (l < model.exit_heads.size())
+            compiled.ops.push_back(fold_norm_linear(OpKind::NormLinearExit, *model.exit_lns[l], *model.exit_heads[l], weight_dtype));
+    }
+
+    compiled.ops.push_back(fold_norm_linear(OpKind::NormLinearHead, model.final_ln, model.classification_head, weight_dtype));
+    compiled.resolve_gemm_configs();
+    return compiled;
+}
+
+void CompiledVisionTransformer::buffer_widths(int &hidden_dim, int &max_features) const
+{
+    hidden_dim = 0;
+    max_features = d_model;
+    for (const Op &op : ops)
+    {
+        if (op.kind == OpKind::NormLinearGelu)
+            hidden_dim = std::max(hidden_dim, op.out_features);
+        max_features = std::max({max_features, op.in_features, op.out_features});
+    }
+}
+
+CompiledVisionTransformer::ForwardState CompiledVisionTransformer::start_forward(const Tensor &image, const TokenReduction &reduction) const
+{
+    int hidden_dim, max_features;
+    buffer_widths(hidden_dim, max_features);
+    ForwardState state;
+    state.image = &image;
+    state.tokens = num_patches + 1;
+    state.x.resize(static_cast<size_t>(state.tokens) * d_model);
+    state.h.resize(static_cast<size_t>(state.tokens) * std::max(hidden_dim, 1));
+    state.sizes.assign(reduction.enabled() ? state.tokens : 0, 1.0f);
+    state.logits = Tensor(1, num_classes);
+    return state;
+}
+
+Tensor CompiledVisionTransformer::forward(const Tensor &image, const TokenReduction &reduction,
+                                         const ExitPolicy &exits, int *blocks_run) const
+{
+    ForwardState state = start_forward(image, reduction);
+    run_ops(state, 0, ops.size(), reduction, exits);
+    if (blocks_run != nullptr)
+        *blocks_run = state.blocks_run;
+    return state.logits;
+}
+
+void CompiledVisionTransformer::run_ops(ForwardState &state, int first, int last, const TokenReduction &reduction,
+                                        const ExitPolicy &exits) const
+{
+    if (state.exited)
+        return;
+    int hidden_dim, max_features;
+    buffer_widths(hidden_dim, max_features);
+    const int patch_dim = patch_size * patch_size;
+    const Tensor &image = *state.image;
+    std::vector<float> &x = state.x, &h = state.h, &sizes = state.sizes;
+    Tensor &logits = state.logits;
+    int &tokens = state.tokens, &block = state.block, &exit = state.exit;
+
+    std::vector<float> scratch;
+    for (int o = first; o < last; o++)
+    {
+        const Op &op = ops[o];
+        if (op.kind == OpKind::NormLinearResidual)
+        {
+            const int patches = tokens - 1;
+            const int keep = std::min(patches, std::max(1, static_cast<int>(std::lround(reduction.keep_ratio(block) * patches))));
+            if (reduction.enabled() && keep < patches)
+            {
+                tokens = reduction.mode == TokenReduction::Mode::Prune ? prune_tokens(x, sizes, tokens, d_model, keep)
+                                                                       : merge_tokens(x, sizes, tokens, d_model, keep);
+            }
+            block++;
+        }
+        if (op.kind == OpKind::NormLinearExit)
+        {
+            const float threshold = exits.threshold(exit++);
+            if (threshold > 1.0f)
+                continue;
+            std::vector<float> n(d_model);
+            normalize(x.data(), d_model, eps, n.data());
+            op_gemm(op, n.data(), 1, d_model, op.bias.data(), logits.data.data(), num_classes, scratch);
+            Tensor probs = Activation::softmax(logits);
+            if (*std::max_element(probs.data.begin(), probs.data.end()) >= threshold)
+            {
+                state.blocks_run = block;
+                state.exited = true;
+                return;
+            }
+            continue;
+        }
+        if (op.kind == OpKind::NormLinearHead)
+        {
+            // Only the CLS row reaches the classifier.
+            std::vector<float> n(d_model);
+            normalize(x.data(), d_model, eps, n.data());
+            op_gemm(op, n.data(), 1, d_model, op.bias.data(), logits.data.data(), num_classes, scratch);
+            state.blocks_run = block;
+            continue;
+        }
+
+        // patch_gather indexes a dense image, so views are made contiguous
+        // once before the row blocks read it.
+        const Tensor pixels = op.kind == OpKind::EmbedPatches ? image.contiguous() : Tensor();
+        const float *pixel_data = op.kind == OpKind::EmbedPatches ? pixels.values() : nullptr;
+        long cost = 2L * op.in_features * op.out_features;
+        Parallel::parallel_for(0, tokens, Parallel::grain_size(cost), [&](int begin, int end)
+                               {
+            std::vector<float> in(static_cast<size_t>(kRowBlock) * max_features);
+            std::vector<float> out(static_cast<size_t>(kRowBlock) * max_features);
+            std::vector<float> rank_scratch;
+            if (op.kind == OpKind::EmbedPatches && begin == 0)
+            {
+                std::copy(cls_row.begin(), cls_row.end(), x.begin());
+                begin = 1;
+            }
+            for (int t0 = begin; t0 < end; t0 += kRowBlock)
+            {
+                const int m = std::min(kRowBlock, end - t0);
+                float *x_rows = &x[static_cast<size_t>(t0) * d_model];
+                float *h_rows = &h[static_cast<size_t>(t0) * hidden_dim];
+                switch (op.kind)
+                {
+                case OpKind::EmbedPatches:
+                    for (int r = 0; r < m; r++)
+                    {
+                        const int *gather = &patch_gather[static_cast<size_t>(t0 + r - 1) * patch_dim];
+                        for (int k = 0; k < patch_dim; k++)
+                        {
+                            in[static_cast<size_t>(r) * patch_dim + k] = pixel_data[gather[k]];
+                        }
+                    }
+                    op_gemm(op, in.data(), m, patch_dim, nullptr, out.data(), d_model, rank_scratch);
+                    for (int r = 0; r < m; r++)
+                    {
+                        const float *row_bias = &op.bias[static_cast<size_t>(t0 + r - 1) * d_model];
+                        for (int j = 0; j < d_model; j++)
+                        {
+                            x_rows[static_cast<size_t>(r) * d_model + j] = out[static_cast<size_t>(r) * d_model + j] + row_bias[j];
+                        }
+                    }
+                    break;
+                case OpKind::NormLinearResidual:
+                    for (int r = 0; r < m; r++)
+                    {
+                        normalize(x_rows + static_cast<size_t>(r) * d_model, d_model, eps, &in[static_cast<size_t>(r) * d_model]);
+                    }
+                    op_gemm(op, in.data(), m, d_model, op.bias.data(), out.data(), d_model, rank_scratch);
+                    for (int i = 0; i < m * d_model; i++)
+                    {
+                        x_rows[i] += out[i];
+                    }
+                    break;
+                case OpKind::NormLinearGelu:
+                    for (int r = 0; r < m; r++)
+                    {
+                        normalize(x_rows + static_cast<size_t>(r) * d_model, d_model, eps, &in[static_cast<size_t>(r) * d_model]);
+                    }
+                    op_gemm(op, in.data(), m, d_model, op.bias.data(), h_rows, hidden_dim, rank_scratch);
+                    for (int i = 0; i < m * hidden_dim; i++)
+                    {
+                        h_rows[i] = Activation::gelu(h_rows[i]);
+                    }
+                    break;
+                case OpKind::LinearNormResidual:
+                    op_gemm(op, h_rows, m, hidden_dim, op.bias.data(), out.data(), d_model, rank_scratch);
+                    for (int r = 0; r < m; r++)
+                    {
+                        float *n = &in[static_cast<size_t>(r) * d_model];
+                        float *x_row = x_rows + static_cast<size_t>(r) * d_model;
+                        normalize(&out[static_cast<size_t>(r) * d_model], d_model, eps, n);
+                        for (int j = 0; j < d_model; j++)
+                        {
+                            x_row[j] += op.gamma[j] * n[j] + op.beta[j];
+                        }
+                    }
+                    break;
+                case OpKind::NormLinearExit:
+                case OpKind::NormLinearHead:
+                    break;
+                }
+            } });
+    }
+}
+
+size_t CompiledVisionTransformer::weight_bytes() const
+{
+    size_t bytes = 0;
+    for (const Op &op : ops)
+    {
+        if (op.kind != OpKind::NormLinearExit)
+            bytes += op.weight.bytes() + op.factor.bytes();
+    }
+    return bytes;
+}
+
+std::vector<GemmShape> CompiledVisionTransformer::gemm_shapes() const
+{
+    std::vector<GemmShape> shapes;
+    for (const Op &op : ops)
+    {
+        const int m = gemm_rows(op, num_patches);
+        if (!op.factor.empty())
+            shapes.push_back({m, op.factor.cols, op.factor.rows, op.factor.dtype, GemmSite::Compiled});
+        shapes.push_back({m, op.weight.cols, op.weight.rows, op.weight.dtype, GemmSite::Compiled});
+    }
+    std::sort(shapes.begin(), shapes.end());
+    shapes.erase(std::unique(shapes.begin(), shapes.end()), shapes.end());
+    return shapes;
+}
+
+void CompiledVisionTransformer::resolve_gemm_configs()
+{
+    for (Op &op : ops)
+    {
+        const int m = gemm_rows(op, num_patches);
+        op.config = GemmTuner::config(m, op.weight.cols, op.weight.rows, op.weight.dtype, GemmSite::Compiled);
+        op.factor_config = op.factor.empty() ? GemmConfig()
+                                             : GemmTuner::config(m, op.factor.cols, op.factor.rows, op.factor.dtype, GemmSite::Compiled);
+    }
+}
+
+int CompiledVisionTransformer::predict(const Tensor &image) const
+{
+    return Activation::argmax(forward(image));
+}
+
+float CompiledVisionTransformer::max_abs_diff(VisionTransformer &reference, int num_images) const
+{
+    float worst = 0.0f;
+    for (int n = 0; n < num_images; n++)
+    {
+        Tensor image(image_size, image_size);
+        Random::fill_uniform(image.data.data(), image.data.size());
+        Tensor expected = reference.forward(image);
+        Tensor actual = forward(image);
+        for (int j = 0; j < num_classes; j++)
+        {
+            worst = std::max(worst, std::fabs(expected(0, j) - actual(0, j)));
+        }
+    }
+    return worst;
+}
+
+std::string CompiledVisionTransformer::op_name(OpKind kind)
+{
+    switch (kind)
+    {
+    case OpKind::EmbedPatches:
+        return "EmbedPatches";
+    case OpKind::NormLinearResidual:
+        return "NormLinearResidual";
+    case OpKind::NormLinearGelu:
+        return "NormLinearGelu";
+    case OpKind::LinearNormResidual:
+        return "LinearNormResidual";
+    case OpKind::NormLinearExit:
+        return "NormLinearExit";
+    case OpKind::NormLinearHead:
+        return "NormLinearHead";
+    }
+    return "?";
+}
+
+ReplicatedModel::ReplicatedModel(const CompiledVisionTransformer &model)
+    : original(model)
+{
+    if (Topology::num_nodes() == 1)
+        return;
+    replicas.resize(Topology::num_nodes());
+    std::vector<std::thread> builders;
+    for (int node = 0; node < num_replicas(); node++)
+    {
+        builders.emplace_back([this, &model, node]
+                              {
+            Topology::pin_current_thread_to_node(node);
+            replicas[node] = model; });
+    }
+    for (std::thread &builder : builders)
+    {
+        builder.join();
+    }
+}
+
+const CompiledVisionTransformer &ReplicatedModel::local() const
+{
+    if (replicas.empty())
+        return original;
+    return replicas[std::min(Topology::current_node(), num_replicas() - 1)];
+}
@@ -1,8 +1,13 @@
 #include "../../include/model/encoder.h"
 #include <iostream>
+#include <utility>
 
-TransformerBlock::TransformerBlock(int d_model)
-    : attention_proj(d_model, d_model), mlp(d_model, d_model * 2),
+TransformerBlock::TransformerBlock(int d_model) : TransformerBlock(d_model, d_model * 2)
+{
+}
+
+TransformerBlock::TransformerBlock(int d_model, int hidden_dim)
+    : attention_proj(d_model, d_model), mlp(d_model, hidden_dim),
       ln1(d_model), ln2(d_model)
 {
 }
@@ -10,37 +15,46 @@ TransformerBlock::TransformerBlock(int d_model)
 Tensor TransformerBlock::forward(const Tensor &input)
 {
     last_input = input;
+    return forward_cached_input();
+}
 
-    last_normalized1 = ln1.forward(input);
-    Tensor attn_out = attention_proj.forward(last_normalized1);
+Tensor TransformerBlock::forward(Tensor &&input)
+{
+    last_input = std::move(input);
+    return forward_cached_input();
+}
+
+// The activations kept for backward share their buffers with the tensors
+// the sublayers cache, so nothing here is copied.
+Tensor TransformerBlock::forward_cached_input()
+{
+    last_normalized1 = ln1.forward(last_input);
+    Tensor attn_out = token_mixer ? attention_proj.forward(token_mixer->forward(last_normalized1))
+                                  : attention_proj.forward(last_normalized1);
     last_attn_out = attn_out;
 
-    last_residual1 = input + attn_out;
+    last_residual1 = last_input + attn_out;
 
     last_normalized2 = ln2.forward(last_residual1);
     Tensor mlp_out = mlp.forward(last_normalized2);
+    mlp_out += last_residual1;
 
-    return last_residual1 + mlp_out;
+    return mlp_out;
 }
 
-Tensor TransformerBlock::backward(const Tensor &grad_output)
+Tensor TransformerBlock::backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks)
 {
-
-    Tensor grad_residual1_from_mlp = grad_output;
-    Tensor grad_mlp_out = grad_output;
-
-    Tensor grad_normalized2 = mlp.backward(grad_mlp_out);
-    Tensor grad_residual1_from_ln2 = ln2.backward(grad_normalized2);
-
-    Tensor grad_residual1 = grad_residual1_from_mlp + grad_residual1_from_ln2;
-
-    Tensor grad_input_from_attn = grad_residual1;
-    Tensor grad_input_direct = grad_residual1;
-
-    Tensor grad_normalized1 = attention_proj.backward(grad_input_from_attn);
-    Tensor grad_input_from_ln1 = ln1.backward(grad_normalized1);
-
-    Tensor grad_input = grad_input_direct + grad_input_from_ln1;
+    // Both residual branches receive grad_output unchanged, so the skip
+    // gradients are accumulated in place instead of copied.
+    Tensor grad_normalized2 = mlp.backward(grad_output, weight_grad_tasks);
+    Tensor grad_residual1 = ln2.backward(std::move(grad_normalized2));
+    grad_residual1 += grad_output;
+
+    Tensor grad_normalized1 = attention_proj.backward(grad_residual1, weight_grad_tasks);
+    if (token_mixer)
+        grad_normalized1 = token_mixer->backward(grad_normalized1, weight_grad_tasks);
+    Tensor grad_input = ln1.backward(std::move(grad_normalized1));
+    grad_input += grad_residual1;
 
     return grad_input;
 }
@@ -48,6 +62,8 @@ Tensor TransformerBlock::backward(const Tensor &grad_output)
 void TransformerBlock::update(float lr)
 {
     attention_proj.update(lr);
+    if (token_mixer)
+        token_mixer->update(lr);
     mlp.update(lr);
     ln1.update(lr);
     ln2.update(lr);
@@ -56,7 +72,14 @@ void TransformerBlock::update(float lr)
 void TransformerBlock::zero_grad()
 {
     attention_proj.zero_grad();
+    if (token_mixer)
+        token_mixer->zero_grad();
     mlp.zero_grad();
     ln1.zero_grad();
     ln2.zero_grad();
 }
+
+void TransformerBlock::enable_token_mixing(int num_heads)
+{
+    token_mixer = std::make_unique<LinearAttention>(ln1.d_model, num_heads);
+}
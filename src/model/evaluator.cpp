@@ -0,0 +1,167 @@
+#include "../../include/model/evaluator.h"
+#include "../../include/core/random.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // Mean loss and accuracy of model over a labelled set.
+    std::pair<float, float> score(VisionTransformer &model, const std::vector<Tensor> &images, const std::vector<int> &labels)
+    {
+        if (images.empty())
+            return {0.0f, 0.0f};
+        float loss = 0.0f;
+        int correct = 0;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            StepResult step = model.eval_step(images[i], labels[i]);
+            loss += step.loss;
+            if (step.prediction == labels[i])
+                correct++;
+        }
+        return {loss / images.size(), (float)correct / images.size()};
+    }
+
+    VisionTransformer mirror(VisionTransformer &architecture)
+    {
+        // Building a model draws its initial weights; keep the caller's
+        // random sequence exactly where it was.
+        std::string rng = Random::state();
+        VisionTransformer copy(architecture.image_size, architecture.patch_size, architecture.d_model,
+                               architecture.num_layers, architecture.num_classes);
+        copy.enable_token_mixing(architecture.token_mixing_heads());
+        Random::set_state(rng);
+        if (architecture.has_exit_heads())
+            copy.enable_exit_heads();
+        return copy;
+    }
+}
+
+BackgroundEvaluator::BackgroundEvaluator(VisionTransformer &architecture,
+                                         const std::vector<Tensor> &val_imgs, const std::vector<int> &val_lbls,
+                                         const std::vector<Tensor> &test_imgs, const std::vector<int> &test_lbls)
+    : val_images(val_imgs), test_images(test_imgs), val_labels(val_lbls), test_labels(test_lbls),
+      model(mirror(architecture))
+{
+    auto ours = model.named_parameters();
+    auto theirs = architecture.named_parameters();
+    if (ours.size() != theirs.size())
+        throw std::runtime_error("BackgroundEvaluator: arquitectura no soportada");
+    for (size_t i = 0; i < ours.size(); i++)
+    {
+        if (ours[i].second->rows != theirs[i].second->rows || ours[i].second->cols != theirs[i].second->cols)
+            throw std::runtime_error("BackgroundEvaluator: forma distinta en " + theirs[i].first);
+    }
+    model.set_training(false);
+    worker = std::thread(&BackgroundEvaluator::run, this);
+}
+
+BackgroundEvaluator::~BackgroundEvaluator()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void BackgroundEvaluator::submit(VisionTransformer &source, int epoch, long step, bool end_of_epoch)
+{
+    std::vector<Tensor> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spare.empty())
+        {
+            buffer = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    // The copy happens outside the lock and here, on the caller's thread.
+    // Assigning the tensor would only share its storage and leave the real
+    // copy to the next weight update; a recycled buffer already has the right
+    // sizes, so this is a plain memcpy per tensor.
+    auto params = source.named_parameters();
+    buffer.resize(params.size());
+    for (size_t i = 0; i < params.size(); i++)
+    {
+        const Tensor weights = params[i].second->contiguous();
+        Tensor &copy = buffer[i];
+        if (copy.shape() != weights.shape() || !copy.is_contiguous() || copy.data.size() != weights.numel())
+            copy = Tensor(weights.shape());
+        std::copy(weights.values(), weights.values() + weights.numel(), copy.values());
+    }
+
+    Job job;
+    job.result.epoch = epoch;
+    job.result.step = step;
+    job.result.end_of_epoch = end_of_epoch;
+    job.parameters = std::move(buffer);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(job));
+    }
+    cv.notify_all();
+}
+
+std::vector<EvalResult> BackgroundEvaluator::poll()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<EvalResult> results;
+    results.swap(finished);
+    return results;
+}
+
+void BackgroundEvaluator::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]
+            { return pending.empty() && !busy; });
+}
+
+EvalResult BackgroundEvaluator::evaluate(VisionTransformer &model,
+                                         const std::vector<Tensor> &val_images, const std::vector<int> &val_labels,
+                                         const std::vector<Tensor> &test_images, const std::vector<int> &test_labels)
+{
+    EvalResult result;
+    auto start = std::chrono::steady_clock::now();
+    std::tie(result.val_loss, result.val_acc) = score(model, val_images, val_labels);
+    std::tie(result.test_loss, result.test_acc) = score(model, test_images, test_labels);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void BackgroundEvaluator::run()
+{
+    auto params = model.named_parameters();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cv.wait(lock, [this]
+                { return !pending.empty() || stopping; });
+        if (pending.empty())
+            return;
+        Job job = std::move(pending.front());
+        pending.pop_front();
+        busy = true;
+        lock.unlock();
+
+        // Swap the snapshot in; the model's old storage becomes the spare.
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            std::swap(params[i].second->data, job.parameters[i].data);
+        }
+        EvalResult result = evaluate(model, val_images, val_labels, test_images, test_labels);
+        result.epoch = job.result.epoch;
+        result.step = job.result.step;
+        result.end_of_epoch = job.result.end_of_epoch;
+
+        lock.lock();
+        finished.push_back(result);
+        spare.push_back(std::move(job.parameters));
+        busy = false;
+        cv.notify_all();
+    }
+}
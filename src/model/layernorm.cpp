@@ -1,4 +1,6 @@
 #include "../../include/model/layernorm.h"
+#include "../../include/core/parallel.h"
+#include <utility>
 
 LayerNorm::LayerNorm(int d_mod) : d_model(d_mod), eps(1e-5f),
                                   gamma(1, d_mod), beta(1, d_mod),
@@ -14,34 +16,49 @@ LayerNorm::LayerNorm(int d_mod) : d_model(d_mod), eps(1e-5f),
 Tensor LayerNorm::forward(const Tensor &input)
 {
     last_input = input;
+    return normalize(last_input);
+}
+
+Tensor LayerNorm::forward(Tensor &&input)
+{
+    last_input = std::move(input);
+    return normalize(last_input);
+}
+
+Tensor LayerNorm::normalize(const Tensor &input)
+{
     last_mean = Tensor(input.rows, 1);
     last_var = Tensor(input.rows, 1);
-    Tensor result(input.rows, input.cols);
-    for (int i = 0; i < input.rows; i++)
-    {
-        float mean = 0.0f;
-        for (int j = 0; j < input.cols; j++)
+    Tensor result = Tensor::zeros_like(input);
+    const float *g = std::as_const(gamma).data.data(), *b = std::as_const(beta).data.data();
+    float *means = last_mean.data.data(), *vars = last_var.data.data(), *out = result.data.data();
+    Parallel::parallel_for(0, input.rows, Parallel::grain_size(8L * input.cols), [&](int begin, int end)
+                           {
+        for (int i = begin; i < end; i++)
         {
-            mean += input(i, j);
-        }
-        mean /= input.cols;
-        last_mean(i, 0) = mean;
+            float mean = 0.0f;
+            for (int j = 0; j < input.cols; j++)
+            {
+                mean += input(i, j);
+            }
+            mean /= input.cols;
+            means[i] = mean;
 
-        float var = 0.0f;
-        for (int j = 0; j < input.cols; j++)
-        {
-            float diff = input(i, j) - mean;
-            var += diff * diff;
-        }
-        var /= input.cols;
-        last_var(i, 0) = var;
+            float var = 0.0f;
+            for (int j = 0; j < input.cols; j++)
+            {
+                float diff = input(i, j) - mean;
+                var += diff * diff;
+            }
+            var /= input.cols;
+            vars[i] = var;
 
-        for (int j = 0; j < input.cols; j++)
-        {
-            float normalized = (input(i, j) - mean) / sqrt(var + eps);
-            result(i, j) = gamma(0, j) * normalized + beta(0, j);
-        }
-    }
+            for (int j = 0; j < input.cols; j++)
+            {
+                float normalized = (input(i, j) - mean) / sqrt(var + eps);
+                out[static_cast<size_t>(i) * input.cols + j] = g[j] * normalized + b[j];
+            }
+        } });
     return result;
 }
 
@@ -50,6 +67,11 @@ Tensor LayerNorm::backward(const Tensor &grad_output)
     return grad_output; // Simplified passthrough
 }
 
+Tensor LayerNorm::backward(Tensor &&grad_output)
+{
+    return std::move(grad_output);
+}
+
 void LayerNorm::update(float lr)
 {
     zero_grad();
@@ -1,4 +1,8 @@
 #include "../../include/model/linear.h"
+#include "../../include/core/gemm_tuner.h"
+#include "../../include/core/parallel.h"
+#include "../../include/core/task_scheduler.h"
+#include <utility>
 
 Linear::Linear(int in_features, int out_features) : weight(out_features, in_features),
                                                     bias(out_features, 1),
@@ -16,39 +20,132 @@ Tensor Linear::forward(const Tensor &input)
     {
         last_input = input;
     }
-    Tensor result = weight * input.transpose();
-    for (int i = 0; i < result.rows; i++)
-    {
-        for (int j = 0; j < result.cols; j++)
-        {
-            result(i, j) += bias(i, 0);
-        }
-    }
-    return result.transpose();
+    return apply(input);
 }
 
-Tensor Linear::backward(const Tensor &grad_output)
+Tensor Linear::forward(Tensor &&input)
 {
-    Tensor grad_w = grad_output.transpose() * last_input;
-    weight_grad = weight_grad + grad_w;
+    if (!training)
+        return apply(input);
+    last_input = std::move(input);
+    return apply(last_input);
+}
 
-    for (int i = 0; i < grad_output.cols; i++)
+Tensor Linear::apply(const Tensor &input) const
+{
+    if (!training && low_rank)
+        return low_rank->forward(input, bias);
+    const int in_features = weight.cols, out_features = weight.rows;
+    Tensor result = Tensor::zeros_like(input, out_features);
+    const float *x_data = input.values(), *w_data = weight.data.data(), *b_data = bias.data.data();
+    float *y_data = result.data.data();
+    if (!training && !packed_weight.empty())
     {
-        for (int j = 0; j < grad_output.rows; j++)
+        // One lookup for the whole input: every chunk runs the config tuned
+        // for input.rows, whatever its own row count.
+        const GemmConfig config = GemmTuner::config(input.rows, in_features, out_features, packed_weight.dtype, GemmSite::Linear);
+        const int grain = GemmTuner::grain(config, input.rows, Parallel::grain_size(2L * in_features * out_features));
+        Parallel::parallel_for(0, input.rows, grain, [&](int begin, int end)
+                               { gemm_packed(x_data + static_cast<size_t>(begin) * in_features, end - begin, in_features,
+                                             packed_weight, b_data,
+                                             y_data + static_cast<size_t>(begin) * out_features, out_features, config); });
+        return result;
+    }
+
+    // result = input * weight^T + bias, computed as row-by-row dot products
+    // so both operands are read contiguously and no transposes are built.
+    Parallel::parallel_for(0, input.rows, Parallel::grain_size(2L * in_features * out_features), [&](int begin, int end)
+                           {
+        for (int n = begin; n < end; n++)
         {
-            bias_grad(i, 0) += grad_output(j, i);
-        }
+            const float *x = x_data + static_cast<size_t>(n) * in_features;
+            for (int o = 0; o < out_features; o++)
+            {
+                const float *w = w_data + static_cast<size_t>(o) * in_features;
+                float sum = 0.0f;
+                for (int k = 0; k < in_features; k++)
+                {
+                    sum += w[k] * x[k];
+                }
+                y_data[static_cast<size_t>(n) * out_features + o] = sum + b_data[o];
+            }
+        } });
+    return result;
+}
+
+Tensor Linear::backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks)
+{
+    if (weight_grad_tasks != nullptr)
+    {
+        weight_grad_tasks->run([this, grad_output]
+                               { accumulate_grads(grad_output); });
+    }
+    else
+    {
+        accumulate_grads(grad_output);
     }
     return grad_output * weight;
 }
 
+void Linear::accumulate_grads(const Tensor &grad_output)
+{
+    // weight_grad += grad_output^T * last_input, one output row per task.
+    // Pointers are taken up front: the workers must not be the ones to
+    // unshare a gradient buffer.
+    const int in_features = weight.cols, out_features = weight.rows;
+    const int samples = grad_output.rows;
+    const float *x_data = std::as_const(last_input).values(), *g_data = grad_output.values();
+    float *w_grad_data = weight_grad.data.data(), *b_grad_data = bias_grad.data.data();
+    Parallel::parallel_for(0, out_features, Parallel::grain_size(2L * samples * in_features), [&](int begin, int end)
+                           {
+        std::vector<float> row(in_features);
+        for (int o = begin; o < end; o++)
+        {
+            std::fill(row.begin(), row.end(), 0.0f);
+            for (int n = 0; n < samples; n++)
+            {
+                float g = g_data[static_cast<size_t>(n) * out_features + o];
+                const float *x = x_data + static_cast<size_t>(n) * in_features;
+                for (int k = 0; k < in_features; k++)
+                {
+                    row[k] += g * x[k];
+                }
+                b_grad_data[o] += g;
+            }
+            float *w_grad = w_grad_data + static_cast<size_t>(o) * in_features;
+            for (int k = 0; k < in_features; k++)
+            {
+                w_grad[k] += row[k];
+            }
+        } });
+}
+
+void Linear::prepack(WeightDType dtype)
+{
+    if (low_rank)
+        low_rank->prepack(dtype);
+    else
+        packed_weight.pack(weight, dtype);
+}
+
+void Linear::factorize(int rank)
+{
+    low_rank = std::make_shared<LowRankLinear>(LowRankLinear::decompose(weight, rank));
+    weight = low_rank->reconstruct();
+    packed_weight.clear();
+    low_rank->prepack();
+}
+
 void Linear::update(float lr)
 {
+    packed_weight.clear();
+    low_rank.reset();
     float max_grad = 1.0f;
+    float *w = weight.data.data(), *w_grad = weight_grad.data.data();
     for (int i = 0; i < weight.rows * weight.cols; i++)
     {
-        weight_grad.data[i] = std::max(-max_grad, std::min(max_grad, weight_grad.data[i]));
-        weight.data[i] -= lr * weight_grad.data[i];
+        w_grad[i] = std::max(-max_grad, std::min(max_grad, w_grad[i]));
+        w[i] -= lr * w_grad[i];
     }
     for (int i = 0; i < bias.rows; i++)
     {
@@ -0,0 +1,200 @@
+#include "../../include/model/linear_attention.h"
+#include "../../include/core/activation.h"
+#include "../../include/core/parallel.h"
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    // phi(x) = elu(x) + 1 keeps every feature positive, so the normaliser
+    // phi(q) . z never vanishes. Its derivative is 1 above zero and phi(x)
+    // below.
+    float feature_map(float x)
+    {
+        return x > 0.0f ? x + 1.0f : std::exp(x);
+    }
+
+    float feature_map_slope(float x, float phi)
+    {
+        return x > 0.0f ? 1.0f : phi;
+    }
+}
+
+LinearAttention::LinearAttention(int d_model, int heads)
+    : q_proj(d_model, d_model), k_proj(d_model, d_model), v_proj(d_model, d_model), num_heads(heads)
+{
+    assert(heads > 0 && d_model % heads == 0);
+}
+
+Tensor LinearAttention::forward(const Tensor &input)
+{
+    last_q = q_proj.forward(input);
+    last_k = k_proj.forward(input);
+    last_v = v_proj.forward(input);
+    last_phi_q = Activation::apply(last_q, feature_map);
+    last_phi_k = Activation::apply(last_k, feature_map);
+
+    // Leading axes are independent samples: each one attends over its own
+    // N = dim(-2) tokens, with its own S and z.
+    const int tokens = input.dim(-2), rows = input.rows, samples = rows / tokens;
+    const int d = last_q.cols, heads = num_heads, hd = d / heads;
+    // S for every sample and head at once: [samples, heads, hd, N] x
+    // [samples, heads, N, hd], summed in token order.
+    last_state = Tensor::matmul(last_phi_k.reshape({samples, tokens, heads, hd}).permute({0, 2, 3, 1}),
+                                last_v.reshape({samples, tokens, heads, hd}).permute({0, 2, 1, 3}));
+    last_norm.assign(static_cast<size_t>(samples) * d, 0.0f);
+    last_denominator.assign(static_cast<size_t>(rows) * heads, 0.0f);
+    const float *phi_q = last_phi_q.values(), *phi_k = last_phi_k.values(), *state = last_state.values();
+    float *norm = last_norm.data(), *denominator = last_denominator.data();
+
+    for (int r = 0; r < rows; r++)
+    {
+        float *z = norm + static_cast<size_t>(r / tokens) * d;
+        for (int i = 0; i < d; i++)
+            z[i] += phi_k[static_cast<size_t>(r) * d + i];
+    }
+
+    last_output = Tensor::zeros_like(last_q);
+    float *out = last_output.values();
+    Parallel::parallel_for(0, rows, Parallel::grain_size(2L * d * hd), [&](int begin, int end)
+                           {
+        for (int t = begin; t < end; t++)
+        {
+            const int sample = t / tokens;
+            for (int h = 0; h < heads; h++)
+            {
+                const float *q_row = phi_q + static_cast<size_t>(t) * d + h * hd;
+                const float *s = state + (static_cast<size_t>(sample) * heads + h) * hd * hd;
+                const float *z = norm + static_cast<size_t>(sample) * d + h * hd;
+                float *o = out + static_cast<size_t>(t) * d + h * hd;
+                float den = 0.0f;
+                for (int a = 0; a < hd; a++)
+                {
+                    den += q_row[a] * z[a];
+                    const float *s_row = s + static_cast<size_t>(a) * hd;
+                    for (int b = 0; b < hd; b++)
+                        o[b] += q_row[a] * s_row[b];
+                }
+                for (int b = 0; b < hd; b++)
+                    o[b] /= den;
+                denominator[static_cast<size_t>(t) * heads + h] = den;
+            }
+        } });
+    return last_output;
+}
+
+Tensor LinearAttention::backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks)
+{
+    const int tokens = last_output.dim(-2), rows = grad_output.rows, samples = rows / tokens;
+    const int d = grad_output.cols, heads = num_heads, hd = d / heads;
+    const float *g = grad_output.values(), *out = last_output.values();
+    const float *q = last_q.values(), *k = last_k.values(), *v = last_v.values();
+    const float *phi_q = last_phi_q.values(), *phi_k = last_phi_k.values();
+    const float *state = last_state.values(), *norm = last_norm.data(), *denominator = last_denominator.data();
+
+    // With out_i = num_i / den_i: d num_i = g_i / den_i and
+    // d den_i = -(g_i . out_i) / den_i. First the per-head reductions
+    // dS = sum_i phi(q_i)^T d num_i and dz = sum_i d den_i phi(q_i), one
+    // per sample and head.
+    std::vector<float> grad_state(static_cast<size_t>(samples) * heads * hd * hd, 0.0f),
+        grad_norm(static_cast<size_t>(samples) * d, 0.0f);
+    float *ds_all = grad_state.data(), *dz_all = grad_norm.data();
+    Parallel::parallel_for(0, samples * heads, Parallel::grain_size(2L * tokens * hd * hd), [&](int begin, int end)
+                           {
+        for (int sh = begin; sh < end; sh++)
+        {
+            const int h = sh % heads;
+            float *ds = ds_all + static_cast<size_t>(sh) * hd * hd;
+            float *dz = dz_all + static_cast<size_t>(sh) * hd;
+            for (int t = sh / heads * tokens, last = t + tokens; t < last; t++)
+            {
+                const size_t row = static_cast<size_t>(t) * d + h * hd;
+                const float den = denominator[static_cast<size_t>(t) * heads + h];
+                float g_dot_out = 0.0f;
+                for (int b = 0; b < hd; b++)
+                    g_dot_out += g[row + b] * out[row + b];
+                const float d_den = -g_dot_out / den;
+                for (int a = 0; a < hd; a++)
+                {
+                    const float qa = phi_q[row + a];
+                    dz[a] += d_den * qa;
+                    float *ds_row = ds + static_cast<size_t>(a) * hd;
+                    for (int b = 0; b < hd; b++)
+                        ds_row[b] += qa * g[row + b] / den;
+                }
+            }
+        } });
+
+    // Then, row by row: d phi(q_i) = d num_i S^T + d den_i z,
+    // d phi(k_n) = v_n dS^T + dz and d v_n = phi(k_n) dS.
+    Tensor grad_q = Tensor::zeros_like(last_q), grad_k = Tensor::zeros_like(last_k), grad_v = Tensor::zeros_like(last_v);
+    float *gq = grad_q.values(), *gk = grad_k.values(), *gv = grad_v.values();
+    Parallel::parallel_for(0, rows, Parallel::grain_size(6L * d * hd), [&](int begin, int end)
+                           {
+        for (int t = begin; t < end; t++)
+        {
+            const int sample = t / tokens;
+            for (int h = 0; h < heads; h++)
+            {
+                const size_t row = static_cast<size_t>(t) * d + h * hd;
+                const size_t sh = static_cast<size_t>(sample) * heads + h;
+                const float *s = state + sh * hd * hd;
+                const float *z = norm + sh * hd;
+                const float *ds = ds_all + sh * hd * hd;
+                const float *dz = dz_all + sh * hd;
+                const float den = denominator[static_cast<size_t>(t) * heads + h];
+                float g_dot_out = 0.0f;
+                for (int b = 0; b < hd; b++)
+                    g_dot_out += g[row + b] * out[row + b];
+                const float d_den = -g_dot_out / den;
+                for (int a = 0; a < hd; a++)
+                {
+                    const float *s_row = s + static_cast<size_t>(a) * hd;
+                    const float *ds_row = ds + static_cast<size_t>(a) * hd;
+                    float d_phi_q = d_den * z[a], d_phi_k = dz[a];
+                    for (int b = 0; b < hd; b++)
+                    {
+                        d_phi_q += g[row + b] / den * s_row[b];
+                        d_phi_k += v[row + b] * ds_row[b];
+                        gv[row + b] += phi_k[row + a] * ds_row[b];
+                    }
+                    gq[row + a] = d_phi_q * feature_map_slope(q[row + a], phi_q[row + a]);
+                    gk[row + a] = d_phi_k * feature_map_slope(k[row + a], phi_k[row + a]);
+                }
+            }
+        } });
+
+    Tensor grad_input = q_proj.backward(grad_q, weight_grad_tasks);
+    grad_input += k_proj.backward(grad_k, weight_grad_tasks);
+    grad_input += v_proj.backward(grad_v, weight_grad_tasks);
+    // Linear's backward folds the leading axes into rows; give them back.
+    return grad_input.reshape(last_output.shape());
+}
+
+void LinearAttention::update(float lr)
+{
+    q_proj.update(lr);
+    k_proj.update(lr);
+    v_proj.update(lr);
+}
+
+void LinearAttention::zero_grad()
+{
+    q_proj.zero_grad();
+    k_proj.zero_grad();
+    v_proj.zero_grad();
+}
+
+void LinearAttention::set_training(bool training)
+{
+    q_proj.training = training;
+    k_proj.training = training;
+    v_proj.training = training;
+}
+
+size_t LinearAttention::activation_bytes() const
+{
+    size_t floats = last_q.numel() + last_k.numel() + last_v.numel() + last_phi_q.numel() + last_phi_k.numel() +
+                    last_output.numel() + last_state.numel() + last_norm.size() + last_denominator.size();
+    return floats * sizeof(float);
+}
@@ -0,0 +1,84 @@
+#include "../../include/model/low_rank_linear.h"
+#include "../../include/core/gemm_tuner.h"
+#include "../../include/core/parallel.h"
+#include "../../include/core/svd.h"
+#include <algorithm>
+
+LowRankLinear::LowRankLinear(const Tensor &u_factor, const Tensor &v_factor) : u(u_factor), v(v_factor)
+{
+}
+
+LowRankLinear LowRankLinear::decompose(const Tensor &weight, int rank)
+{
+    Tensor left, right;
+    std::vector<float> sigma;
+    svd(weight, left, sigma, right);
+    rank = std::max(1, std::min(rank, static_cast<int>(sigma.size())));
+
+    Tensor u_factor(weight.rows, rank), v_factor(rank, weight.cols);
+    for (int r = 0; r < rank; r++)
+    {
+        for (int o = 0; o < weight.rows; o++)
+        {
+            u_factor(o, r) = left(o, r) * sigma[r];
+        }
+        for (int k = 0; k < weight.cols; k++)
+        {
+            v_factor(r, k) = right(k, r);
+        }
+    }
+    return LowRankLinear(u_factor, v_factor);
+}
+
+int LowRankLinear::rank_for_energy(const Tensor &weight, float energy)
+{
+    Tensor left, right;
+    std::vector<float> sigma;
+    svd(weight, left, sigma, right);
+
+    double total = 0.0;
+    for (float value : sigma)
+    {
+        total += static_cast<double>(value) * value;
+    }
+    double kept = 0.0;
+    for (size_t r = 0; r < sigma.size(); r++)
+    {
+        kept += static_cast<double>(sigma[r]) * sigma[r];
+        if (kept >= energy * total)
+            return static_cast<int>(r) + 1;
+    }
+    return static_cast<int>(sigma.size());
+}
+
+Tensor LowRankLinear::reconstruct() const
+{
+    return u * v;
+}
+
+void LowRankLinear::prepack(WeightDType dtype)
+{
+    packed_u.pack(u, dtype);
+    packed_v.pack(v, dtype);
+}
+
+Tensor LowRankLinear::forward(const Tensor &input, const Tensor &bias) const
+{
+    const int in_features = v.cols, out_features = u.rows, r = rank();
+    Tensor result = Tensor::zeros_like(input, out_features);
+    const float *x_data = input.values(), *b_data = bias.data.data();
+    float *y_data = result.data.data();
+    // Tuned like the two Linear shapes it replaces; the row split follows
+    // the x * V^T product.
+    const GemmConfig v_config = GemmTuner::config(input.rows, in_features, r, packed_v.dtype, GemmSite::Linear);
+    const GemmConfig u_config = GemmTuner::config(input.rows, r, out_features, packed_u.dtype, GemmSite::Linear);
+    const int grain = GemmTuner::grain(v_config, input.rows, Parallel::grain_size(2L * r * (in_features + out_features)));
+    Parallel::parallel_for(0, input.rows, grain, [&](int begin, int end)
+                           {
+        std::vector<float> projected(static_cast<size_t>(end - begin) * r);
+        gemm_packed(x_data + static_cast<size_t>(begin) * in_features, end - begin, in_features,
+                    packed_v, nullptr, projected.data(), r, v_config);
+        gemm_packed(projected.data(), end - begin, r, packed_u, b_data,
+                    y_data + static_cast<size_t>(begin) * out_features, out_features, u_config); });
+    return result;
+}
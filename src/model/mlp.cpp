@@ -1,6 +1,7 @@
 #include "../../include/model/mlp.h"
 #include "../../include/core/activation.h"
 #include <iostream>
+#include <utility>
 
 MLP::MLP(int d_model, int hidden_dim)
     : fc1(d_model, hidden_dim), fc2(hidden_dim, d_model),
@@ -13,13 +14,13 @@ Tensor MLP::forward(const Tensor &input)
     last_hidden = fc1.forward(input);
     last_activated = Activation::apply(last_hidden, Activation::gelu);
     Tensor output = fc2.forward(last_activated);
-    return ln.forward(output);
+    return ln.forward(std::move(output));
 }
 
-Tensor MLP::backward(const Tensor &grad_output)
+Tensor MLP::backward(const Tensor &grad_output, TaskGroup *weight_grad_tasks)
 {
     Tensor grad_ln = ln.backward(grad_output);
-    Tensor grad_fc2 = fc2.backward(grad_ln);
+    Tensor grad_fc2 = fc2.backward(grad_ln, weight_grad_tasks);
 
     Tensor grad_gelu_input(grad_fc2.rows, grad_fc2.cols);
     for (int i = 0; i < grad_fc2.rows; i++)
@@ -31,7 +32,7 @@ Tensor MLP::backward(const Tensor &grad_output)
             grad_gelu_input(i, j) = grad_fc2(i, j) * gelu_grad;
         }
     }
-    return fc1.backward(grad_gelu_input);
+    return fc1.backward(grad_gelu_input, weight_grad_tasks);
 }
 
 void MLP::update(float lr)
@@ -41,6 +42,27 @@ void MLP::update(float lr)
     ln.update(lr);
 }
 
+void MLP::prune_hidden(const std::vector<int> &keep)
+{
+    const int d_model = fc1.weight.cols;
+    const int hidden_dim = static_cast<int>(keep.size());
+    Linear pruned_fc1(d_model, hidden_dim), pruned_fc2(hidden_dim, d_model);
+    for (int i = 0; i < hidden_dim; i++)
+    {
+        for (int k = 0; k < d_model; k++)
+        {
+            pruned_fc1.weight(i, k) = fc1.weight(keep[i], k);
+            pruned_fc2.weight(k, i) = fc2.weight(k, keep[i]);
+        }
+        pruned_fc1.bias(i, 0) = fc1.bias(keep[i], 0);
+    }
+    pruned_fc2.bias = fc2.bias;
+    pruned_fc1.training = fc1.training;
+    pruned_fc2.training = fc2.training;
+    fc1 = pruned_fc1;
+    fc2 = pruned_fc2;
+}
+
 void MLP::zero_grad()
 {
     fc1.zero_grad();
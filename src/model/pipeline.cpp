@@ -0,0 +1,319 @@
+#include "../../include/model/pipeline.h"
+#include "../../include/core/parallel.h"
+#include "../../include/core/spsc_ring.h"
+#include "../../include/core/topology.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    struct MicroBatch
+    {
+        int first = -1; // index of the first image; -1 ends the stream
+        std::vector<CompiledVisionTransformer::ForwardState> states;
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Stage s is pinned to the plan CPU after the scheduler's slots, unless
+    // the plan wraps around onto one of them.
+    int stage_cpu(int s)
+    {
+        const int cpu = Topology::slot_cpu(Parallel::num_threads() + s);
+        for (int slot = 0; slot < Parallel::num_threads(); slot++)
+        {
+            if (Topology::slot_cpu(slot) == cpu)
+                return -1;
+        }
+        return cpu;
+    }
+}
+
+PipelineEngine::PipelineEngine(const CompiledVisionTransformer &compiled, const PipelineOptions &pipeline_options, const Tensor &sample)
+    : model(compiled), options(pipeline_options)
+{
+    options.micro_batch = std::max(1, options.micro_batch);
+    options.queue_depth = std::max(1, options.queue_depth);
+    options.threads_per_stage = std::max(1, options.threads_per_stage);
+    op_costs = profile_ops(model, sample);
+    boundaries = balance(op_costs, options.num_stages);
+}
+
+// Every op is timed on its own, on the calling thread only, after one
+// warm-up pass.
+std::vector<double> PipelineEngine::profile_ops(const CompiledVisionTransformer &model, const Tensor &sample, int repeats)
+{
+    const int previous_budget = Parallel::thread_budget();
+    Parallel::set_thread_budget(1);
+    const int n = model.ops.size();
+    std::vector<double> costs(n, 0.0);
+    for (int r = 0; r <= repeats; r++)
+    {
+        CompiledVisionTransformer::ForwardState state = model.start_forward(sample);
+        for (int o = 0; o < n; o++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            model.run_ops(state, o, o + 1);
+            if (r > 0)
+                costs[o] += seconds_since(start) / repeats;
+        }
+    }
+    Parallel::set_thread_budget(previous_budget);
+    return costs;
+}
+
+// Linear partition: best[s][i] is the smallest possible slowest stage when
+// the first i ops form s stages.
+std::vector<int> PipelineEngine::balance(const std::vector<double> &costs, int num_stages)
+{
+    const int n = costs.size();
+    const int stages = std::max(1, std::min(num_stages, n));
+    std::vector<double> prefix(n + 1, 0.0);
+    for (int i = 0; i < n; i++)
+        prefix[i + 1] = prefix[i] + costs[i];
+
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<double>> best(stages + 1, std::vector<double>(n + 1, inf));
+    std::vector<std::vector<int>> cut(stages + 1, std::vector<int>(n + 1, 0));
+    best[0][0] = 0.0;
+    for (int s = 1; s <= stages; s++)
+    {
+        for (int i = s; i <= n; i++)
+        {
+            for (int j = s - 1; j < i; j++)
+            {
+                double slowest = std::max(best[s - 1][j], prefix[i] - prefix[j]);
+                if (slowest < best[s][i])
+                {
+                    best[s][i] = slowest;
+                    cut[s][i] = j;
+                }
+            }
+        }
+    }
+
+    std::vector<int> bounds(stages + 1);
+    bounds[stages] = n;
+    for (int s = stages; s > 0; s--)
+        bounds[s - 1] = cut[s][bounds[s]];
+    return bounds;
+}
+
+std::vector<double> PipelineEngine::stage_seconds() const
+{
+    std::vector<double> seconds;
+    for (int s = 0; s < num_stages(); s++)
+    {
+        double sum = 0.0;
+        for (int o = boundaries[s]; o < boundaries[s + 1]; o++)
+            sum += o < static_cast<int>(op_costs.size()) ? op_costs[o] : 0.0;
+        seconds.push_back(sum);
+    }
+    return seconds;
+}
+
+struct PipelineEngine::Stream
+{
+    struct Job
+    {
+        int first = -1; // index of the first image; -1 ends the stream
+        std::vector<const Tensor *> images;
+    };
+
+    std::mutex mutex;
+    std::condition_variable input_ready, output_ready;
+    std::deque<Job> input;      // unbounded: submit() never waits on the stages
+    std::deque<Tensor> output;  // logits in submission order
+    std::vector<std::unique_ptr<SpscRing<MicroBatch>>> rings;
+    std::vector<std::atomic<double>> busy; // each written by its own stage only
+    std::vector<std::thread> threads;
+
+    long submitted = 0, collected = 0;
+    double window_seconds = 0.0; // closed intervals with images in flight
+    std::chrono::steady_clock::time_point window_start;
+
+    explicit Stream(int stages) : busy(stages) {}
+};
+
+PipelineEngine::~PipelineEngine()
+{
+    stop();
+}
+
+void PipelineEngine::set_stage_boundaries(const std::vector<int> &stage_boundaries)
+{
+    stop();
+    boundaries = stage_boundaries;
+}
+
+void PipelineEngine::start()
+{
+    const int stages = num_stages();
+    stream = std::make_unique<Stream>(stages);
+    Stream &st = *stream;
+    for (int s = 0; s + 1 < stages; s++)
+        st.rings.push_back(std::make_unique<SpscRing<MicroBatch>>(options.queue_depth));
+
+    auto stage_loop = [this, &st, stages](int s)
+    {
+        Parallel::set_thread_budget(options.threads_per_stage);
+        Topology::pin_current_thread(stage_cpu(s));
+        const int first_op = boundaries[s], last_op = boundaries[s + 1];
+        for (;;)
+        {
+            MicroBatch batch;
+            if (s == 0)
+            {
+                Stream::Job job;
+                {
+                    std::unique_lock<std::mutex> lock(st.mutex);
+                    st.input_ready.wait(lock, [&]
+                                        { return !st.input.empty(); });
+                    job = std::move(st.input.front());
+                    st.input.pop_front();
+                }
+                batch.first = job.first;
+                for (const Tensor *image : job.images)
+                    batch.states.push_back(model.start_forward(*image));
+            }
+            else
+            {
+                batch = st.rings[s - 1]->pop();
+            }
+            if (batch.first < 0)
+            {
+                if (s + 1 < stages)
+                    st.rings[s]->push(std::move(batch));
+                return;
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (CompiledVisionTransformer::ForwardState &state : batch.states)
+                model.run_ops(state, first_op, last_op);
+            st.busy[s].store(st.busy[s].load(std::memory_order_relaxed) + seconds_since(start), std::memory_order_relaxed);
+            if (s + 1 < stages)
+            {
+                st.rings[s]->push(std::move(batch));
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(st.mutex);
+                for (CompiledVisionTransformer::ForwardState &state : batch.states)
+                    st.output.push_back(std::move(state.logits));
+            }
+            st.output_ready.notify_one();
+        }
+    };
+    for (int s = 0; s < stages; s++)
+        st.threads.emplace_back(stage_loop, s);
+}
+
+void PipelineEngine::stop()
+{
+    if (!stream)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->input.push_back(Stream::Job());
+    }
+    stream->input_ready.notify_one();
+    for (std::thread &thread : stream->threads)
+        thread.join();
+    stream.reset();
+}
+
+void PipelineEngine::submit(const std::vector<Tensor> &images)
+{
+    if (images.empty())
+        return;
+    if (!stream)
+        start();
+    Stream &st = *stream;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        if (st.submitted == st.collected)
+            st.window_start = std::chrono::steady_clock::now();
+        for (size_t next = 0; next < images.size(); next += options.micro_batch)
+        {
+            Stream::Job job;
+            job.first = st.submitted + next;
+            for (size_t i = next; i < std::min(images.size(), next + options.micro_batch); i++)
+                job.images.push_back(&images[i]);
+            st.input.push_back(std::move(job));
+        }
+        st.submitted += images.size();
+    }
+    st.input_ready.notify_one();
+}
+
+std::vector<Tensor> PipelineEngine::collect(int count)
+{
+    std::vector<Tensor> logits;
+    if (count <= 0 || !stream)
+        return logits;
+    Stream &st = *stream;
+    std::unique_lock<std::mutex> lock(st.mutex);
+    count = std::min<long>(count, st.submitted - st.collected);
+    st.output_ready.wait(lock, [&]
+                         { return static_cast<int>(st.output.size()) >= count; });
+    for (int i = 0; i < count; i++)
+    {
+        logits.push_back(std::move(st.output.front()));
+        st.output.pop_front();
+    }
+    st.collected += count;
+    if (st.collected == st.submitted)
+        st.window_seconds += seconds_since(st.window_start);
+    return logits;
+}
+
+PipelineStats PipelineEngine::totals() const
+{
+    PipelineStats stats;
+    std::vector<double> busy(num_stages(), 0.0);
+    if (stream)
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stats.images = stream->collected;
+        stats.seconds = stream->window_seconds;
+        if (stream->submitted > stream->collected)
+            stats.seconds += seconds_since(stream->window_start);
+        for (int s = 0; s < num_stages(); s++)
+            busy[s] = stream->busy[s].load(std::memory_order_relaxed);
+    }
+    for (int s = 0; s < num_stages(); s++)
+        stats.stages.push_back({boundaries[s], boundaries[s + 1], busy[s], stats.seconds > 0.0 ? busy[s] / stats.seconds : 0.0});
+    return stats;
+}
+
+std::vector<Tensor> PipelineEngine::run(const std::vector<Tensor> &images, PipelineStats *stats)
+{
+    PipelineStats before = totals();
+    auto start = std::chrono::steady_clock::now();
+    submit(images);
+    std::vector<Tensor> logits = collect(images.size());
+    double wall = seconds_since(start);
+
+    if (stats != nullptr)
+    {
+        PipelineStats after = totals();
+        stats->images = images.size();
+        stats->seconds = wall;
+        stats->stages.clear();
+        for (int s = 0; s < num_stages(); s++)
+        {
+            double busy = after.stages[s].busy_seconds - before.stages[s].busy_seconds;
+            stats->stages.push_back({boundaries[s], boundaries[s + 1], busy, wall > 0.0 ? busy / wall : 0.0});
+        }
+    }
+    return logits;
+}
@@ -0,0 +1,186 @@
+#include "../../include/model/prediction_cache.h"
+#include "../../include/core/hash.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char kCacheMagic[8] = {'V', 'I', 'T', 'C', 'A', 'C', 'H', '1'};
+}
+
+PredictionCache::PredictionCache(std::size_t capacity, int num_shards)
+{
+    num_shards = std::max(1, num_shards);
+    shard_capacity = std::max<std::size_t>(1, (capacity + num_shards - 1) / num_shards);
+    for (int s = 0; s < num_shards; s++)
+    {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+uint64_t PredictionCache::checksum_for(const std::string &model_path, WeightDType weight_dtype)
+{
+    return hash_file(model_path) ^ static_cast<uint64_t>(weight_dtype);
+}
+
+std::unique_ptr<PredictionCache> PredictionCache::from_env(uint64_t model_checksum)
+{
+    const char *size = getenv("VIT_CACHE_SIZE");
+    long capacity = size != nullptr ? atol(size) : 0;
+    if (capacity <= 0)
+        return nullptr;
+
+    auto cache = std::make_unique<PredictionCache>(capacity);
+    cache->bind_model(model_checksum);
+    const char *path = getenv("VIT_CACHE_FILE");
+    if (path != nullptr && std::ifstream(path).good() && !cache->load(path))
+        std::cerr << "Advertencia: la caché " << path << " pertenece a otro modelo o está dañada; se descarta." << std::endl;
+    return cache;
+}
+
+bool PredictionCache::save_to_env() const
+{
+    const char *path = getenv("VIT_CACHE_FILE");
+    return path == nullptr || save(path);
+}
+
+PredictionCache::Key PredictionCache::key_of(const Tensor &image)
+{
+    // Only the image's own elements, whatever buffer a view shares.
+    const Tensor pixels = image.contiguous();
+    const std::size_t bytes = pixels.numel() * sizeof(float);
+    const uint64_t shape = (static_cast<uint64_t>(image.rows) << 32) | static_cast<uint32_t>(image.cols);
+    return {hash_bytes(pixels.values(), bytes, shape), hash_bytes(pixels.values(), bytes, ~shape)};
+}
+
+void PredictionCache::bind_model(uint64_t checksum)
+{
+    if (checksum != model_checksum)
+        clear();
+    model_checksum = checksum;
+}
+
+bool PredictionCache::lookup(const Tensor &image, Tensor &logits)
+{
+    const Key key = key_of(image);
+    Shard &shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end())
+    {
+        misses++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    const std::vector<float> &values = it->second->second;
+    logits = Tensor(1, values.size());
+    std::copy(values.begin(), values.end(), logits.data.begin());
+    hits++;
+    return true;
+}
+
+void PredictionCache::insert(const Tensor &image, const Tensor &logits)
+{
+    insert_key(key_of(image), logits.data.vector());
+}
+
+void PredictionCache::insert_key(const Key &key, std::vector<float> values)
+{
+    Shard &shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
+    {
+        it->second->second = std::move(values);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    shard.lru.emplace_front(key, std::move(values));
+    shard.index[key] = shard.lru.begin();
+    if (shard.lru.size() > shard_capacity)
+    {
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+        evictions++;
+    }
+}
+
+void PredictionCache::clear()
+{
+    for (auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+    }
+}
+
+PredictionCache::Stats PredictionCache::stats() const
+{
+    Stats result;
+    result.hits = hits;
+    result.misses = misses;
+    result.evictions = evictions;
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        result.entries += shard->lru.size();
+    }
+    return result;
+}
+
+bool PredictionCache::save(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write(kCacheMagic, sizeof(kCacheMagic));
+    file.write(reinterpret_cast<const char *>(&model_checksum), sizeof(model_checksum));
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto it = shard->lru.rbegin(); it != shard->lru.rend(); ++it)
+        {
+            const uint32_t count = it->second.size();
+            file.write(reinterpret_cast<const char *>(&it->first), sizeof(Key));
+            file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+            file.write(reinterpret_cast<const char *>(it->second.data()), count * sizeof(float));
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+bool PredictionCache::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    char magic[sizeof(kCacheMagic)];
+    uint64_t checksum = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+    if (!file || !std::equal(magic, magic + sizeof(magic), kCacheMagic) || checksum != model_checksum)
+        return false;
+
+    Key key;
+    uint32_t count;
+    while (file.read(reinterpret_cast<char *>(&key), sizeof(key)) && file.read(reinterpret_cast<char *>(&count), sizeof(count)))
+    {
+        if (count > 4096)
+        {
+            clear();
+            return false;
+        }
+        std::vector<float> values(count);
+        if (!file.read(reinterpret_cast<char *>(values.data()), count * sizeof(float)))
+        {
+            clear();
+            return false;
+        }
+        insert_key(key, std::move(values));
+    }
+    evictions = 0;
+    return true;
+}
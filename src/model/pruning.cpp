@@ -0,0 +1,79 @@
+#include "../../include/model/pruning.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+std::vector<std::vector<float>> StructuredPruning::mlp_importance(VisionTransformer &model, Criterion criterion,
+                                                                  const std::vector<Tensor> &images,
+                                                                  const std::vector<int> &labels)
+{
+    if (criterion == Criterion::Gradient)
+    {
+        model.set_training(true);
+        model.zero_grad();
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            model.train_step(images[i], labels[i]);
+        }
+    }
+
+    std::vector<std::vector<float>> importance;
+    for (const auto &block : model.transformer_blocks)
+    {
+        const Linear &fc1 = block->mlp.fc1, &fc2 = block->mlp.fc2;
+        const int hidden_dim = fc1.weight.rows, d_model = fc1.weight.cols;
+        std::vector<float> scores(hidden_dim, 0.0f);
+        for (int j = 0; j < hidden_dim; j++)
+        {
+            if (criterion == Criterion::Magnitude)
+            {
+                float in_norm = 0.0f, out_norm = 0.0f;
+                for (int k = 0; k < d_model; k++)
+                {
+                    in_norm += fc1.weight(j, k) * fc1.weight(j, k);
+                    out_norm += fc2.weight(k, j) * fc2.weight(k, j);
+                }
+                scores[j] = std::sqrt(in_norm) * std::sqrt(out_norm);
+            }
+            else
+            {
+                float taylor = std::fabs(fc1.bias(j, 0) * fc1.bias_grad(j, 0));
+                for (int k = 0; k < d_model; k++)
+                {
+                    taylor += std::fabs(fc1.weight(j, k) * fc1.weight_grad(j, k));
+                    taylor += std::fabs(fc2.weight(k, j) * fc2.weight_grad(k, j));
+                }
+                scores[j] = taylor;
+            }
+        }
+        importance.push_back(scores);
+    }
+
+    if (criterion == Criterion::Gradient)
+    {
+        model.zero_grad();
+        model.set_training(false);
+    }
+    return importance;
+}
+
+void StructuredPruning::prune_mlp(VisionTransformer &model, const std::vector<std::vector<float>> &importance, float sparsity)
+{
+    for (size_t l = 0; l < model.transformer_blocks.size(); l++)
+    {
+        const std::vector<float> &scores = importance[l];
+        const int hidden_dim = static_cast<int>(scores.size());
+        const int keep_count = std::max(1, static_cast<int>(std::lround((1.0f - sparsity) * hidden_dim)));
+        if (keep_count >= hidden_dim)
+            continue;
+
+        std::vector<int> order(hidden_dim);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                         { return scores[a] > scores[b]; });
+        std::vector<int> keep(order.begin(), order.begin() + keep_count);
+        std::sort(keep.begin(), keep.end());
+        model.transformer_blocks[l]->mlp.prune_hidden(keep);
+    }
+    model.prepack_weights();
+}
@@ -0,0 +1,29 @@
+#include "../../include/model/static_vit.h"
+
+namespace
+{
+    template <typename Model>
+    std::unique_ptr<StaticModelBase> try_make(const CompiledVisionTransformer &model)
+    {
+        if (!Model::matches(model))
+            return nullptr;
+        return std::make_unique<Model>(model);
+    }
+}
+
+// Configurations with a specialized build. The first entry is the shipped
+// model (app/train.cpp and app/infer.cpp); the others are its common
+// variants. Add a line here to specialize another configuration.
+std::unique_ptr<StaticModelBase> make_static_model(const CompiledVisionTransformer &model)
+{
+    std::unique_ptr<StaticModelBase> result;
+    if (!result)
+        result = try_make<StaticVisionTransformer<28, 4, 64, 2, 10>>(model);
+    if (!result)
+        result = try_make<StaticVisionTransformer<28, 7, 64, 2, 10>>(model);
+    if (!result)
+        result = try_make<StaticVisionTransformer<28, 4, 32, 2, 10>>(model);
+    if (!result)
+        result = try_make<StaticVisionTransformer<28, 4, 64, 4, 10>>(model);
+    return result;
+}
@@ -1,9 +1,13 @@
 #include "../../include/model/vit.h"
 #include "../../include/core/activation.h"
 #include "../../include/core/random.h"
+#include "../../include/core/parallel.h"
+#include "../../include/core/task_scheduler.h"
 #include <iostream>
 #include <algorithm>
 #include <fstream>
+#include <stdexcept>
+#include <utility>
 
 VisionTransformer::VisionTransformer(int img_size, int patch_sz, int d_mod, int n_layers, int n_classes)
     : image_size(img_size), patch_size(patch_sz), d_model(d_mod),
@@ -13,20 +17,11 @@ VisionTransformer::VisionTransformer(int img_size, int patch_sz, int d_mod, int
       class_token(1, d_mod),
       position_embeddings(num_patches + 1, d_mod),
       classification_head(d_mod, n_classes),
-      final_ln(d_mod)
+      final_ln(d_mod), exit_loss_weight(0.5f), checkpoint_dtype(WeightDType::F32)
 {
 
-    for (int i = 0; i < d_model; i++)
-    {
-        class_token(0, i) = Random::randn(0.0f, 0.01f);
-    }
-    for (int i = 0; i < position_embeddings.rows; i++)
-    {
-        for (int j = 0; j < position_embeddings.cols; j++)
-        {
-            position_embeddings(i, j) = Random::randn(0.0f, 0.01f);
-        }
-    }
+    Random::fill_normal(class_token.data.data(), class_token.data.size(), 0.0f, 0.01f);
+    Random::fill_normal(position_embeddings.data.data(), position_embeddings.data.size(), 0.0f, 0.01f);
 
     for (int i = 0; i < num_layers; i++)
     {
@@ -36,26 +31,13 @@ VisionTransformer::VisionTransformer(int img_size, int patch_sz, int d_mod, int
 
 Tensor VisionTransformer::image_to_patches(const Tensor &image)
 {
-    Tensor patches(num_patches, patch_size * patch_size);
-    int patches_per_row = image_size / patch_size;
-    int patch_idx = 0;
-    for (int i = 0; i < patches_per_row; i++)
-    {
-        for (int j = 0; j < patches_per_row; j++)
-        {
-            for (int pi = 0; pi < patch_size; pi++)
-            {
-                for (int pj = 0; pj < patch_size; pj++)
-                {
-                    int img_row = i * patch_size + pi;
-                    int img_col = j * patch_size + pj;
-                    patches(patch_idx, pi * patch_size + pj) = image(img_row, img_col);
-                }
-            }
-            patch_idx++;
-        }
-    }
-    return patches;
+    // [H, W] -> [H/p, p, W/p, p] -> [H/p, W/p, p, p]: one row per patch,
+    // patches in row-major order and pixels row-major inside each patch.
+    const int grid = image_size / patch_size;
+    return image.reshape({grid, patch_size, grid, patch_size})
+        .permute({0, 2, 1, 3})
+        .contiguous()
+        .reshape({num_patches, patch_size * patch_size});
 }
 
 Tensor VisionTransformer::forward(const Tensor &image)
@@ -65,32 +47,58 @@ Tensor VisionTransformer::forward(const Tensor &image)
 
     Tensor patch_emb = patch_embedding.forward(last_patches);
 
-    Tensor sequence = Tensor(num_patches + 1, d_model);
-    sequence.set_slice(0, 0, class_token);
-    sequence.set_slice(1, 0, patch_emb);
-
-    Tensor current = sequence + position_embeddings;
+    Tensor current(num_patches + 1, d_model);
+    current.set_slice(0, 0, class_token);
+    current.set_slice(1, 0, patch_emb);
+    current += position_embeddings;
 
     for (int i = 0; i < num_layers; i++)
     {
-        current = transformer_blocks[i]->forward(current);
+        current = transformer_blocks[i]->forward(std::move(current));
+        if (i < static_cast<int>(exit_heads.size()))
+        {
+            Tensor exit_features = exit_lns[i]->forward(current.slice(0, 1, 0, d_model));
+            last_exit_logits[i] = exit_heads[i]->forward(exit_features);
+        }
     }
 
-    current = final_ln.forward(current);
+    current = final_ln.forward(std::move(current));
 
     Tensor class_token_features = current.slice(0, 1, 0, d_model);
 
-    last_logits = classification_head.forward(class_token_features);
+    last_logits = classification_head.forward(std::move(class_token_features));
     return last_logits;
 }
 
 void VisionTransformer::backward(int true_label)
 {
+    Tensor grad_logits;
+    Activation::softmax_cross_entropy(last_logits, true_label, &grad_logits);
+    backward_from_logits(grad_logits);
+}
 
-    Tensor grad_logits = Activation::softmax(this->last_logits);
-    grad_logits(0, true_label) -= 1.0f;
+void VisionTransformer::backward_from_logits(const Tensor &grad_logits, const std::vector<Tensor> *exit_grad_logits)
+{
+    // Weight gradients only feed update_weights(), so they are queued as
+    // tasks and filled in by idle workers while this thread keeps walking
+    // the input-gradient chain down to the patch embedding. With
+    // on_gradients_ready set, every bucket gets its own group and is
+    // reported once the next bucket has been started.
+    TaskGroup weight_grad_tasks;
+    std::vector<TaskGroup> bucket_tasks(on_gradients_ready ? num_gradient_buckets() : 0);
+    auto tasks_for = [&](int bucket)
+    {
+        return on_gradients_ready ? &bucket_tasks[bucket] : &weight_grad_tasks;
+    };
+    auto finish = [&](int bucket)
+    {
+        if (!on_gradients_ready)
+            return;
+        bucket_tasks[bucket].wait();
+        on_gradients_ready(bucket);
+    };
 
-    Tensor grad_class_token_features = classification_head.backward(grad_logits);
+    Tensor grad_class_token_features = classification_head.backward(grad_logits, tasks_for(0));
 
     Tensor grad_sequence_after_final_ln(num_patches + 1, d_model);
     grad_sequence_after_final_ln.zero();
@@ -98,21 +106,66 @@ void VisionTransformer::backward(int true_label)
 
     Tensor grad_before_final_ln = final_ln.backward(grad_sequence_after_final_ln);
 
-    Tensor grad_current_block_input = grad_before_final_ln;
+    Tensor grad_current_block_input = std::move(grad_before_final_ln);
     for (int i = num_layers - 1; i >= 0; i--)
     {
-        grad_current_block_input = transformer_blocks[i]->backward(grad_current_block_input);
+        const int bucket = num_layers - i;
+        if (exit_grad_logits != nullptr && i < static_cast<int>(exit_heads.size()))
+        {
+            Tensor grad_exit_features = exit_heads[i]->backward((*exit_grad_logits)[i], tasks_for(bucket));
+            Tensor grad_exit_cls = exit_lns[i]->backward(grad_exit_features);
+            for (int j = 0; j < d_model; j++)
+            {
+                grad_current_block_input(0, j) += grad_exit_cls(0, j);
+            }
+        }
+        grad_current_block_input = transformer_blocks[i]->backward(grad_current_block_input, tasks_for(bucket));
+        finish(bucket - 1);
     }
 
     Tensor grad_patch_emb_input = grad_current_block_input.slice(1, num_patches + 1, 0, d_model);
 
-    patch_embedding.backward(grad_patch_emb_input);
+    patch_embedding.backward(grad_patch_emb_input, tasks_for(num_layers + 1));
+    finish(num_layers);
+    finish(num_layers + 1);
+    weight_grad_tasks.wait();
+}
+
+StepResult VisionTransformer::train_step(const Tensor &image, int true_label)
+{
+    StepResult step;
+    step.logits = forward(image);
+    Tensor grad_logits;
+    step.loss = Activation::softmax_cross_entropy(step.logits, true_label, &grad_logits);
+    step.prediction = Activation::argmax(step.logits);
+    if (!has_exit_heads())
+    {
+        backward_from_logits(grad_logits);
+        return step;
+    }
+
+    std::vector<Tensor> exit_grad_logits(exit_heads.size());
+    for (size_t i = 0; i < exit_heads.size(); i++)
+    {
+        Activation::softmax_cross_entropy(last_exit_logits[i], true_label, &exit_grad_logits[i]);
+        exit_grad_logits[i] *= exit_loss_weight;
+    }
+    backward_from_logits(grad_logits, &exit_grad_logits);
+    return step;
+}
+
+StepResult VisionTransformer::eval_step(const Tensor &image, int true_label)
+{
+    StepResult step;
+    step.logits = forward(image);
+    step.loss = Activation::softmax_cross_entropy(step.logits, true_label);
+    step.prediction = Activation::argmax(step.logits);
+    return step;
 }
 
 float VisionTransformer::compute_loss(const Tensor &logits, int true_label)
 {
-    Tensor probs = Activation::softmax(logits);
-    return -log(std::max(probs(0, true_label), 1e-8f));
+    return Activation::softmax_cross_entropy(logits, true_label);
 }
 
 void VisionTransformer::update_weights(float lr)
@@ -124,6 +177,11 @@ void VisionTransformer::update_weights(float lr)
     {
         block->update(lr);
     }
+    for (size_t i = 0; i < exit_heads.size(); i++)
+    {
+        exit_heads[i]->update(lr);
+        exit_lns[i]->update(lr);
+    }
 }
 
 void VisionTransformer::zero_grad()
@@ -135,61 +193,374 @@ void VisionTransformer::zero_grad()
     {
         block->zero_grad();
     }
+    for (size_t i = 0; i < exit_heads.size(); i++)
+    {
+        exit_heads[i]->zero_grad();
+        exit_lns[i]->zero_grad();
+    }
 }
 
 int VisionTransformer::predict(const Tensor &image)
 {
-    Tensor logits = forward(image);
-    int predicted_class = 0;
-    float max_logit = logits(0, 0);
-    for (int i = 1; i < num_classes; i++)
+    return Activation::argmax(forward(image));
+}
+
+void VisionTransformer::set_training(bool training)
+{
+    patch_embedding.training = training;
+    classification_head.training = training;
+    for (auto &block : transformer_blocks)
+    {
+        block->attention_proj.training = training;
+        if (block->token_mixer)
+            block->token_mixer->set_training(training);
+        block->mlp.training = training;
+        block->mlp.fc1.training = training;
+        block->mlp.fc2.training = training;
+    }
+    for (auto &head : exit_heads)
     {
-        if (logits(0, i) > max_logit)
+        head->training = training;
+    }
+}
+
+size_t VisionTransformer::num_parameters() const
+{
+    size_t count = patch_embedding.weight.data.size() + patch_embedding.bias.data.size() +
+                   class_token.data.size() + position_embeddings.data.size() +
+                   classification_head.weight.data.size() + classification_head.bias.data.size() +
+                   final_ln.gamma.data.size() + final_ln.beta.data.size();
+    for (const auto &block : transformer_blocks)
+    {
+        for (const Linear *linear : {&block->attention_proj, &block->mlp.fc1, &block->mlp.fc2})
+        {
+            count += linear->low_rank ? linear->low_rank->u.data.size() + linear->low_rank->v.data.size()
+                                      : linear->weight.data.size();
+            count += linear->bias.data.size();
+        }
+        if (block->token_mixer)
+        {
+            for (const Linear *linear : {&block->token_mixer->q_proj, &block->token_mixer->k_proj, &block->token_mixer->v_proj})
+                count += linear->weight.data.size() + linear->bias.data.size();
+        }
+        for (const LayerNorm *ln : {&block->ln1, &block->ln2, &block->mlp.ln})
         {
-            max_logit = logits(0, i);
-            predicted_class = i;
+            count += ln->gamma.data.size() + ln->beta.data.size();
         }
     }
-    return predicted_class;
+    for (size_t i = 0; i < exit_heads.size(); i++)
+    {
+        count += exit_heads[i]->weight.data.size() + exit_heads[i]->bias.data.size() +
+                 exit_lns[i]->gamma.data.size() + exit_lns[i]->beta.data.size();
+    }
+    return count;
 }
 
-void save_tensor_data(std::ostream &os, const std::string &name, const Tensor &tensor)
+std::vector<std::pair<std::string, Tensor *>> VisionTransformer::named_parameters()
 {
-    os << name << " " << tensor.rows << " " << tensor.cols << std::endl;
+    std::vector<std::pair<std::string, Tensor *>> params = {
+        {"class_token", &class_token},
+        {"position_embeddings", &position_embeddings},
+        {"patch_embedding_weights", &patch_embedding.weight},
+        {"patch_embedding_biases", &patch_embedding.bias}};
+    for (int i = 0; i < num_layers; ++i)
+    {
+        std::string block_prefix = "transformer_block_" + std::to_string(i);
+        TransformerBlock &block = *transformer_blocks[i];
+        params.push_back({block_prefix + "_attention_proj_weights", &block.attention_proj.weight});
+        params.push_back({block_prefix + "_attention_proj_biases", &block.attention_proj.bias});
+        params.push_back({block_prefix + "_mlp_fc1_weights", &block.mlp.fc1.weight});
+        params.push_back({block_prefix + "_mlp_fc1_biases", &block.mlp.fc1.bias});
+        params.push_back({block_prefix + "_mlp_fc2_weights", &block.mlp.fc2.weight});
+        params.push_back({block_prefix + "_mlp_fc2_biases", &block.mlp.fc2.bias});
+        params.push_back({block_prefix + "_mlp_ln_gamma", &block.mlp.ln.gamma});
+        params.push_back({block_prefix + "_mlp_ln_beta", &block.mlp.ln.beta});
+        params.push_back({block_prefix + "_ln1_gamma", &block.ln1.gamma});
+        params.push_back({block_prefix + "_ln1_beta", &block.ln1.beta});
+        params.push_back({block_prefix + "_ln2_gamma", &block.ln2.gamma});
+        params.push_back({block_prefix + "_ln2_beta", &block.ln2.beta});
+    }
+    params.push_back({"classification_head_weights", &classification_head.weight});
+    params.push_back({"classification_head_biases", &classification_head.bias});
+    params.push_back({"final_ln_gamma", &final_ln.gamma});
+    params.push_back({"final_ln_beta", &final_ln.beta});
+    for (size_t i = 0; i < exit_heads.size(); ++i)
+    {
+        std::string exit_prefix = "exit_head_" + std::to_string(i);
+        params.push_back({exit_prefix + "_weights", &exit_heads[i]->weight});
+        params.push_back({exit_prefix + "_biases", &exit_heads[i]->bias});
+        params.push_back({exit_prefix + "_ln_gamma", &exit_lns[i]->gamma});
+        params.push_back({exit_prefix + "_ln_beta", &exit_lns[i]->beta});
+    }
+    for (int i = 0; i < num_layers && transformer_blocks[i]->token_mixer; ++i)
+    {
+        std::string mixer_prefix = "transformer_block_" + std::to_string(i) + "_token_mixer";
+        LinearAttention &mixer = *transformer_blocks[i]->token_mixer;
+        for (auto [name, linear] : {std::make_pair("_q", &mixer.q_proj), std::make_pair("_k", &mixer.k_proj), std::make_pair("_v", &mixer.v_proj)})
+        {
+            params.push_back({mixer_prefix + name + "_weights", &linear->weight});
+            params.push_back({mixer_prefix + name + "_biases", &linear->bias});
+        }
+    }
+    return params;
+}
+
+std::vector<std::vector<Tensor *>> VisionTransformer::gradient_buckets()
+{
+    std::vector<std::vector<Tensor *>> buckets(num_gradient_buckets());
+    buckets[0] = {&classification_head.weight_grad, &classification_head.bias_grad, &final_ln.gamma_grad, &final_ln.beta_grad};
+    for (int i = 0; i < num_layers; ++i)
+    {
+        TransformerBlock &block = *transformer_blocks[i];
+        std::vector<Tensor *> &bucket = buckets[num_layers - i];
+        bucket = {&block.mlp.ln.gamma_grad, &block.mlp.ln.beta_grad,
+                  &block.mlp.fc2.weight_grad, &block.mlp.fc2.bias_grad,
+                  &block.mlp.fc1.weight_grad, &block.mlp.fc1.bias_grad,
+                  &block.ln2.gamma_grad, &block.ln2.beta_grad,
+                  &block.attention_proj.weight_grad, &block.attention_proj.bias_grad,
+                  &block.ln1.gamma_grad, &block.ln1.beta_grad};
+        if (block.token_mixer)
+        {
+            LinearAttention &mixer = *block.token_mixer;
+            bucket.insert(bucket.end(), {&mixer.q_proj.weight_grad, &mixer.q_proj.bias_grad,
+                                         &mixer.k_proj.weight_grad, &mixer.k_proj.bias_grad,
+                                         &mixer.v_proj.weight_grad, &mixer.v_proj.bias_grad});
+        }
+        if (i < static_cast<int>(exit_heads.size()))
+        {
+            bucket.insert(bucket.end(), {&exit_heads[i]->weight_grad, &exit_heads[i]->bias_grad,
+                                         &exit_lns[i]->gamma_grad, &exit_lns[i]->beta_grad});
+        }
+    }
+    buckets[num_layers + 1] = {&patch_embedding.weight_grad, &patch_embedding.bias_grad};
+    return buckets;
+}
+
+void VisionTransformer::enable_exit_heads()
+{
+    exit_lns.clear();
+    exit_heads.clear();
+    for (int i = 0; i + 1 < num_layers; i++)
+    {
+        exit_lns.push_back(std::make_unique<LayerNorm>(d_model));
+        exit_heads.push_back(std::make_unique<Linear>(d_model, num_classes));
+    }
+    last_exit_logits.assign(exit_heads.size(), Tensor());
+}
+
+void VisionTransformer::enable_token_mixing(int num_heads)
+{
+    for (auto &block : transformer_blocks)
+    {
+        if (num_heads > 0)
+            block->enable_token_mixing(num_heads);
+        else
+            block->token_mixer.reset();
+    }
+}
+
+int VisionTransformer::token_mixing_heads() const
+{
+    return transformer_blocks.empty() || !transformer_blocks[0]->token_mixer ? 0 : transformer_blocks[0]->token_mixer->num_heads;
+}
+
+std::vector<GemmShape> VisionTransformer::gemm_shapes() const
+{
+    std::vector<GemmShape> shapes;
+    auto add = [&](const Linear &linear, int m)
+    {
+        WeightDType dtype = linear.packed_weight.empty() ? checkpoint_dtype : linear.packed_weight.dtype;
+        if (linear.low_rank)
+        {
+            shapes.push_back({m, linear.low_rank->v.cols, linear.low_rank->rank(), dtype});
+            shapes.push_back({m, linear.low_rank->rank(), linear.low_rank->u.rows, dtype});
+        }
+        else
+        {
+            shapes.push_back({m, linear.weight.cols, linear.weight.rows, dtype});
+        }
+    };
+    const int tokens = num_patches + 1;
+    add(patch_embedding, num_patches);
+    for (const auto &block : transformer_blocks)
+    {
+        if (block->token_mixer)
+        {
+            for (const Linear *linear : {&block->token_mixer->q_proj, &block->token_mixer->k_proj, &block->token_mixer->v_proj})
+                add(*linear, tokens);
+        }
+        add(block->attention_proj, tokens);
+        add(block->mlp.fc1, tokens);
+        add(block->mlp.fc2, tokens);
+    }
+    for (const auto &head : exit_heads)
+        add(*head, 1);
+    add(classification_head, 1);
+    std::sort(shapes.begin(), shapes.end());
+    shapes.erase(std::unique(shapes.begin(), shapes.end()), shapes.end());
+    return shapes;
+}
+
+void VisionTransformer::prepack_weights(WeightDType dtype)
+{
+    patch_embedding.prepack(dtype);
+    classification_head.prepack(dtype);
+    for (auto &block : transformer_blocks)
+    {
+        block->attention_proj.prepack(dtype);
+        block->mlp.fc1.prepack(dtype);
+        block->mlp.fc2.prepack(dtype);
+        if (block->token_mixer)
+        {
+            block->token_mixer->q_proj.prepack(dtype);
+            block->token_mixer->k_proj.prepack(dtype);
+            block->token_mixer->v_proj.prepack(dtype);
+        }
+    }
+    for (auto &head : exit_heads)
+    {
+        head->prepack(dtype);
+    }
+}
+
+// Tensor entries are "<name> rows cols" followed by the values as text. A
+// half-precision entry is named "<name>@f16" or "<name>@bf16" and stores
+// each value as its 16-bit code in hex.
+void save_tensor_data(std::ostream &os, const std::string &name, const Tensor &tensor, WeightDType dtype = WeightDType::F32)
+{
+    os << name << (dtype == WeightDType::F32 ? "" : "@" + dtype_name(dtype)) << " " << tensor.rows << " " << tensor.cols << std::endl;
+    if (dtype != WeightDType::F32)
+        os << std::hex;
     for (int i = 0; i < tensor.rows; ++i)
     {
         for (int j = 0; j < tensor.cols; ++j)
         {
-            os << tensor(i, j) << (j == tensor.cols - 1 ? "" : " ");
+            if (dtype == WeightDType::F32)
+                os << tensor(i, j);
+            else
+                os << narrow(tensor(i, j), dtype);
+            os << (j == tensor.cols - 1 ? "" : " ");
         }
         os << std::endl;
     }
+    os << std::dec;
 }
 
-void load_tensor_data(std::istream &is, const std::string &expected_name, Tensor &tensor)
+// Reads an entry header and splits the precision suffix off its name.
+std::string read_tensor_header(std::istream &is, int &rows, int &cols, WeightDType &dtype)
 {
     std::string name;
-    int rows, cols;
     is >> name >> rows >> cols;
-    if (name != expected_name)
+    dtype = WeightDType::F32;
+    size_t at = name.find('@');
+    if (at != std::string::npos)
     {
-        std::cerr << "Error de carga: Nombre de tensor esperado '" << expected_name
-                  << "' pero se encontró '" << name << "'" << std::endl;
-
-        return;
+        if (!parse_dtype(name.substr(at + 1), dtype))
+            std::cerr << "Error de carga: precisión desconocida en '" << name << "'" << std::endl;
+        name = name.substr(0, at);
     }
+    return name;
+}
 
+void read_tensor_values(std::istream &is, int rows, int cols, WeightDType dtype, Tensor &tensor)
+{
     tensor = Tensor(rows, cols);
+    if (dtype != WeightDType::F32)
+        is >> std::hex;
     for (int i = 0; i < rows; ++i)
     {
         for (int j = 0; j < cols; ++j)
         {
-            is >> tensor(i, j);
+            if (dtype == WeightDType::F32)
+            {
+                is >> tensor(i, j);
+            }
+            else
+            {
+                unsigned int code = 0;
+                is >> code;
+                tensor(i, j) = widen(static_cast<uint16_t>(code), dtype);
+            }
         }
     }
+    is >> std::dec;
+}
+
+// Returns the precision the entry was stored in.
+WeightDType load_tensor_data(std::istream &is, const std::string &expected_name, Tensor &tensor)
+{
+    int rows, cols;
+    WeightDType dtype;
+    std::string name = read_tensor_header(is, rows, cols, dtype);
+    if (name != expected_name)
+    {
+        std::cerr << "Error de carga: Nombre de tensor esperado '" << expected_name
+                  << "' pero se encontró '" << name << "'" << std::endl;
+
+        return dtype;
+    }
+
+    read_tensor_values(is, rows, cols, dtype, tensor);
+    return dtype;
+}
+
+// Trailer entries are optional as a whole, but once present each one must
+// be the tensor it fills, by name and shape.
+void load_trailer_tensor(std::istream &is, const std::string &expected_name, Tensor &tensor)
+{
+    int rows, cols;
+    WeightDType dtype;
+    std::string name = read_tensor_header(is, rows, cols, dtype);
+    if (!is || name != expected_name || rows != tensor.rows || cols != tensor.cols)
+        throw std::runtime_error("Error de carga: se esperaba '" + expected_name + "' de " + std::to_string(tensor.rows) +
+                                 "x" + std::to_string(tensor.cols) + " pero se encontró '" + name + "'");
+    read_tensor_values(is, rows, cols, dtype, tensor);
+    if (!is)
+        throw std::runtime_error("Error de carga: valores incompletos en '" + expected_name + "'");
+}
+
+// A factorized Linear stores its U and V factors as "<name>_u" / "<name>_v"
+// in place of the dense "<name>" weight.
+void save_linear_weight(std::ostream &os, const std::string &name, const Linear &linear, WeightDType dtype)
+{
+    if (linear.low_rank)
+    {
+        save_tensor_data(os, name + "_u", linear.low_rank->u, dtype);
+        save_tensor_data(os, name + "_v", linear.low_rank->v, dtype);
+    }
+    else
+    {
+        save_tensor_data(os, name, linear.weight, dtype);
+    }
+}
+
+WeightDType load_linear_weight(std::istream &is, const std::string &expected_name, Tensor &weight, std::shared_ptr<LowRankLinear> &low_rank)
+{
+    int rows, cols;
+    WeightDType dtype;
+    std::string name = read_tensor_header(is, rows, cols, dtype);
+    low_rank.reset();
+    if (name == expected_name)
+    {
+        read_tensor_values(is, rows, cols, dtype, weight);
+        return dtype;
+    }
+    if (name != expected_name + "_u")
+    {
+        std::cerr << "Error de carga: Nombre de tensor esperado '" << expected_name
+                  << "' pero se encontró '" << name << "'" << std::endl;
+        return dtype;
+    }
+
+    Tensor u, v;
+    read_tensor_values(is, rows, cols, dtype, u);
+    load_tensor_data(is, expected_name + "_v", v);
+    low_rank = std::make_shared<LowRankLinear>(u, v);
+    weight = low_rank->reconstruct();
+    return dtype;
 }
 
-void VisionTransformer::save_model(const std::string &filename) const
+void VisionTransformer::save_model(const std::string &filename, WeightDType weight_dtype) const
 {
     std::ofstream ofs(filename);
     if (!ofs.is_open())
@@ -209,19 +580,19 @@ void VisionTransformer::save_model(const std::string &filename) const
     save_tensor_data(ofs, "class_token", class_token);
     save_tensor_data(ofs, "position_embeddings", position_embeddings);
 
-    save_tensor_data(ofs, "patch_embedding_weights", patch_embedding.weight);
+    save_tensor_data(ofs, "patch_embedding_weights", patch_embedding.weight, weight_dtype);
     save_tensor_data(ofs, "patch_embedding_biases", patch_embedding.bias);
 
     for (int i = 0; i < num_layers; ++i)
     {
         std::string block_prefix = "transformer_block_" + std::to_string(i);
 
-        save_tensor_data(ofs, block_prefix + "_attention_proj_weights", transformer_blocks[i]->attention_proj.weight);
+        save_linear_weight(ofs, block_prefix + "_attention_proj_weights", transformer_blocks[i]->attention_proj, weight_dtype);
         save_tensor_data(ofs, block_prefix + "_attention_proj_biases", transformer_blocks[i]->attention_proj.bias);
 
-        save_tensor_data(ofs, block_prefix + "_mlp_fc1_weights", transformer_blocks[i]->mlp.fc1.weight);
+        save_linear_weight(ofs, block_prefix + "_mlp_fc1_weights", transformer_blocks[i]->mlp.fc1, weight_dtype);
         save_tensor_data(ofs, block_prefix + "_mlp_fc1_biases", transformer_blocks[i]->mlp.fc1.bias);
-        save_tensor_data(ofs, block_prefix + "_mlp_fc2_weights", transformer_blocks[i]->mlp.fc2.weight);
+        save_linear_weight(ofs, block_prefix + "_mlp_fc2_weights", transformer_blocks[i]->mlp.fc2, weight_dtype);
         save_tensor_data(ofs, block_prefix + "_mlp_fc2_biases", transformer_blocks[i]->mlp.fc2.bias);
 
         save_tensor_data(ofs, block_prefix + "_mlp_ln_gamma", transformer_blocks[i]->mlp.ln.gamma);
@@ -232,12 +603,40 @@ void VisionTransformer::save_model(const std::string &filename) const
         save_tensor_data(ofs, block_prefix + "_ln2_beta", transformer_blocks[i]->ln2.beta);
     }
 
-    save_tensor_data(ofs, "classification_head_weights", classification_head.weight);
+    save_tensor_data(ofs, "classification_head_weights", classification_head.weight, weight_dtype);
     save_tensor_data(ofs, "classification_head_biases", classification_head.bias);
 
     save_tensor_data(ofs, "final_ln_gamma", final_ln.gamma);
     save_tensor_data(ofs, "final_ln_beta", final_ln.beta);
 
+    // Optional trailer; files without it load with no exit heads.
+    if (has_exit_heads())
+    {
+        ofs << "num_exit_heads " << exit_heads.size() << std::endl;
+        for (size_t i = 0; i < exit_heads.size(); ++i)
+        {
+            std::string exit_prefix = "exit_head_" + std::to_string(i);
+            save_tensor_data(ofs, exit_prefix + "_weights", exit_heads[i]->weight, weight_dtype);
+            save_tensor_data(ofs, exit_prefix + "_biases", exit_heads[i]->bias);
+            save_tensor_data(ofs, exit_prefix + "_ln_gamma", exit_lns[i]->gamma);
+            save_tensor_data(ofs, exit_prefix + "_ln_beta", exit_lns[i]->beta);
+        }
+    }
+    if (token_mixing_heads() > 0)
+    {
+        ofs << "token_mixer_heads " << token_mixing_heads() << std::endl;
+        for (int i = 0; i < num_layers; ++i)
+        {
+            std::string mixer_prefix = "transformer_block_" + std::to_string(i) + "_token_mixer";
+            const LinearAttention &mixer = *transformer_blocks[i]->token_mixer;
+            for (auto [name, linear] : {std::make_pair("_q", &mixer.q_proj), std::make_pair("_k", &mixer.k_proj), std::make_pair("_v", &mixer.v_proj)})
+            {
+                save_tensor_data(ofs, mixer_prefix + name + "_weights", linear->weight, weight_dtype);
+                save_tensor_data(ofs, mixer_prefix + name + "_biases", linear->bias);
+            }
+        }
+    }
+
     ofs.close();
     std::cout << "Modelo guardado exitosamente en: " << filename << std::endl;
 }
@@ -283,18 +682,26 @@ void VisionTransformer::load_model(const std::string &filename)
     load_tensor_data(ifs, "class_token", class_token);
     load_tensor_data(ifs, "position_embeddings", position_embeddings);
 
-    load_tensor_data(ifs, "patch_embedding_weights", patch_embedding.weight);
+    checkpoint_dtype = load_tensor_data(ifs, "patch_embedding_weights", patch_embedding.weight);
     load_tensor_data(ifs, "patch_embedding_biases", patch_embedding.bias);
 
     for (int i = 0; i < num_layers; ++i)
     {
         std::string block_prefix = "transformer_block_" + std::to_string(i);
-        load_tensor_data(ifs, block_prefix + "_attention_proj_weights", transformer_blocks[i]->attention_proj.weight);
+        load_linear_weight(ifs, block_prefix + "_attention_proj_weights", transformer_blocks[i]->attention_proj.weight, transformer_blocks[i]->attention_proj.low_rank);
         load_tensor_data(ifs, block_prefix + "_attention_proj_biases", transformer_blocks[i]->attention_proj.bias);
 
-        load_tensor_data(ifs, block_prefix + "_mlp_fc1_weights", transformer_blocks[i]->mlp.fc1.weight);
+        // The MLP width is per layer (structured pruning shrinks it), so it
+        // comes from the stored fc1 shape rather than from d_model.
+        Tensor fc1_weight;
+        std::shared_ptr<LowRankLinear> fc1_low_rank;
+        load_linear_weight(ifs, block_prefix + "_mlp_fc1_weights", fc1_weight, fc1_low_rank);
+        if (fc1_weight.rows != transformer_blocks[i]->mlp.fc1.weight.rows)
+            transformer_blocks[i]->mlp = MLP(d_model, fc1_weight.rows);
+        transformer_blocks[i]->mlp.fc1.weight = fc1_weight;
+        transformer_blocks[i]->mlp.fc1.low_rank = fc1_low_rank;
         load_tensor_data(ifs, block_prefix + "_mlp_fc1_biases", transformer_blocks[i]->mlp.fc1.bias);
-        load_tensor_data(ifs, block_prefix + "_mlp_fc2_weights", transformer_blocks[i]->mlp.fc2.weight);
+        load_linear_weight(ifs, block_prefix + "_mlp_fc2_weights", transformer_blocks[i]->mlp.fc2.weight, transformer_blocks[i]->mlp.fc2.low_rank);
         load_tensor_data(ifs, block_prefix + "_mlp_fc2_biases", transformer_blocks[i]->mlp.fc2.bias);
 
         load_tensor_data(ifs, block_prefix + "_mlp_ln_gamma", transformer_blocks[i]->mlp.ln.gamma);
@@ -311,6 +718,50 @@ void VisionTransformer::load_model(const std::string &filename)
     load_tensor_data(ifs, "final_ln_gamma", final_ln.gamma);
     load_tensor_data(ifs, "final_ln_beta", final_ln.beta);
 
+    // Optional trailers: exit heads, then token mixers.
+    exit_lns.clear();
+    exit_heads.clear();
+    enable_token_mixing(0);
+    int num_exit_heads = 0, mixer_heads = 0;
+    bool has_tag = static_cast<bool>(ifs >> tag);
+    if (has_tag && tag == "num_exit_heads")
+    {
+        if (!(ifs >> num_exit_heads) || num_exit_heads != num_layers - 1)
+            throw std::runtime_error("Error de carga: num_exit_heads debe ser num_layers - 1 (" +
+                                     std::to_string(num_layers - 1) + ") en " + filename);
+        enable_exit_heads();
+        for (int i = 0; i < num_exit_heads; ++i)
+        {
+            std::string exit_prefix = "exit_head_" + std::to_string(i);
+            load_trailer_tensor(ifs, exit_prefix + "_weights", exit_heads[i]->weight);
+            load_trailer_tensor(ifs, exit_prefix + "_biases", exit_heads[i]->bias);
+            load_trailer_tensor(ifs, exit_prefix + "_ln_gamma", exit_lns[i]->gamma);
+            load_trailer_tensor(ifs, exit_prefix + "_ln_beta", exit_lns[i]->beta);
+        }
+        has_tag = static_cast<bool>(ifs >> tag);
+    }
+    if (has_tag && tag == "token_mixer_heads")
+    {
+        if (!(ifs >> mixer_heads) || mixer_heads <= 0 || d_model % mixer_heads != 0)
+            throw std::runtime_error("Error de carga: token_mixer_heads debe dividir d_model (" + std::to_string(d_model) +
+                                     ") en " + filename);
+        enable_token_mixing(mixer_heads);
+        for (int i = 0; i < num_layers; ++i)
+        {
+            std::string mixer_prefix = "transformer_block_" + std::to_string(i) + "_token_mixer";
+            LinearAttention &mixer = *transformer_blocks[i]->token_mixer;
+            for (auto [name, linear] : {std::make_pair("_q", &mixer.q_proj), std::make_pair("_k", &mixer.k_proj), std::make_pair("_v", &mixer.v_proj)})
+            {
+                load_trailer_tensor(ifs, mixer_prefix + name + "_weights", linear->weight);
+                load_trailer_tensor(ifs, mixer_prefix + name + "_biases", linear->bias);
+            }
+        }
+        has_tag = static_cast<bool>(ifs >> tag);
+    }
+    if (has_tag)
+        throw std::runtime_error("Error de carga: sección desconocida '" + tag + "' tras los tensores en " + filename);
+
     ifs.close();
+    prepack_weights(checkpoint_dtype);
     std::cout << "Modelo cargado exitosamente desde: " << filename << std::endl;
 }